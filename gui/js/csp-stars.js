@@ -1,24 +1,63 @@
-/* global IApi, CosmoScout */
-
-(() => {
-  /**
-   * Stars Api
-   */
-  class StarsApi extends IApi {
-    /**
-     * @inheritDoc
-     */
-    name = 'stars';
-
-    /**
-     * @inheritDoc
-     */
-    init() {
-      CosmoScout.gui.initSlider("stars.setMagnitude", -10.0, 20.0, 0.1, [-5, 15]);
-      CosmoScout.gui.initSlider("stars.setSize", 0.01, 1, 0.01, [0.05]);
-      CosmoScout.gui.initSlider("stars.setLuminanceBoost", 0.0, 20.0, 0.1, [0]);
-    }
-  }
-
-  CosmoScout.init(StarsApi);
+/* global IApi, CosmoScout */
+
+(() => {
+  /**
+   * Stars Api
+   */
+  class StarsApi extends IApi {
+    /**
+     * @inheritDoc
+     */
+    name = 'stars';
+
+    /**
+     * @inheritDoc
+     */
+    init() {
+      CosmoScout.gui.initSlider("stars.setMagnitude", -10.0, 20.0, 0.1, [-5, 15]);
+      CosmoScout.gui.initSlider("stars.setSize", 0.01, 1, 0.01, [0.05]);
+      CosmoScout.gui.initSlider("stars.setLuminanceBoost", 0.0, 20.0, 0.1, [0]);
+    }
+
+    /**
+     * Shows the progress of loading the star catalogs. The progress bar is hidden if no catalogs
+     * are being loaded.
+     *
+     * @param loading {boolean} Whether the catalogs are being loaded
+     * @param catalog {string} The catalog file which is currently read
+     * @param progress {number} Fraction of all catalogs which has been read
+     * @param catalogProgress {number} Fraction of the current catalog which has been read
+     * @param bytesPerSecond {number} Average reading rate
+     * @param remainingSeconds {number} Estimated seconds until loading has finished, negative if
+     *                                  unknown
+     * @param waitingForCluster {boolean} Whether the cluster nodes are waiting for each other
+     */
+    setLoadingProgress(loading, catalog, progress, catalogProgress, bytesPerSecond,
+        remainingSeconds, waitingForCluster) {
+      const row = document.getElementById('stars-loading-progress');
+
+      row.style.display = loading ? '' : 'none';
+
+      if (!loading) {
+        return;
+      }
+
+      const name = catalog.split(/[\\/]/).pop();
+      let details = 'Waiting for the other cluster nodes...';
+
+      if (!waitingForCluster) {
+        details = `${name}: ${Math.round(catalogProgress * 100)}%, `;
+        details += `${(bytesPerSecond / 1e6).toFixed(1)} MB/s`;
+
+        if (remainingSeconds >= 0) {
+          details += `, ${Math.ceil(remainingSeconds)} s left`;
+        }
+      }
+
+      row.querySelector('.progress-bar').style.width = `${progress * 100}%`;
+      row.querySelector('.stars-loading-details').textContent = details;
+    }
+  }
+
+  CosmoScout.init(StarsApi);
 })();
\ No newline at end of file
@@ -0,0 +1,999 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ArrowFile.hpp"
+
+#include "CacheFile.hpp"
+#include "SharedMemory.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The metadata of Arrow files is stored as flatbuffers, see
+// https://arrow.apache.org/docs/format/Columnar.html and the schema files Schema.fbs, Message.fbs
+// and File.fbs of the Arrow repository. Both Arrow and flatbuffers are little endian, as are all
+// platforms supported by CosmoScout VR.
+const std::array<char, 6> cArrowMagic       = {'A', 'R', 'R', 'O', 'W', '1'};
+const uint32_t            cContinuation     = 0xFFFFFFFF;
+const int16_t             cMetadataVersion5 = 4;
+const uint8_t             cRecordBatch      = 3;
+const uint8_t             cSchema           = 1;
+
+// The members of the Type union in Schema.fbs.
+enum ArrowType : uint8_t {
+  eTypeNull            = 1,
+  eTypeInt             = 2,
+  eTypeFloatingPoint   = 3,
+  eTypeBinary          = 4,
+  eTypeUtf8            = 5,
+  eTypeBool            = 6,
+  eTypeDecimal         = 7,
+  eTypeDate            = 8,
+  eTypeTime            = 9,
+  eTypeTimestamp       = 10,
+  eTypeInterval        = 11,
+  eTypeFixedSizeBinary = 15,
+  eTypeDuration        = 18,
+  eTypeLargeBinary     = 19,
+  eTypeLargeUtf8       = 20,
+};
+
+// The body buffers are aligned to 64 bytes, as recommended by the specification.
+const size_t cBufferAlignment = 64;
+
+size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+T load(uint8_t const* data, size_t position) {
+  T value{};
+  std::memcpy(&value, data + position, sizeof(T));
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A table in a flatbuffer. All accesses are checked against the bounds of the buffer, so that
+// corrupt files cannot cause reads outside of the buffer. Missing fields return their default.
+class FlatTable {
+ public:
+  FlatTable() = default;
+
+  FlatTable(uint8_t const* data, size_t size, size_t position) {
+    if (position == 0 || position + sizeof(int32_t) > size) {
+      return;
+    }
+
+    int64_t vtable = static_cast<int64_t>(position) - load<int32_t>(data, position);
+    if (vtable < 0 || static_cast<size_t>(vtable) + 2 * sizeof(uint16_t) > size) {
+      return;
+    }
+
+    size_t vtableSize = load<uint16_t>(data, static_cast<size_t>(vtable));
+    if (vtableSize < 2 * sizeof(uint16_t) || static_cast<size_t>(vtable) + vtableSize > size) {
+      return;
+    }
+
+    mData       = data;
+    mSize       = size;
+    mPosition   = position;
+    mVTable     = static_cast<size_t>(vtable);
+    mVTableSize = vtableSize;
+  }
+
+  // Returns the table which is referred to by the offset at the given position.
+  static FlatTable follow(uint8_t const* data, size_t size, size_t position) {
+    if (position + sizeof(uint32_t) > size) {
+      return {};
+    }
+
+    return {data, size, position + load<uint32_t>(data, position)};
+  }
+
+  bool isValid() const {
+    return mData != nullptr;
+  }
+
+  size_t getPosition() const {
+    return mPosition;
+  }
+
+  template <typename T>
+  T getScalar(int id, T fallback) const {
+    size_t position = getField(id, sizeof(T));
+    return position == 0 ? fallback : load<T>(mData, position);
+  }
+
+  FlatTable getTable(int id) const {
+    size_t position = getField(id, sizeof(uint32_t));
+    return position == 0 ? FlatTable() : follow(mData, mSize, position);
+  }
+
+  std::string getString(int id) const {
+    size_t first = 0;
+    size_t count = 0;
+    if (!getVector(id, 1, first, count)) {
+      return "";
+    }
+
+    return std::string(reinterpret_cast<char const*>(mData) + first, count);
+  }
+
+  // Returns the position of the first element and the number of elements of a vector.
+  bool getVector(int id, size_t elementSize, size_t& first, size_t& count) const {
+    size_t position = getField(id, sizeof(uint32_t));
+    if (position == 0) {
+      return false;
+    }
+
+    size_t vector = position + load<uint32_t>(mData, position);
+    if (vector + sizeof(uint32_t) > mSize) {
+      return false;
+    }
+
+    first = vector + sizeof(uint32_t);
+    count = load<uint32_t>(mData, vector);
+
+    return count <= (mSize - first) / elementSize;
+  }
+
+  // Returns an element of a vector of tables.
+  FlatTable getElement(size_t first, size_t index) const {
+    return follow(mData, mSize, first + index * sizeof(uint32_t));
+  }
+
+ private:
+  // Returns the position of the given field or zero if it is not present.
+  size_t getField(int id, size_t size) const {
+    if (!isValid()) {
+      return 0;
+    }
+
+    size_t entry = 2 * sizeof(uint16_t) + id * sizeof(uint16_t);
+    if (entry + sizeof(uint16_t) > mVTableSize) {
+      return 0;
+    }
+
+    size_t offset = load<uint16_t>(mData, mVTable + entry);
+    if (offset == 0 || mPosition + offset + size > mSize) {
+      return 0;
+    }
+
+    return mPosition + offset;
+  }
+
+  uint8_t const* mData       = nullptr;
+  size_t         mSize       = 0;
+  size_t         mPosition   = 0;
+  size_t         mVTable     = 0;
+  size_t         mVTableSize = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Builds a flatbuffer table. The tables are serialized front to back: each table is preceded by
+// its vtable and followed by the objects it refers to. This is valid, as offsets to objects only
+// have to point forward, while vtables may be placed anywhere.
+class FlatBuilder {
+ public:
+  template <typename T>
+  FlatBuilder& addScalar(int id, T value) {
+    Field field{id, Kind::eScalar};
+    field.mBytes.resize(sizeof(T));
+    std::memcpy(field.mBytes.data(), &value, sizeof(T));
+    mFields.push_back(std::move(field));
+    return *this;
+  }
+
+  FlatBuilder& addString(int id, std::string const& value) {
+    Field field{id, Kind::eString};
+    field.mBytes.assign(value.begin(), value.end());
+    mFields.push_back(std::move(field));
+    return *this;
+  }
+
+  FlatBuilder& addTable(int id, FlatBuilder table) {
+    Field field{id, Kind::eTable};
+    field.mTables.push_back(std::move(table));
+    mFields.push_back(std::move(field));
+    return *this;
+  }
+
+  FlatBuilder& addTables(int id, std::vector<FlatBuilder> tables) {
+    Field field{id, Kind::eTables};
+    field.mTables = std::move(tables);
+    mFields.push_back(std::move(field));
+    return *this;
+  }
+
+  // Adds a vector of structs which consist of the given number of 64-bit integers each. Structs
+  // with a 32-bit member followed by padding can be stored as well on little endian platforms.
+  FlatBuilder& addStructs(int id, std::vector<int64_t> const& values, size_t structSize) {
+    Field field{id, Kind::eStructs};
+    field.mBytes.resize(values.size() * sizeof(int64_t));
+
+    // Empty vectors may return a null pointer, which memcpy() must not be called with.
+    if (!values.empty()) {
+      std::memcpy(field.mBytes.data(), values.data(), field.mBytes.size());
+    }
+
+    field.mNumStructs = values.size() / structSize;
+    mFields.push_back(std::move(field));
+    return *this;
+  }
+
+  // Returns the complete flatbuffer with this table as root, padded to eight bytes.
+  std::vector<uint8_t> finish() const {
+    std::vector<uint8_t> out(sizeof(uint32_t), 0);
+    auto                 root = static_cast<uint32_t>(serialize(out));
+    std::memcpy(out.data(), &root, sizeof(uint32_t));
+    out.resize(alignUp(out.size(), 8), 0);
+    return out;
+  }
+
+ private:
+  enum class Kind { eScalar, eString, eTable, eTables, eStructs };
+
+  struct Field {
+    Field(int id, Kind kind)
+        : mId(id)
+        , mKind(kind) {
+    }
+
+    int                      mId;
+    Kind                     mKind;
+    std::vector<uint8_t>     mBytes;
+    std::vector<FlatBuilder> mTables;
+    size_t                   mNumStructs = 0;
+
+    size_t getInlineSize() const {
+      return mKind == Kind::eScalar ? mBytes.size() : sizeof(uint32_t);
+    }
+  };
+
+  // Appends the table and all objects it refers to. Returns the position of the table.
+  size_t serialize(std::vector<uint8_t>& out) const {
+    auto pad = [&out](size_t alignment, size_t shift) {
+      out.resize(alignUp(out.size() + shift, alignment) - shift, 0);
+    };
+
+    auto put = [&out](auto value) {
+      size_t position = out.size();
+      out.resize(position + sizeof(value));
+      std::memcpy(out.data() + position, &value, sizeof(value));
+      return position;
+    };
+
+    auto patch = [&out](size_t position, auto value) {
+      std::memcpy(out.data() + position, &value, sizeof(value));
+    };
+
+    int numSlots = 0;
+    for (auto const& field : mFields) {
+      numSlots = std::max(numSlots, field.mId + 1);
+    }
+
+    // The inline fields are sorted by decreasing size, so that they are naturally aligned if the
+    // first one is aligned to eight bytes.
+    std::vector<Field const*> order;
+    for (auto const& field : mFields) {
+      order.push_back(&field);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](Field const* a, Field const* b) {
+      return a->getInlineSize() > b->getInlineSize();
+    });
+
+    pad(sizeof(uint16_t), 0);
+    size_t vtable = out.size();
+    out.resize(vtable + (2 + numSlots) * sizeof(uint16_t), 0);
+
+    pad(8, sizeof(int32_t));
+    size_t table = out.size();
+    put(static_cast<int32_t>(table - vtable));
+
+    std::vector<std::pair<Field const*, size_t>> references;
+
+    for (auto const* field : order) {
+      size_t position = out.size();
+
+      if (field->mKind == Kind::eScalar) {
+        out.insert(out.end(), field->mBytes.begin(), field->mBytes.end());
+      } else {
+        put(uint32_t(0));
+        references.emplace_back(field, position);
+      }
+
+      patch(vtable + (2 + field->mId) * sizeof(uint16_t), static_cast<uint16_t>(position - table));
+    }
+
+    patch(vtable, static_cast<uint16_t>((2 + numSlots) * sizeof(uint16_t)));
+    patch(vtable + sizeof(uint16_t), static_cast<uint16_t>(out.size() - table));
+
+    for (auto const& [field, position] : references) {
+      size_t target = 0;
+
+      if (field->mKind == Kind::eString) {
+        pad(sizeof(uint32_t), 0);
+        target = put(static_cast<uint32_t>(field->mBytes.size()));
+        out.insert(out.end(), field->mBytes.begin(), field->mBytes.end());
+        out.push_back(0);
+      } else if (field->mKind == Kind::eTable) {
+        target = field->mTables.front().serialize(out);
+      } else if (field->mKind == Kind::eTables) {
+        pad(sizeof(uint32_t), 0);
+        target       = put(static_cast<uint32_t>(field->mTables.size()));
+        size_t first = out.size();
+        out.resize(first + field->mTables.size() * sizeof(uint32_t), 0);
+
+        for (size_t i = 0; i < field->mTables.size(); ++i) {
+          size_t element = first + i * sizeof(uint32_t);
+          size_t child   = field->mTables[i].serialize(out);
+          patch(element, static_cast<uint32_t>(child - element));
+        }
+      } else {
+        pad(8, sizeof(uint32_t));
+        target = put(static_cast<uint32_t>(field->mNumStructs));
+        out.insert(out.end(), field->mBytes.begin(), field->mBytes.end());
+      }
+
+      patch(position, static_cast<uint32_t>(target - position));
+    }
+
+    return table;
+  }
+
+  std::vector<Field> mFields;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the value at the given index of an integer or floating point buffer.
+double getNumber(bool isFloat, int bitWidth, bool isSigned, uint8_t const* values, size_t index) {
+  if (isFloat) {
+    return bitWidth == 32 ? load<float>(values, index * 4) : load<double>(values, index * 8);
+  }
+
+  switch (bitWidth) {
+  case 8:
+    return isSigned ? load<int8_t>(values, index) : load<uint8_t>(values, index);
+  case 16:
+    return isSigned ? load<int16_t>(values, index * 2) : load<uint16_t>(values, index * 2);
+  case 32:
+    return isSigned ? load<int32_t>(values, index * 4) : load<uint32_t>(values, index * 4);
+  default:
+    return isSigned ? static_cast<double>(load<int64_t>(values, index * 8))
+                    : static_cast<double>(load<uint64_t>(values, index * 8));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ArrowWriter::ArrowWriter(size_t numRows)
+    : mNumRows(numRows) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ArrowWriter::addFloatColumn(std::string name, float const* values) {
+  mColumns.push_back({std::move(name), Type::eFloat32, values, nullptr});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ArrowWriter::addUInt32Column(std::string name, uint32_t const* values) {
+  mColumns.push_back({std::move(name), Type::eUInt32, values, nullptr});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ArrowWriter::addStringColumn(std::string name, int32_t const* offsets, char const* chars) {
+  mColumns.push_back({std::move(name), Type::eUtf8, chars, offsets});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::pair<void const*, size_t>> ArrowWriter::getBuffers(Column const& column) const {
+  if (column.mType == Type::eUtf8) {
+    return {{nullptr, 0}, {column.mOffsets, (mNumRows + 1) * sizeof(int32_t)},
+        {column.mValues, static_cast<size_t>(column.mOffsets[mNumRows])}};
+  }
+
+  return {{nullptr, 0}, {column.mValues, mNumRows * sizeof(uint32_t)}};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowWriter::write(std::string const& file) const {
+  // The table is written to a temporary file which then replaces the target file. Truncating the
+  // target file instead would crash all processes which have mapped it, see ArrowReader. The
+  // process ID keeps several processes from writing the same temporary file.
+  std::string   temp = file + "." + std::to_string(getProcessId()) + ".tmp";
+  std::ofstream stream(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!stream.is_open()) {
+    logger().error("Failed to write Arrow file '{}': Cannot open file!", file);
+    return false;
+  }
+
+  int64_t position = 0;
+
+  auto writeBytes = [&](void const* data, size_t size) {
+    stream.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+    position += static_cast<int64_t>(size);
+  };
+
+  // Pads the file so that the current position is aligned relative to the given origin.
+  auto writePadding = [&](size_t alignment, int64_t origin) {
+    static const std::array<char, cBufferAlignment> zeros{};
+
+    auto current = static_cast<size_t>(position - origin);
+    writeBytes(zeros.data(), alignUp(current, alignment) - current);
+  };
+
+  // Each message consists of a continuation marker, the size of the metadata, the metadata padded
+  // to eight bytes and the body. Returns the size of everything before the body.
+  auto writeMessage = [&](uint8_t headerType, FlatBuilder header, int64_t bodyLength) {
+    FlatBuilder message;
+    message.addScalar<int16_t>(0, cMetadataVersion5)
+        .addScalar<uint8_t>(1, headerType)
+        .addTable(2, std::move(header))
+        .addScalar<int64_t>(3, bodyLength);
+
+    std::vector<uint8_t> metadata = message.finish();
+    auto                 size     = static_cast<int32_t>(metadata.size());
+
+    writeBytes(&cContinuation, sizeof(cContinuation));
+    writeBytes(&size, sizeof(size));
+    writeBytes(metadata.data(), metadata.size());
+
+    return static_cast<int32_t>(2 * sizeof(int32_t) + metadata.size());
+  };
+
+  auto buildSchema = [this]() {
+    std::vector<FlatBuilder> fields;
+
+    for (auto const& column : mColumns) {
+      FlatBuilder type;
+
+      if (column.mType == Type::eFloat32) {
+        type.addScalar<int16_t>(0, 1); // Precision::SINGLE
+      } else if (column.mType == Type::eUInt32) {
+        type.addScalar<int32_t>(0, 32).addScalar<uint8_t>(1, 0);
+      }
+
+      uint8_t typeId = column.mType == Type::eFloat32  ? eTypeFloatingPoint
+                       : column.mType == Type::eUInt32 ? eTypeInt
+                                                       : eTypeUtf8;
+
+      FlatBuilder field;
+      field.addString(0, column.mName)
+          .addScalar<uint8_t>(1, 0)
+          .addScalar<uint8_t>(2, typeId)
+          .addTable(3, std::move(type))
+          .addTables(5, {});
+      fields.push_back(std::move(field));
+    }
+
+    FlatBuilder schema;
+    schema.addScalar<int16_t>(0, 0).addTables(1, std::move(fields));
+    return schema;
+  };
+
+  writeBytes(cArrowMagic.data(), cArrowMagic.size());
+  writePadding(8, 0);
+
+  writeMessage(cSchema, buildSchema(), 0);
+
+  // The record batch lists the location of each buffer in the body.
+  std::vector<int64_t> nodes;
+  std::vector<int64_t> buffers;
+  int64_t              bodyLength = 0;
+
+  for (auto const& column : mColumns) {
+    nodes.push_back(static_cast<int64_t>(mNumRows));
+    nodes.push_back(0);
+
+    for (auto const& [data, size] : getBuffers(column)) {
+      buffers.push_back(bodyLength);
+      buffers.push_back(static_cast<int64_t>(size));
+      bodyLength += static_cast<int64_t>(alignUp(size, cBufferAlignment));
+    }
+  }
+
+  FlatBuilder batch;
+  batch.addScalar<int64_t>(0, static_cast<int64_t>(mNumRows))
+      .addStructs(1, nodes, 2)
+      .addStructs(2, buffers, 2);
+
+  int64_t batchOffset   = position;
+  int32_t batchMetadata = writeMessage(cRecordBatch, std::move(batch), bodyLength);
+
+  // The columns are streamed directly from the given arrays. The buffer offsets are relative to
+  // the start of the body.
+  int64_t body = position;
+
+  for (auto const& column : mColumns) {
+    for (auto const& [data, size] : getBuffers(column)) {
+      writeBytes(data, size);
+      writePadding(cBufferAlignment, body);
+    }
+  }
+
+  // The end-of-stream marker is followed by the footer, which repeats the schema and lists the
+  // record batches.
+  const std::array<uint32_t, 2> endOfStream = {cContinuation, 0};
+  writeBytes(endOfStream.data(), sizeof(endOfStream));
+
+  FlatBuilder footer;
+  footer.addScalar<int16_t>(0, cMetadataVersion5)
+      .addTable(1, buildSchema())
+      .addStructs(2, {}, 3)
+      .addStructs(3, {batchOffset, batchMetadata, bodyLength}, 3);
+
+  std::vector<uint8_t> footerData = footer.finish();
+  auto                 footerSize = static_cast<int32_t>(footerData.size());
+
+  writeBytes(footerData.data(), footerData.size());
+  writeBytes(&footerSize, sizeof(footerSize));
+  writeBytes(cArrowMagic.data(), cArrowMagic.size());
+
+  stream.close();
+
+  std::error_code error;
+
+  if (stream.fail()) {
+    logger().error("Failed to write Arrow file '{}'!", file);
+    std::filesystem::remove(temp, error);
+    return false;
+  }
+
+  std::filesystem::rename(temp, file, error);
+
+  if (error) {
+    logger().error("Failed to write Arrow file '{}': {}", file, error.message());
+    std::filesystem::remove(temp, error);
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ArrowReader::ArrowReader() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ArrowReader::~ArrowReader() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::open(std::string const& file) {
+  mFile = file;
+
+  // If the file cannot be mapped, it is read into memory instead.
+  mMemory = SharedMemory::mapFile(file);
+
+  if (mMemory) {
+    mData = static_cast<uint8_t const*>(mMemory->getData());
+    mSize = mMemory->getSize();
+  } else {
+    std::ifstream stream(file, std::ios::in | std::ios::binary);
+    if (!stream.is_open()) {
+      logger().error("Failed to read Arrow file '{}': Cannot open file!", file);
+      return false;
+    }
+
+    mBuffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+  }
+
+  // The file starts with the magic number padded to eight bytes and ends with the size of the
+  // footer followed by the magic number.
+  const size_t trailerSize = sizeof(int32_t) + cArrowMagic.size();
+
+  if (mSize < 8 + trailerSize || std::memcmp(mData, cArrowMagic.data(), cArrowMagic.size()) != 0 ||
+      std::memcmp(mData + mSize - cArrowMagic.size(), cArrowMagic.data(), cArrowMagic.size()) !=
+          0) {
+    logger().error("Failed to read Arrow file '{}': This is not an Arrow IPC file! Note that the "
+                   "Arrow IPC stream format is not supported.",
+        file);
+    return false;
+  }
+
+  auto footerSize = load<int32_t>(mData, mSize - trailerSize);
+  if (footerSize <= 0 || static_cast<size_t>(footerSize) > mSize - 8 - trailerSize) {
+    logger().error("Failed to read Arrow file '{}': The footer is corrupt!", file);
+    return false;
+  }
+
+  size_t    footerPosition = mSize - trailerSize - static_cast<size_t>(footerSize);
+  FlatTable footer         = FlatTable::follow(mData, mSize, footerPosition);
+
+  size_t first = 0;
+  size_t count = 0;
+
+  if (!footer.isValid() || !footer.getVector(3, 24, first, count)) {
+    logger().error("Failed to read Arrow file '{}': The footer is corrupt!", file);
+    return false;
+  }
+
+  if (!parseSchema(footer.getTable(1).getPosition())) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t block          = first + i * 24;
+    auto   offset         = load<int64_t>(mData, block);
+    auto   metaDataLength = load<int32_t>(mData, block + 8);
+    auto   bodyLength     = load<int64_t>(mData, block + 16);
+
+    if (offset < 0 || metaDataLength < 0 || bodyLength < 0 ||
+        !parseRecordBatch(static_cast<size_t>(offset), static_cast<size_t>(metaDataLength),
+            static_cast<size_t>(bodyLength))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t ArrowReader::getNumRows() const {
+  return mNumRows;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ArrowReader::getColumn(std::initializer_list<std::string_view> names) const {
+  for (auto const& name : names) {
+    for (size_t i = 0; i < mFields.size(); ++i) {
+      if (mFields[i].mName == name) {
+        return static_cast<int>(i);
+      }
+    }
+  }
+
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::hasNulls(int column) const {
+  return column >= 0 && std::any_of(mChunks.begin(), mChunks.end(), [column](auto const& batch) {
+    return batch[column].mNullCount > 0;
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float const* ArrowReader::getFloatData(int column) const {
+  if (!mMemory || mChunks.size() != 1 || column < 0 ||
+      static_cast<size_t>(column) >= mFields.size() || mFields[column].mType != Type::eFloat ||
+      mFields[column].mBitWidth != 32 || hasNulls(column)) {
+    return nullptr;
+  }
+
+  auto const* values = mChunks[0][column].mValues;
+  if (reinterpret_cast<uintptr_t>(values) % alignof(float) != 0) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<float const*>(values);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t const* ArrowReader::getUInt32Data(int column) const {
+  if (!mMemory || mChunks.size() != 1 || column < 0 ||
+      static_cast<size_t>(column) >= mFields.size() || mFields[column].mType != Type::eInt ||
+      mFields[column].mBitWidth != 32 || mFields[column].mSigned || hasNulls(column)) {
+    return nullptr;
+  }
+
+  auto const* values = mChunks[0][column].mValues;
+  if (reinterpret_cast<uintptr_t>(values) % alignof(uint32_t) != 0) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<uint32_t const*>(values);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SharedMemory> const& ArrowReader::getMemory() const {
+  return mMemory;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::readFloats(int column, float nullValue, std::vector<float>& values) const {
+  return readNumbers(column, nullValue, values);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::readUInt32s(int column, uint32_t nullValue, std::vector<uint32_t>& values) const {
+  return readNumbers(column, nullValue, values);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+bool ArrowReader::readNumbers(int column, T nullValue, std::vector<T>& values) const {
+  if (column < 0 || static_cast<size_t>(column) >= mFields.size()) {
+    return false;
+  }
+
+  auto const& field = mFields[column];
+
+  if (field.mType != Type::eInt && field.mType != Type::eFloat) {
+    return false;
+  }
+
+  values.clear();
+  values.reserve(mNumRows);
+
+  for (auto const& batch : mChunks) {
+    auto const& chunk = batch[column];
+
+    for (size_t i = 0; i < chunk.mLength; ++i) {
+      if (isValid(chunk, i)) {
+        values.push_back(static_cast<T>(getNumber(
+            field.mType == Type::eFloat, field.mBitWidth, field.mSigned, chunk.mValues, i)));
+      } else {
+        values.push_back(nullValue);
+      }
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::parseSchema(size_t position) {
+  FlatTable schema(mData, mSize, position);
+
+  size_t first = 0;
+  size_t count = 0;
+
+  if (!schema.getVector(1, sizeof(uint32_t), first, count)) {
+    logger().error("Failed to read Arrow file '{}': The schema is corrupt!", mFile);
+    return false;
+  }
+
+  if (schema.getScalar<int16_t>(0, 0) != 0) {
+    logger().error("Failed to read Arrow file '{}': Big endian files are not supported!", mFile);
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    FlatTable field = schema.getElement(first, i);
+    FlatTable type  = field.getTable(3);
+
+    Field result;
+    result.mName = field.getString(0);
+
+    if (field.getTable(4).isValid()) {
+      logger().error("Failed to read Arrow file '{}': Column '{}' is dictionary-encoded, which is "
+                     "not supported!",
+          mFile, result.mName);
+      return false;
+    }
+
+    switch (field.getScalar<uint8_t>(2, 0)) {
+    case eTypeNull:
+      result.mNumBuffers = 0;
+      break;
+    case eTypeInt:
+      result.mBitWidth   = type.getScalar<int32_t>(0, 0);
+      result.mSigned     = type.getScalar<uint8_t>(1, 0) != 0;
+      result.mNumBuffers = 2;
+      if (result.mBitWidth == 8 || result.mBitWidth == 16 || result.mBitWidth == 32 ||
+          result.mBitWidth == 64) {
+        result.mType = Type::eInt;
+      }
+      break;
+    case eTypeFloatingPoint:
+      // Half precision floats are not supported.
+      result.mNumBuffers = 2;
+      if (type.getScalar<int16_t>(0, 0) == 1) {
+        result.mType     = Type::eFloat;
+        result.mBitWidth = 32;
+      } else if (type.getScalar<int16_t>(0, 0) == 2) {
+        result.mType     = Type::eFloat;
+        result.mBitWidth = 64;
+      }
+      break;
+    case eTypeUtf8:
+      result.mType       = Type::eUtf8;
+      result.mNumBuffers = 3;
+      break;
+    case eTypeBool:
+    case eTypeDecimal:
+    case eTypeDate:
+    case eTypeTime:
+    case eTypeTimestamp:
+    case eTypeInterval:
+    case eTypeFixedSizeBinary:
+    case eTypeDuration:
+      result.mNumBuffers = 2;
+      break;
+    case eTypeBinary:
+    case eTypeLargeBinary:
+    case eTypeLargeUtf8:
+      result.mNumBuffers = 3;
+      break;
+    default:
+      logger().error("Failed to read Arrow file '{}': Column '{}' has a nested type, which is not "
+                     "supported!",
+          mFile, result.mName);
+      return false;
+    }
+
+    mFields.push_back(std::move(result));
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::parseRecordBatch(size_t offset, size_t metaDataLength, size_t bodyLength) {
+  auto corrupt = [this]() {
+    logger().error("Failed to read Arrow file '{}': A record batch is corrupt!", mFile);
+    return false;
+  };
+
+  if (offset + sizeof(uint32_t) * 2 > mSize || metaDataLength > mSize - offset ||
+      bodyLength > mSize - offset - metaDataLength) {
+    return corrupt();
+  }
+
+  // Files written by old Arrow versions have no continuation marker.
+  size_t metadata = offset + sizeof(uint32_t);
+  if (load<uint32_t>(mData, offset) == cContinuation) {
+    metadata += sizeof(uint32_t);
+  }
+
+  FlatTable message = FlatTable::follow(mData, mSize, metadata);
+  if (!message.isValid() || message.getScalar<uint8_t>(1, 0) != cRecordBatch) {
+    return corrupt();
+  }
+
+  FlatTable batch = message.getTable(2);
+
+  if (batch.getTable(3).isValid()) {
+    logger().error("Failed to read Arrow file '{}': Compressed files are not supported! With "
+                   "pyarrow, write the file with compression='uncompressed'.",
+        mFile);
+    return false;
+  }
+
+  size_t firstNode   = 0;
+  size_t numNodes    = 0;
+  size_t firstBuffer = 0;
+  size_t numBuffers  = 0;
+
+  if (!batch.getVector(1, 16, firstNode, numNodes) ||
+      !batch.getVector(2, 16, firstBuffer, numBuffers) || numNodes != mFields.size()) {
+    return corrupt();
+  }
+
+  // Each row takes at least one bit, unless all columns have the null type. This also prevents
+  // overflows when computing buffer sizes.
+  auto rows = batch.getScalar<int64_t>(0, 0);
+  if (rows < 0 || static_cast<uint64_t>(rows) > mSize * 8) {
+    return corrupt();
+  }
+
+  auto length = static_cast<size_t>(rows);
+
+  uint8_t const* body   = mData + offset + metaDataLength;
+  size_t         buffer = 0;
+
+  auto getBuffer = [&](size_t index, uint8_t const*& data, size_t& size) {
+    if (index >= numBuffers) {
+      return false;
+    }
+
+    auto bufferOffset = load<int64_t>(mData, firstBuffer + index * 16);
+    auto bufferLength = load<int64_t>(mData, firstBuffer + index * 16 + 8);
+
+    if (bufferOffset < 0 || bufferLength < 0 || static_cast<size_t>(bufferOffset) > bodyLength ||
+        static_cast<size_t>(bufferLength) > bodyLength - static_cast<size_t>(bufferOffset)) {
+      return false;
+    }
+
+    data = body + bufferOffset;
+    size = static_cast<size_t>(bufferLength);
+    return true;
+  };
+
+  std::vector<Chunk> chunks(mFields.size());
+
+  for (size_t i = 0; i < mFields.size(); ++i) {
+    auto const& field = mFields[i];
+    auto&       chunk = chunks[i];
+
+    chunk.mLength    = static_cast<size_t>(load<int64_t>(mData, firstNode + i * 16));
+    chunk.mNullCount = static_cast<size_t>(load<int64_t>(mData, firstNode + i * 16 + 8));
+
+    if (chunk.mLength != length) {
+      return corrupt();
+    }
+
+    if (field.mNumBuffers == 0) {
+      continue;
+    }
+
+    uint8_t const* data = nullptr;
+    size_t         size = 0;
+
+    if (!getBuffer(buffer, data, size)) {
+      return corrupt();
+    }
+
+    if (chunk.mNullCount > 0) {
+      if (size < (length + 7) / 8) {
+        return corrupt();
+      }
+      chunk.mValidity = data;
+    }
+
+    if (!getBuffer(buffer + 1, chunk.mValues, size)) {
+      return corrupt();
+    }
+
+    if ((field.mType == Type::eInt || field.mType == Type::eFloat) &&
+        size < length * field.mBitWidth / 8) {
+      return corrupt();
+    }
+
+    if (field.mType == Type::eUtf8 &&
+        (size < (length + 1) * sizeof(int32_t) ||
+            !getBuffer(buffer + 2, chunk.mData, chunk.mDataSize))) {
+      return corrupt();
+    }
+
+    buffer += field.mNumBuffers;
+  }
+
+  mChunks.push_back(std::move(chunks));
+  mNumRows += length;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArrowReader::isValid(Chunk const& chunk, size_t row) const {
+  return chunk.mValidity == nullptr || ((chunk.mValidity[row / 8] >> (row % 8)) & 1U) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
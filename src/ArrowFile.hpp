@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_ARROW_FILE_HPP
+#define CSP_STARS_ARROW_FILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace csp::stars {
+
+class SharedMemory;
+
+/// Writes a table to an Apache Arrow IPC file, which is also known as Feather V2 and can be read
+/// with pyarrow, pandas or polars. Only the subset of the format which is needed for exchanging
+/// star tables is supported: uncompressed float32, uint32 and utf8 columns without null values,
+/// stored in a single record batch. The columns are not copied; the given arrays are streamed to
+/// the file one after another when write() is called, hence they have to stay valid until then.
+class ArrowWriter {
+ public:
+  explicit ArrowWriter(size_t numRows);
+
+  void addFloatColumn(std::string name, float const* values);
+  void addUInt32Column(std::string name, uint32_t const* values);
+
+  /// The string of row i is chars[offsets[i], offsets[i + 1]), so there are numRows + 1 offsets.
+  void addStringColumn(std::string name, int32_t const* offsets, char const* chars);
+
+  /// Returns false if the file could not be written.
+  bool write(std::string const& file) const;
+
+ private:
+  enum class Type { eFloat32, eUInt32, eUtf8 };
+
+  struct Column {
+    std::string    mName;
+    Type           mType;
+    void const*    mValues;
+    int32_t const* mOffsets;
+  };
+
+  /// Returns the data buffers of the given column, the validity bitmap is always empty.
+  std::vector<std::pair<void const*, size_t>> getBuffers(Column const& column) const;
+
+  size_t              mNumRows;
+  std::vector<Column> mColumns;
+};
+
+/// Reads tables from Apache Arrow IPC files as written by ArrowWriter or by other Arrow
+/// implementations. The file is mapped into memory if possible, so that columns of the right type
+/// can be used without copying them. Columns of other numeric types are converted. Compressed
+/// files and nested column types are not supported; they are rejected with an error message.
+class ArrowReader {
+ public:
+  ArrowReader();
+  ~ArrowReader();
+
+  ArrowReader(ArrowReader const& other) = delete;
+  ArrowReader(ArrowReader&& other)      = delete;
+  ArrowReader& operator=(ArrowReader const& other) = delete;
+  ArrowReader& operator=(ArrowReader&& other) = delete;
+
+  /// Maps the given file and parses its schema and the metadata of all record batches. The
+  /// column data is not touched. Returns false and logs the reason if the file cannot be read.
+  bool open(std::string const& file);
+
+  size_t getNumRows() const;
+
+  /// Returns the index of the first column matching one of the given names, or -1 if there is
+  /// none.
+  int getColumn(std::initializer_list<std::string_view> names) const;
+
+  /// Returns true if the given column contains null values.
+  bool hasNulls(int column) const;
+
+  /// Returns the values of the given column without copying them, if the file is mapped into
+  /// memory, the column is a float32 or uint32 column stored in a single record batch and has no
+  /// null values. Returns nullptr otherwise. The values stay valid as long as the memory returned
+  /// by getMemory() is referenced.
+  float const*    getFloatData(int column) const;
+  uint32_t const* getUInt32Data(int column) const;
+
+  /// The mapping of the file, or nullptr if it could not be mapped and has been read instead.
+  std::shared_ptr<SharedMemory> const& getMemory() const;
+
+  /// Copy the values of all record batches of the given column into the given vector. Integer
+  /// and floating point columns are converted, null values are replaced by the given value.
+  /// Return false if the column has another type.
+  bool readFloats(int column, float nullValue, std::vector<float>& values) const;
+  bool readUInt32s(int column, uint32_t nullValue, std::vector<uint32_t>& values) const;
+
+  /// Calls func(row, string) for each non-empty string of the given utf8 column. Returns false if
+  /// the column has another type.
+  template <typename F>
+  bool forEachString(int column, F const& func) const;
+
+ private:
+  /// The supported column types. eOther columns can be skipped, but not read.
+  enum class Type { eInt, eFloat, eUtf8, eOther };
+
+  struct Field {
+    std::string mName;
+    Type        mType       = Type::eOther;
+    int         mBitWidth   = 0; ///< 32 or 64 for floats.
+    bool        mSigned     = false;
+    int         mNumBuffers = 0; ///< The number of buffers of this column in each record batch.
+  };
+
+  /// The location of the data of one column in one record batch.
+  struct Chunk {
+    size_t         mLength    = 0;
+    size_t         mNullCount = 0;
+    uint8_t const* mValidity  = nullptr; ///< May be nullptr if there are no nulls.
+    uint8_t const* mValues    = nullptr;
+    uint8_t const* mData      = nullptr; ///< The characters of utf8 columns.
+    size_t         mDataSize  = 0;
+  };
+
+  bool parseSchema(size_t position);
+  bool parseRecordBatch(size_t offset, size_t metaDataLength, size_t bodyLength);
+
+  bool isValid(Chunk const& chunk, size_t row) const;
+
+  template <typename T>
+  bool readNumbers(int column, T nullValue, std::vector<T>& values) const;
+
+  std::string                     mFile;
+  std::shared_ptr<SharedMemory>   mMemory;
+  std::vector<uint8_t>            mBuffer;
+  uint8_t const*                  mData    = nullptr;
+  size_t                          mSize    = 0;
+  size_t                          mNumRows = 0;
+  std::vector<Field>              mFields;
+  std::vector<std::vector<Chunk>> mChunks; ///< mChunks[batch][column]
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+bool ArrowReader::forEachString(int column, F const& func) const {
+  if (column < 0 || static_cast<size_t>(column) >= mFields.size() ||
+      mFields[column].mType != Type::eUtf8) {
+    return false;
+  }
+
+  size_t row = 0;
+
+  for (auto const& batch : mChunks) {
+    auto const& chunk = batch[column];
+
+    for (size_t i = 0; i < chunk.mLength; ++i, ++row) {
+      int32_t begin = 0;
+      int32_t end   = 0;
+      std::memcpy(&begin, chunk.mValues + i * sizeof(int32_t), sizeof(int32_t));
+      std::memcpy(&end, chunk.mValues + (i + 1) * sizeof(int32_t), sizeof(int32_t));
+
+      if (isValid(chunk, i) && begin >= 0 && end > begin &&
+          static_cast<size_t>(end) <= chunk.mDataSize) {
+        func(row, std::string_view(reinterpret_cast<char const*>(chunk.mData) + begin,
+                      static_cast<size_t>(end - begin)));
+      }
+    }
+  }
+
+  return true;
+}
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_ARROW_FILE_HPP
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include <doctest.h>
+
+#include "ArrowFile.hpp"
+
+#include <filesystem>
+#include <map>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The table which is written by the tests. The file of the last test case is also read by
+// ArrowFile.spec.py with pyarrow, which checks for the same values.
+const std::vector<float>    cVMagnitudes = {-1.46F, 0.03F, 0.F, 12.5F};
+const std::vector<float>    cParallaxes  = {379.21F, 130.23F, 0.F, 1.5F};
+const std::vector<uint32_t> cHipparcos   = {32349, 91262, 0, 4294967295U};
+const std::vector<int32_t>  cNameOffsets = {0, 6, 10, 10, 13};
+const std::string           cNameChars   = "SiriusVega\xC3\x85r";
+
+void writeTable(std::string const& file) {
+  ArrowWriter writer(cVMagnitudes.size());
+  writer.addFloatColumn("vmag", cVMagnitudes.data());
+  writer.addFloatColumn("parallax", cParallaxes.data());
+  writer.addUInt32Column("hip", cHipparcos.data());
+  writer.addStringColumn("name", cNameOffsets.data(), cNameChars.data());
+  REQUIRE(writer.write(file));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::ArrowWriter / csp::stars::ArrowReader") {
+  std::string file = (std::filesystem::temp_directory_path() / "csp-stars-test.arrow").string();
+  writeTable(file);
+
+  ArrowReader reader;
+  REQUIRE(reader.open(file));
+  REQUIRE(reader.getNumRows() == cVMagnitudes.size());
+
+  int vmagColumn     = reader.getColumn({"mag", "vmag"});
+  int parallaxColumn = reader.getColumn({"parallax"});
+  int hipColumn      = reader.getColumn({"hip"});
+  int nameColumn     = reader.getColumn({"name"});
+  CHECK(vmagColumn == 0);
+  CHECK(parallaxColumn == 1);
+  CHECK(hipColumn == 2);
+  CHECK(nameColumn == 3);
+  CHECK(reader.getColumn({"ra"}) == -1);
+  CHECK_FALSE(reader.hasNulls(vmagColumn));
+
+  // The float column of a single record batch is used without copying it, if it is mapped.
+  if (reader.getMemory()) {
+    float const* data = reader.getFloatData(vmagColumn);
+    REQUIRE(data != nullptr);
+    CHECK(std::vector<float>(data, data + reader.getNumRows()) == cVMagnitudes);
+  }
+
+  std::vector<float>    parallaxes;
+  std::vector<uint32_t> hipparcos;
+  std::vector<float>    convertedHipparcos;
+  CHECK(reader.readFloats(parallaxColumn, 0.F, parallaxes));
+  CHECK(reader.readUInt32s(hipColumn, 0, hipparcos));
+  CHECK(reader.readFloats(hipColumn, 0.F, convertedHipparcos));
+  CHECK(parallaxes == cParallaxes);
+  CHECK(hipparcos == cHipparcos);
+  CHECK(convertedHipparcos[0] == 32349.F);
+
+  // Empty strings are skipped.
+  std::map<size_t, std::string> names;
+  CHECK(reader.forEachString(
+      nameColumn, [&names](size_t row, std::string_view name) { names[row] = name; }));
+  CHECK(names == std::map<size_t, std::string>{{0, "Sirius"}, {1, "Vega"}, {3, "\xC3\x85r"}});
+  CHECK_FALSE(reader.forEachString(vmagColumn, [](size_t, std::string_view) {}));
+
+  std::filesystem::remove(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::ArrowWriter replaces mapped files") {
+  std::string file = (std::filesystem::temp_directory_path() / "csp-stars-test.arrow").string();
+  writeTable(file);
+
+  // The file is replaced instead of truncated, so the old mapping stays readable.
+  ArrowReader reader;
+  REQUIRE(reader.open(file));
+  writeTable(file);
+
+  std::vector<float> magnitudes;
+  CHECK(reader.readFloats(0, 0.F, magnitudes));
+  CHECK(magnitudes == cVMagnitudes);
+
+  std::filesystem::remove(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::ArrowWriter writes files for pyarrow") {
+  // This file is checked by ArrowFile.spec.py, see CMakeLists.txt.
+  writeTable("csp-stars-test.arrow");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
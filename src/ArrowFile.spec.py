@@ -0,0 +1,33 @@
+# ------------------------------------------------------------------------------------------------ #
+#                                This file is part of CosmoScout VR                                #
+#       and may be used under the terms of the MIT license. See the LICENSE file for details.      #
+#                         Copyright: (c) 2019 German Aerospace Center (DLR)                        #
+# ------------------------------------------------------------------------------------------------ #
+
+# Checks that pyarrow can read the file written by ArrowFile.spec.cpp. The test is skipped if
+# pyarrow is not installed.
+
+import sys
+
+try:
+    import pyarrow.feather
+except ImportError:
+    print("pyarrow is not installed, skipping the test.")
+    sys.exit(77)
+
+table = pyarrow.feather.read_table(sys.argv[1])
+
+assert table.column_names == ["vmag", "parallax", "hip", "name"], table.column_names
+assert table.num_rows == 4, table.num_rows
+assert str(table.schema.field("vmag").type) == "float", table.schema
+assert str(table.schema.field("hip").type) == "uint32", table.schema
+assert str(table.schema.field("name").type) == "string", table.schema
+
+columns = table.to_pydict()
+
+assert [round(v, 2) for v in columns["vmag"]] == [-1.46, 0.03, 0.0, 12.5], columns["vmag"]
+assert columns["hip"] == [32349, 91262, 0, 4294967295], columns["hip"]
+assert columns["name"] == ["Sirius", "Vega", "", "År"], columns["name"]
+
+table.validate(full=True)
+print("pyarrow read {} rows.".format(table.num_rows))
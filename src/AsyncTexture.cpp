@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "AsyncTexture.hpp"
+
+#include "Tracing.hpp"
+#include "logger.hpp"
+
+#include "../../../src/cs-graphics/TextureLoader.hpp"
+
+// The decoder is compiled into this plugin with internal linkage, so that it does not clash with
+// the copy used by the core libraries.
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncTexture::AsyncTexture(std::string file, Mipmaps mipmaps, GLenum wrapS)
+    : mFile(std::move(file))
+    , mMipmaps(mipmaps)
+    , mWrapS(wrapS) {
+  mDecodeTask = std::async(
+      std::launch::async, [file = mFile, mipmaps]() { return decode(file, mipmaps); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncTexture::~AsyncTexture() {
+  if (mDecodeTask.valid()) {
+    mDecodeTask.wait();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaTexture* AsyncTexture::getTexture() {
+  if (mDecodeTask.valid() &&
+      mDecodeTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    Image image = mDecodeTask.get();
+
+    if (image.mPixels) {
+      upload(image);
+    } else {
+      // Let the TextureLoader try, it supports some more formats.
+      mTexture = cs::graphics::TextureLoader::loadFromFile(mFile);
+
+      // The actual internal format is unknown, four bytes per texel are assumed.
+      if (mTexture) {
+        GLint width  = 0;
+        GLint height = 0;
+        mTexture->Bind();
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        mTexture->Unbind();
+        mSizeInBytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+      }
+    }
+
+    if (!mTexture) {
+      logger().error("Failed to load texture '{}'!", mFile);
+    }
+  }
+
+  return mTexture.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t AsyncTexture::getSizeInBytes() const {
+  return mSizeInBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncTexture::uploadPointSpread(int width, int height, uint8_t const* pixels) {
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  uploadLevels(width, height, filterPointSpread(width, height, pixels));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncTexture::Image AsyncTexture::decode(std::string const& file, Mipmaps mipmaps) {
+  CSP_STARS_TRACE_ZONE("Decode texture");
+
+  Image image;
+  int   channels = 0;
+
+  // All images are converted to RGBA, so that grayscale images can be sampled like color images.
+  uint8_t* pixels = stbi_load(file.c_str(), &image.mWidth, &image.mHeight, &channels, 4);
+
+  if (pixels) {
+    image.mPixels = std::unique_ptr<uint8_t, void (*)(void*)>(pixels, stbi_image_free);
+
+    if (mipmaps == Mipmaps::ePointSpread) {
+      image.mLevels = filterPointSpread(image.mWidth, image.mHeight, pixels);
+    }
+  }
+
+  return image;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::vector<uint8_t>> AsyncTexture::filterPointSpread(
+    int width, int height, uint8_t const* pixels) {
+  CSP_STARS_TRACE_ZONE("Filter point spread");
+
+  // The four taps of the filter cover the two texels which are merged and one neighbour on each
+  // side. Texels outside of the image are clamped to the border.
+  const std::array<float, 4> weights{1.F / 8.F, 3.F / 8.F, 3.F / 8.F, 1.F / 8.F};
+
+  std::vector<std::vector<uint8_t>> levels;
+  std::vector<float>                current(pixels, pixels + 4 * width * height);
+  std::vector<float>                rows;
+
+  while (width > 1 || height > 1) {
+    int levelWidth  = std::max(1, width / 2);
+    int levelHeight = std::max(1, height / 2);
+
+    // Horizontal pass, the result has levelWidth columns and height rows.
+    rows.assign(4 * levelWidth * height, 0.F);
+
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < levelWidth; ++x) {
+        for (int k = 0; k < 4; ++k) {
+          int source = std::clamp(2 * x - 1 + k, 0, width - 1);
+          for (int c = 0; c < 4; ++c) {
+            rows[4 * (y * levelWidth + x) + c] +=
+                weights.at(k) * current[4 * (y * width + source) + c];
+          }
+        }
+      }
+    }
+
+    // Vertical pass.
+    current.assign(4 * levelWidth * levelHeight, 0.F);
+
+    for (int y = 0; y < levelHeight; ++y) {
+      for (int k = 0; k < 4; ++k) {
+        int source = std::clamp(2 * y - 1 + k, 0, height - 1);
+        for (int x = 0; x < 4 * levelWidth; ++x) {
+          current[4 * y * levelWidth + x] += weights.at(k) * rows[4 * source * levelWidth + x];
+        }
+      }
+    }
+
+    std::vector<uint8_t> level(current.size());
+    for (size_t i = 0; i < current.size(); ++i) {
+      level[i] = static_cast<uint8_t>(std::clamp(current[i] + 0.5F, 0.F, 255.F));
+    }
+
+    levels.push_back(std::move(level));
+
+    width  = levelWidth;
+    height = levelHeight;
+  }
+
+  return levels;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncTexture::uploadLevels(
+    int width, int height, std::vector<std::vector<uint8_t>> const& levels) {
+  for (size_t i = 0; i < levels.size(); ++i) {
+    width  = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), GL_RGBA, width, height, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, levels[i].data());
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AsyncTexture::upload(Image const& image) {
+  CSP_STARS_TRACE_ZONE("Upload texture");
+
+  mTexture = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+  mTexture->Bind();
+  mTexture->UploadTexture(image.mWidth, image.mHeight, image.mPixels.get(),
+      mMipmaps == Mipmaps::eBox, GL_RGBA, GL_UNSIGNED_BYTE);
+
+  if (mMipmaps == Mipmaps::ePointSpread) {
+    uploadLevels(image.mWidth, image.mHeight, image.mLevels);
+  }
+
+  // Textures which are mostly sampled at a fraction of their resolution (sky domes at a wide field
+  // of view, star sprites) read far fewer texels with trilinear filtering.
+  mTexture->SetMinFilter(mMipmaps != Mipmaps::eNone ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  mTexture->SetMagFilter(GL_LINEAR);
+  mTexture->SetWrapS(mWrapS);
+  mTexture->SetWrapT(GL_CLAMP_TO_EDGE);
+  mTexture->Unbind();
+
+  // A full mipmap chain adds a third to the size of the base level.
+  mSizeInBytes = static_cast<size_t>(image.mWidth) * static_cast<size_t>(image.mHeight) * 4;
+  if (mMipmaps != Mipmaps::eNone) {
+    mSizeInBytes += mSizeInBytes / 3;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
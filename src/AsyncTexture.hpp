@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_ASYNC_TEXTURE_HPP
+#define CSP_STARS_ASYNC_TEXTURE_HPP
+
+#include <VistaOGLExt/VistaTexture.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace csp::stars {
+
+/// Loads a texture without blocking the render thread. The image file is decoded on a worker
+/// thread right away; several AsyncTextures hence decode their files concurrently. The upload to
+/// the GPU happens on the render thread in the first call to getTexture() after the decoding has
+/// finished. Files which cannot be decoded this way (e.g. TIFF images) are loaded synchronously
+/// with cs::graphics::TextureLoader instead.
+class AsyncTexture {
+ public:
+  /// How the mipmap chain of the texture is created.
+  enum class Mipmaps {
+    eNone,        ///< Only the base level is created.
+    eBox,         ///< The levels are created with glGenerateMipmap(). Meant for sky-dome textures.
+    ePointSpread, ///< The levels are pre-filtered on the decoding thread, see uploadPointSpread().
+  };
+
+  /// Starts decoding the given file in the background. If mipmaps are created, they are used for
+  /// minification. wrapS is the horizontal wrap mode, vertically the texture is always clamped.
+  AsyncTexture(std::string file, Mipmaps mipmaps, GLenum wrapS = GL_CLAMP_TO_EDGE);
+
+  /// Waits for the decoding to finish.
+  ~AsyncTexture();
+
+  AsyncTexture(AsyncTexture const& other) = delete;
+  AsyncTexture(AsyncTexture&& other)      = delete;
+  AsyncTexture& operator=(AsyncTexture const& other) = delete;
+  AsyncTexture& operator=(AsyncTexture&& other) = delete;
+
+  /// Returns nullptr as long as the image is decoded or if loading failed. This has to be called on
+  /// the render thread, as it uploads the decoded image once it is available.
+  VistaTexture* getTexture();
+
+  /// Returns the estimated video memory used by the texture, including its mipmaps. This is zero as
+  /// long as the texture has not been uploaded.
+  size_t getSizeInBytes() const;
+
+  /// Uploads the given RGBA star sprite to the currently bound 2D texture together with a mipmap
+  /// chain in which each level is the previous one convolved with a binomial filter and decimated
+  /// by two. Unlike the box filter of glGenerateMipmap(), this approximates convolving the point
+  /// spread function with a Gaussian which grows with the texel footprint of the level. As the
+  /// filter is normalized, all levels have the same mean intensity, so the flux of a sprite does
+  /// not change when it is shrunk.
+  static void uploadPointSpread(int width, int height, uint8_t const* pixels);
+
+ private:
+  /// A decoded RGBA image. mPixels is null if the file could not be decoded. mLevels contains the
+  /// mipmap levels below the base level if they are pre-filtered.
+  struct Image {
+    int                                       mWidth  = 0;
+    int                                       mHeight = 0;
+    std::unique_ptr<uint8_t, void (*)(void*)> mPixels{nullptr, nullptr};
+    std::vector<std::vector<uint8_t>>         mLevels;
+  };
+
+  static Image decode(std::string const& file, Mipmaps mipmaps);
+
+  /// Computes the levels uploaded by uploadPointSpread(), starting with level one.
+  static std::vector<std::vector<uint8_t>> filterPointSpread(
+      int width, int height, uint8_t const* pixels);
+
+  /// Uploads the given levels to the currently bound 2D texture, starting with level one.
+  static void uploadLevels(int width, int height, std::vector<std::vector<uint8_t>> const& levels);
+
+  void upload(Image const& image);
+
+  std::string                   mFile;
+  Mipmaps                       mMipmaps;
+  GLenum                        mWrapS;
+  std::future<Image>            mDecodeTask;
+  std::unique_ptr<VistaTexture> mTexture;
+  size_t                        mSizeInBytes = 0;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_ASYNC_TEXTURE_HPP
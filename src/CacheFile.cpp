@@ -0,0 +1,449 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CacheFile.hpp"
+
+#include "logger.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The header consists of the magic number, four bytes of padding, the payload size and the
+// payload checksum.
+const uint32_t cMagic      = 0x53525453; // "STRS"
+const size_t   cHeaderSize = 24;
+
+// The writer hashes its buffer whenever it is flushed. The buffer is only flushed when it is full
+// (or at the very end), hence in multiples of eight bytes. So the reader can hash the entire
+// payload at once and gets the same result.
+const size_t   cBufferSize   = 1 << 20;
+const uint64_t cChecksumSeed = 0xcbf29ce484222325ULL;
+
+// The reader reads and hashes the payload in chunks of this size, checking for cancellation in
+// between. It is a multiple of eight bytes for the same reason as above.
+const size_t cReadChunkSize = 16 << 20;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A fast, non-cryptographic checksum which processes eight bytes at a time. It is meant to detect
+// truncated or partially written files, not malicious modifications.
+uint64_t updateChecksum(uint64_t hash, uint8_t const* data, size_t size) {
+  const uint64_t prime = 0x100000001b3ULL;
+  size_t         i     = 0;
+
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word{};
+    std::memcpy(&word, data + i, sizeof(uint64_t));
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29U;
+  }
+
+  for (; i < size; ++i) {
+    hash = (hash ^ data[i]) * prime;
+  }
+
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reads the payload size and checksum from the header of the given file. Returns false if the file
+// does not exist or has an invalid header.
+bool readHeader(std::string const& file, uint64_t& payloadSize, uint64_t& checksum) {
+  std::ifstream stream(file, std::ios::in | std::ios::binary);
+  if (!stream.is_open()) {
+    return false;
+  }
+
+  std::array<uint8_t, cHeaderSize> header{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (!stream.read(reinterpret_cast<char*>(header.data()), cHeaderSize)) {
+    return false;
+  }
+
+  uint32_t magic{};
+  std::memcpy(&magic, header.data(), sizeof(uint32_t));
+  std::memcpy(&payloadSize, header.data() + 8, sizeof(uint64_t));
+  std::memcpy(&checksum, header.data() + 16, sizeof(uint64_t));
+
+  return magic == cMagic;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// An exclusive advisory lock on a file. The lock file is created if it does not exist. The lock is
+// held until the object is destroyed. Threads of the same process are serialized with a mutex, as
+// POSIX record locks are held per process.
+class FileLock {
+ public:
+  explicit FileLock(std::string const& file)
+      : mThreadLock(getMutex()) {
+#ifdef _WIN32
+    mHandle = CreateFileA(file.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mHandle != INVALID_HANDLE_VALUE) {
+      OVERLAPPED overlapped{};
+      mLocked =
+          LockFileEx(mHandle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+    }
+#else
+    mFile = open(file.c_str(), O_RDWR | O_CREAT, 0666); // NOLINT(hicpp-signed-bitwise)
+    if (mFile >= 0) {
+      struct flock lock {};
+      lock.l_type   = F_WRLCK;
+      lock.l_whence = SEEK_SET;
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+      mLocked = fcntl(mFile, F_SETLKW, &lock) == 0;
+    }
+#endif
+
+    if (!mLocked) {
+      logger().warn("Failed to lock '{}'. Writing the star cache anyway.", file);
+    }
+  }
+
+  ~FileLock() {
+#ifdef _WIN32
+    if (mHandle != INVALID_HANDLE_VALUE) {
+      if (mLocked) {
+        OVERLAPPED overlapped{};
+        UnlockFileEx(mHandle, 0, MAXDWORD, MAXDWORD, &overlapped);
+      }
+      CloseHandle(mHandle);
+    }
+#else
+    if (mFile >= 0) {
+      close(mFile);
+    }
+#endif
+  }
+
+  FileLock(FileLock const& other) = delete;
+  FileLock(FileLock&& other)      = delete;
+  FileLock& operator=(FileLock const& other) = delete;
+  FileLock& operator=(FileLock&& other) = delete;
+
+ private:
+  static std::mutex& getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::lock_guard<std::mutex> mThreadLock;
+  bool                        mLocked = false;
+
+#ifdef _WIN32
+  HANDLE mHandle = INVALID_HANDLE_VALUE;
+#else
+  int mFile = -1;
+#endif
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Makes sure that the contents of the given file are physically written to disk.
+void syncFile(std::string const& file) {
+#ifndef _WIN32
+  int fd = open(file.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Replaces the target file by the source file. This is atomic on POSIX and NTFS.
+bool replaceFile(std::string const& source, std::string const& target) {
+#ifdef _WIN32
+  return MoveFileExA(source.c_str(), target.c_str(),
+             MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CacheWriter::CacheWriter(std::string targetFile)
+    : mTargetFile(std::move(targetFile))
+    , mTempFile(mTargetFile + "." + std::to_string(getProcessId()) + ".tmp")
+    , mFile(mTempFile, std::ios::out | std::ios::binary | std::ios::trunc)
+    , mChecksum(cChecksumSeed) {
+
+  // Reserve space for the header, it is written in commit().
+  std::array<char, cHeaderSize> header{};
+  mFile.write(header.data(), cHeaderSize);
+
+  mBuffer.reserve(cBufferSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CacheWriter::~CacheWriter() {
+  if (!mCommitted) {
+    mFile.close();
+    std::remove(mTempFile.c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheWriter::isGood() const {
+  return mFile.is_open() && mFile.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CacheWriter::writeUInt32(uint32_t value) {
+  writeRaw(&value, sizeof(uint32_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CacheWriter::writeInt64(int64_t value) {
+  writeRaw(&value, sizeof(int64_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CacheWriter::writeString(std::string const& value) {
+  writeUInt32(static_cast<uint32_t>(value.size()));
+  writeRaw(value.data(), value.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CacheWriter::writeRaw(void const* data, size_t size) {
+  auto const* bytes = static_cast<uint8_t const*>(data);
+
+  while (size > 0) {
+    size_t chunk = std::min(size, cBufferSize - mBuffer.size());
+    mBuffer.insert(mBuffer.end(), bytes, bytes + chunk);
+    bytes += chunk;
+    size -= chunk;
+
+    if (mBuffer.size() >= cBufferSize) {
+      flush();
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CacheWriter::flush() {
+  mChecksum = updateChecksum(mChecksum, mBuffer.data(), mBuffer.size());
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  mFile.write(reinterpret_cast<char const*>(mBuffer.data()),
+      static_cast<std::streamsize>(mBuffer.size()));
+  mPayloadSize += mBuffer.size();
+  mBuffer.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheWriter::commit() {
+  if (mCommitted || !isGood()) {
+    return false;
+  }
+
+  flush();
+
+  std::array<uint8_t, cHeaderSize> header{};
+  std::memcpy(header.data(), &cMagic, sizeof(uint32_t));
+  std::memcpy(header.data() + 8, &mPayloadSize, sizeof(uint64_t));
+  std::memcpy(header.data() + 16, &mChecksum, sizeof(uint64_t));
+
+  mFile.seekp(0);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  mFile.write(reinterpret_cast<char const*>(header.data()), cHeaderSize);
+  mFile.close();
+
+  if (mFile.fail()) {
+    logger().error("Failed to write star cache '{}'!", mTempFile);
+    return false;
+  }
+
+  syncFile(mTempFile);
+
+  FileLock lock(mTargetFile + ".lock");
+
+  // If another process has written the same data in the meantime, keep its file.
+  uint64_t existingSize{};
+  uint64_t existingChecksum{};
+  if (readHeader(mTargetFile, existingSize, existingChecksum) && existingSize == mPayloadSize &&
+      existingChecksum == mChecksum) {
+    std::remove(mTempFile.c_str());
+    mCommitted = true;
+    return true;
+  }
+
+  if (!replaceFile(mTempFile, mTargetFile)) {
+    logger().error("Failed to move star cache '{}' to '{}'!", mTempFile, mTargetFile);
+    return false;
+  }
+
+  mCommitted = true;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CacheReader::CacheReader(std::string const& file, std::atomic<bool> const* cancelled) {
+  std::ifstream stream(file, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!stream.is_open()) {
+    return;
+  }
+
+  auto size = static_cast<size_t>(stream.tellg());
+  if (size < cHeaderSize) {
+    return;
+  }
+
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto readChunk = [&stream, this](size_t offset, size_t chunkSize) {
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(mData.data() + offset),
+        static_cast<std::streamsize>(chunkSize)));
+  };
+
+  mData.resize(size);
+  stream.seekg(0, std::ios::beg);
+  if (!readChunk(0, cHeaderSize)) {
+    return;
+  }
+
+  uint32_t magic{};
+  uint64_t payloadSize{};
+  uint64_t checksum{};
+  std::memcpy(&magic, mData.data(), sizeof(uint32_t));
+  std::memcpy(&payloadSize, mData.data() + 8, sizeof(uint64_t));
+  std::memcpy(&checksum, mData.data() + 16, sizeof(uint64_t));
+
+  if (magic != cMagic || payloadSize != size - cHeaderSize) {
+    logger().warn("Ignoring star cache '{}': The file is truncated.", file);
+    return;
+  }
+
+  uint64_t actualChecksum = cChecksumSeed;
+
+  for (size_t offset = cHeaderSize; offset < size; offset += cReadChunkSize) {
+    if (cancelled && *cancelled) {
+      return;
+    }
+
+    size_t chunkSize = std::min(cReadChunkSize, size - offset);
+    if (!readChunk(offset, chunkSize)) {
+      return;
+    }
+
+    actualChecksum = updateChecksum(actualChecksum, mData.data() + offset, chunkSize);
+  }
+
+  if (checksum != actualChecksum) {
+    logger().warn("Ignoring star cache '{}': The checksum does not match.", file);
+    return;
+  }
+
+  mOffset = cHeaderSize;
+  mValid  = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheReader::isValid() const {
+  return mValid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t CacheReader::getRemainingSize() const {
+  return mValid ? mData.size() - mOffset : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheReader::readUInt32(uint32_t& value) {
+  return readRaw(&value, sizeof(uint32_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheReader::readInt64(int64_t& value) {
+  return readRaw(&value, sizeof(int64_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheReader::readString(std::string& value) {
+  uint32_t length{};
+  if (!readUInt32(length) || length > getRemainingSize()) {
+    return false;
+  }
+
+  value.resize(length);
+  return readRaw(value.data(), length);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheReader::readRaw(void* data, size_t size) {
+  if (size > getRemainingSize()) {
+    return false;
+  }
+
+  // Empty vectors may pass a null pointer, which memcpy() must not be called with.
+  if (size == 0) {
+    return true;
+  }
+
+  std::memcpy(data, mData.data() + mOffset, size);
+  mOffset += size;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t getChecksum(std::string const& data) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return updateChecksum(cChecksumSeed, reinterpret_cast<uint8_t const*>(data.data()), data.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int getProcessId() {
+#ifdef _WIN32
+  return static_cast<int>(GetCurrentProcessId());
+#else
+  return static_cast<int>(getpid());
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
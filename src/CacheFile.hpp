@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_CACHE_FILE_HPP
+#define CSP_STARS_CACHE_FILE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace csp::stars {
+
+/// Writes a binary cache file. The data is streamed to a temporary file next to the target file.
+/// It is preceded by a header containing a magic number, the size and a checksum of the payload.
+/// Only when commit() is called, the temporary file is renamed to the target file. This happens
+/// while holding an advisory lock on the target file, so that multiple processes writing the
+/// same cache file (e.g. cluster nodes on a shared file system) do not interfere. If commit() is
+/// not called, the temporary file is removed in the destructor.
+class CacheWriter {
+ public:
+  explicit CacheWriter(std::string targetFile);
+  ~CacheWriter();
+
+  CacheWriter(CacheWriter const& other) = delete;
+  CacheWriter(CacheWriter&& other)      = delete;
+  CacheWriter& operator=(CacheWriter const& other) = delete;
+  CacheWriter& operator=(CacheWriter&& other) = delete;
+
+  /// Returns false if the temporary file could not be created or if writing failed.
+  bool isGood() const;
+
+  void writeUInt32(uint32_t value);
+  void writeInt64(int64_t value);
+  void writeString(std::string const& value);
+  void writeRaw(void const* data, size_t size);
+
+  template <typename T>
+  void writeVector(std::vector<T> const& values) {
+    writeRaw(values.data(), values.size() * sizeof(T));
+  }
+
+  /// Finalizes the header and atomically replaces the target file with the temporary file. If
+  /// another process has written a valid target file in the meantime, this file is kept instead.
+  /// Returns false if anything went wrong. The target file is never left in a truncated state.
+  bool commit();
+
+ private:
+  void flush();
+
+  std::string          mTargetFile;
+  std::string          mTempFile;
+  std::ofstream        mFile;
+  std::vector<uint8_t> mBuffer;
+  uint64_t             mPayloadSize = 0;
+  uint64_t             mChecksum;
+  bool                 mCommitted = false;
+};
+
+/// Reads a binary cache file written by CacheWriter. The whole file is read into memory and the
+/// payload size and checksum are verified before any data can be read. All read methods return
+/// false if there is not enough data left.
+class CacheReader {
+ public:
+  /// Reads and verifies the entire file. If cancelled is given and becomes true while the file is
+  /// read, the reader stops early and is invalid.
+  explicit CacheReader(std::string const& file, std::atomic<bool> const* cancelled = nullptr);
+
+  /// Returns false if the file does not exist, is truncated or the checksum does not match.
+  bool isValid() const;
+
+  /// Returns the number of payload bytes which have not been read yet.
+  size_t getRemainingSize() const;
+
+  bool readUInt32(uint32_t& value);
+  bool readInt64(int64_t& value);
+  bool readString(std::string& value);
+  bool readRaw(void* data, size_t size);
+
+  template <typename T>
+  bool readVector(std::vector<T>& values, size_t count) {
+    if (count * sizeof(T) > getRemainingSize()) {
+      return false;
+    }
+    values.resize(count);
+    return readRaw(values.data(), count * sizeof(T));
+  }
+
+ private:
+  std::vector<uint8_t> mData;
+  size_t               mOffset = 0;
+  bool                 mValid  = false;
+};
+
+/// Returns the checksum of the cache files for the given data. In contrast to std::hash, it does
+/// not depend on the standard library, so it can be used for names of files and shared memory
+/// segments which are used by several processes and hosts.
+uint64_t getChecksum(std::string const& data);
+
+/// Returns the ID of this process. It is part of the names of temporary files, so that several
+/// processes can write the same target file at once.
+int getProcessId();
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_CACHE_FILE_HPP
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include <doctest.h>
+
+#include "CacheFile.hpp"
+
+#include <filesystem>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CacheWriter / csp::stars::CacheReader") {
+  std::string file = (std::filesystem::temp_directory_path() / "csp-stars-test.dat").string();
+  std::filesystem::remove(file);
+
+  // A segment with a header and some star columns, similar to Stars::writeStarCache().
+  std::vector<float> magnitudes = {-1.46F, 0.03F, 12.5F};
+  std::vector<float> parallaxes = {379.21F, 130.23F, 0.F};
+
+  {
+    CacheWriter writer(file);
+    REQUIRE(writer.isGood());
+
+    writer.writeUInt32(9);
+    writer.writeInt64(-123456789012LL);
+    writer.writeString("hipparcos.dat");
+    writer.writeUInt32(static_cast<uint32_t>(magnitudes.size()));
+    writer.writeVector(magnitudes);
+    writer.writeVector(parallaxes);
+
+    // Nothing is visible before the segment has been committed.
+    CHECK_FALSE(std::filesystem::exists(file));
+    CHECK(writer.commit());
+  }
+
+  CacheReader reader(file);
+  REQUIRE(reader.isValid());
+
+  uint32_t    version = 0;
+  int64_t     time    = 0;
+  std::string catalog;
+  uint32_t    count = 0;
+  CHECK(reader.readUInt32(version));
+  CHECK(reader.readInt64(time));
+  CHECK(reader.readString(catalog));
+  CHECK(reader.readUInt32(count));
+  CHECK(version == 9);
+  CHECK(time == -123456789012LL);
+  CHECK(catalog == "hipparcos.dat");
+  REQUIRE(count == magnitudes.size());
+
+  std::vector<float> readMagnitudes;
+  std::vector<float> readParallaxes;
+  CHECK(reader.readVector(readMagnitudes, count));
+  CHECK(reader.readVector(readParallaxes, count));
+  CHECK(readMagnitudes == magnitudes);
+  CHECK(readParallaxes == parallaxes);
+
+  CHECK(reader.getRemainingSize() == 0);
+  CHECK_FALSE(reader.readUInt32(version));
+
+  // A truncated segment is rejected as a whole.
+  std::filesystem::resize_file(file, std::filesystem::file_size(file) - 1);
+  CHECK_FALSE(CacheReader(file).isValid());
+
+  std::filesystem::remove(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CacheWriter without commit") {
+  std::string file = (std::filesystem::temp_directory_path() / "csp-stars-test.dat").string();
+  std::filesystem::remove(file);
+
+  {
+    CacheWriter writer(file);
+    writer.writeUInt32(1);
+  }
+
+  CHECK_FALSE(std::filesystem::exists(file));
+  CHECK_FALSE(CacheReader(file).isValid());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::getChecksum") {
+  CHECK(getChecksum("mag<10;") == getChecksum("mag<10;"));
+  CHECK(getChecksum("mag<10;") != getChecksum("mag<11;"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
@@ -0,0 +1,195 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ClusterTransport.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The data file is written before the message file. Hence a message always refers to a complete
+// data file, though the data file may already be newer than the message. This is detected by the
+// receiver, as the message is also stored in the data file.
+const char* cDataFile    = "stars.dat";
+const char* cMessageFile = "stars.msg";
+const char* cReadyPrefix = "ready_";
+
+std::string readFile(std::filesystem::path const& file) {
+  std::ifstream     stream(file, std::ios::binary);
+  std::stringstream content;
+  content << stream.rdbuf();
+  return content.str();
+}
+
+// Writes to a temporary file which is then renamed, so that readers never see incomplete files.
+bool writeFileAtomically(std::filesystem::path const& file, std::string const& content) {
+  std::filesystem::path temp = file;
+  temp += ".tmp";
+
+  {
+    std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+    stream << content;
+    if (!stream.good()) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temp, file, error);
+  return !error;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DirectoryClusterTransport::DirectoryClusterTransport(std::string directory, std::string nodeName,
+    std::string session, int numNodes, bool isMaster)
+    : mDirectory(std::move(directory))
+    , mNodeName(std::move(nodeName))
+    , mSession(std::move(session))
+    , mNumNodes(numNodes)
+    , mIsMaster(isMaster) {
+  // The node name becomes part of a file name.
+  std::replace_if(
+      mNodeName.begin(), mNodeName.end(), [](char c) { return std::isalnum(c) == 0; }, '_');
+
+  std::error_code error;
+  std::filesystem::create_directories(mDirectory, error);
+
+  // Remove the files of earlier sessions, including incomplete temporary files. The other nodes
+  // cannot tell whether the master has already sent the current data, so they only remove their
+  // own arrival.
+  std::vector<std::filesystem::path> outdated;
+
+  for (auto const& entry : std::filesystem::directory_iterator(mDirectory, error)) {
+    std::string name = entry.path().filename().string();
+
+    if (entry.path().extension() == ".tmp") {
+      name = entry.path().stem().string();
+    }
+
+    bool isOwn    = name == cReadyPrefix + mNodeName;
+    bool isShared = name == cDataFile || name == cMessageFile || name.rfind(cReadyPrefix, 0) == 0;
+
+    if (isOwn || (mIsMaster && isShared)) {
+      outdated.push_back(entry.path());
+    }
+  }
+
+  for (auto const& file : outdated) {
+    std::filesystem::remove(file, error);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DirectoryClusterTransport::isMaster() const {
+  return mIsMaster;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& DirectoryClusterTransport::getSession() const {
+  return mSession;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DirectoryClusterTransport::send(std::string const& file, std::string const& message) {
+  std::filesystem::path directory(mDirectory);
+  std::filesystem::path temp = directory / cDataFile;
+  temp += ".tmp";
+
+  std::error_code error;
+  std::filesystem::copy_file(
+      file, temp, std::filesystem::copy_options::overwrite_existing, error);
+
+  if (!error) {
+    std::filesystem::rename(temp, directory / cDataFile, error);
+  }
+
+  if (error) {
+    logger().error("Failed to send '{}' to '{}': {}", file, mDirectory, error.message());
+    return false;
+  }
+
+  if (!writeFileAtomically(directory / cMessageFile, message)) {
+    logger().error("Failed to send '{}' to '{}': Cannot write message!", file, mDirectory);
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DirectoryClusterTransport::receive(std::string& file, std::string& message) {
+  message = peek();
+  file    = (std::filesystem::path(mDirectory) / cDataFile).string();
+
+  return !message.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string DirectoryClusterTransport::peek() {
+  std::filesystem::path file = std::filesystem::path(mDirectory) / cMessageFile;
+
+  std::error_code error;
+  if (!std::filesystem::exists(file, error)) {
+    return "";
+  }
+
+  return readFile(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DirectoryClusterTransport::arrive(std::string const& token) {
+  std::filesystem::path file = std::filesystem::path(mDirectory) / (cReadyPrefix + mNodeName);
+
+  if (!writeFileAtomically(file, token)) {
+    logger().error("Failed to write '{}'!", file.string());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DirectoryClusterTransport::allArrived(std::string const& token) {
+  int             numArrived = 0;
+  std::error_code error;
+
+  for (auto const& entry : std::filesystem::directory_iterator(mDirectory, error)) {
+    std::string name = entry.path().filename().string();
+
+    if (name.rfind(cReadyPrefix, 0) == 0 && entry.path().extension() != ".tmp" &&
+        readFile(entry.path()) == token) {
+      ++numArrived;
+    }
+  }
+
+  return numArrived >= mNumNodes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
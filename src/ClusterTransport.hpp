@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_CLUSTER_TRANSPORT_HPP
+#define CSP_STARS_CLUSTER_TRANSPORT_HPP
+
+#include <string>
+
+namespace csp::stars {
+
+/// Distributes the star data from the master node of a cluster to all other nodes, see
+/// Stars::setClusterTransport(). The master sends a file together with a short message which
+/// identifies its content; the other nodes poll for it. Afterwards, all nodes synchronize with a
+/// barrier. All methods are called from the loading thread and must not block for long, so that
+/// loading can be cancelled.
+class ClusterTransport {
+ public:
+  virtual ~ClusterTransport() = default;
+
+  /// Returns true on the node which loads the catalogs.
+  virtual bool isMaster() const = 0;
+
+  /// Returns an ID which is the same on all nodes of the current session and which differs between
+  /// sessions. It is part of all messages, so that data of earlier sessions which is still
+  /// available to the transport is never mistaken for current data.
+  virtual std::string const& getSession() const = 0;
+
+  /// Master only: Makes the given file and message available to all other nodes. A previously
+  /// sent file is replaced. Returns false if sending failed.
+  virtual bool send(std::string const& file, std::string const& message) = 0;
+
+  /// Other nodes only: Returns the path to a local copy of the most recently sent file and its
+  /// message. The file may be replaced by a newer one at any time, hence it has to be checked
+  /// whether it matches the message after reading. Returns false if nothing has been sent yet.
+  virtual bool receive(std::string& file, std::string& message) = 0;
+
+  /// Returns the message of the most recently sent file without receiving the file. Returns an
+  /// empty string if nothing has been sent yet.
+  virtual std::string peek() = 0;
+
+  /// Announces that this node is ready to show the star data identified by the given token.
+  virtual void arrive(std::string const& token) = 0;
+
+  /// Returns true once all nodes have arrived with the given token.
+  virtual bool allArrived(std::string const& token) = 0;
+};
+
+/// A ClusterTransport which exchanges files in a directory which is accessible by all nodes, for
+/// example on a network file system. For testing, several processes on one host can use a local
+/// directory. Files are written to temporary files first and then renamed, so that the other nodes
+/// never see incomplete files. The master removes the files of earlier sessions when it is
+/// created. The session ID has to be distributed to all nodes by other means, for example with
+/// the data sync of the ViSTA cluster mode.
+class DirectoryClusterTransport : public ClusterTransport {
+ public:
+  /// The node name has to be unique in the cluster and is used to name the files of this node.
+  DirectoryClusterTransport(std::string directory, std::string nodeName, std::string session,
+      int numNodes, bool isMaster);
+
+  bool               isMaster() const override;
+  std::string const& getSession() const override;
+  bool               send(std::string const& file, std::string const& message) override;
+  bool               receive(std::string& file, std::string& message) override;
+  std::string        peek() override;
+  void               arrive(std::string const& token) override;
+  bool               allArrived(std::string const& token) override;
+
+ private:
+  std::string mDirectory;
+  std::string mNodeName;
+  std::string mSession;
+  int         mNumNodes;
+  bool        mIsMaster;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_CLUSTER_TRANSPORT_HPP
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CsvTokenizer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string_view trim(std::string_view field) {
+  while (!field.empty() && std::isspace(static_cast<unsigned char>(field.front()))) {
+    field.remove_prefix(1);
+  }
+
+  while (!field.empty() && std::isspace(static_cast<unsigned char>(field.back()))) {
+    field.remove_suffix(1);
+  }
+
+  return field;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+    return std::tolower(static_cast<unsigned char>(x)) ==
+           std::tolower(static_cast<unsigned char>(y));
+  });
+}
+
+// In contrast to strtof(), std::from_chars() does not depend on the locale and fails for values
+// which are out of range. It does not accept a leading plus sign, hence this is skipped.
+template <typename T>
+bool parseNumber(std::string_view field, T& out) {
+  field = trim(field);
+
+  if (field.size() > 1 && field.front() == '+' && field[1] != '-') {
+    field.remove_prefix(1);
+  }
+
+  auto result = std::from_chars(field.data(), field.data() + field.size(), out);
+
+  return !field.empty() && result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string_view> const& CsvTokenizer::split(std::string_view line) {
+  mFields.clear();
+
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+
+  size_t pos = 0;
+
+  while (true) {
+    if (pos < line.size() && line[pos] == '"') {
+      // The field ends at the first quote which is not followed by another quote. Anything
+      // between the closing quote and the next comma is ignored.
+      size_t start = pos + 1;
+      size_t end   = start;
+
+      while (end < line.size()) {
+        if (line[end] == '"') {
+          if (end + 1 < line.size() && line[end + 1] == '"') {
+            end += 2;
+            continue;
+          }
+          break;
+        }
+        ++end;
+      }
+
+      mFields.push_back(line.substr(start, end - start));
+      pos = line.find(',', end);
+    } else {
+      size_t end = line.find(',', pos);
+      mFields.push_back(line.substr(pos, end == std::string_view::npos ? end : end - pos));
+      pos = end;
+    }
+
+    if (pos == std::string_view::npos) {
+      break;
+    }
+
+    ++pos;
+  }
+
+  return mFields;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CsvTokenizer::setHeader(std::string_view line) {
+  mHeader.clear();
+
+  for (auto const& field : split(line)) {
+    mHeader.emplace_back(trim(field));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CsvTokenizer::getColumn(std::initializer_list<std::string_view> names) const {
+  for (auto const& name : names) {
+    for (size_t i = 0; i < mHeader.size(); ++i) {
+      if (equalsIgnoreCase(mHeader[i], name)) {
+        return static_cast<int>(i);
+      }
+    }
+  }
+
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string_view CsvTokenizer::getField(int column) const {
+  if (column < 0 || static_cast<size_t>(column) >= mFields.size()) {
+    return {};
+  }
+
+  return mFields[column];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string CsvTokenizer::unescape(std::string_view field) {
+  std::string result;
+  result.reserve(field.size());
+
+  for (size_t i = 0; i < field.size(); ++i) {
+    result.push_back(field[i]);
+
+    if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"') {
+      ++i;
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CsvTokenizer::parseFloat(std::string_view field, float& out) {
+  return parseNumber(field, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CsvTokenizer::parseUInt(std::string_view field, uint32_t& out) {
+  return parseNumber(field, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_CSV_TOKENIZER_HPP
+#define CSP_STARS_CSV_TOKENIZER_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace csp::stars {
+
+/// Splits lines of comma-separated values into fields. Fields may be enclosed in double quotes,
+/// in which case they may contain commas and quotes are escaped by doubling them. Quoted fields
+/// spanning multiple lines are not supported. The fields are views into the given line, so no
+/// memory is allocated once the field vector has grown to the number of columns. Columns can be
+/// looked up by their name in the header line.
+class CsvTokenizer {
+ public:
+  /// Splits the given line into fields. The line must outlive the returned fields. The outer
+  /// quotes of quoted fields are removed, doubled quotes inside are kept as they are. A trailing
+  /// carriage return is ignored.
+  std::vector<std::string_view> const& split(std::string_view line);
+
+  /// Stores the fields of the given line as the column names. The names are compared case
+  /// insensitively.
+  void setHeader(std::string_view line);
+
+  /// Returns the index of the first column matching one of the given names, or -1 if there is
+  /// none.
+  int getColumn(std::initializer_list<std::string_view> names) const;
+
+  /// Returns the field of the given column of the most recently split line. This is empty if the
+  /// column is -1 or if the line has fewer fields.
+  std::string_view getField(int column) const;
+
+  /// Returns the given field with doubled quotes replaced by single quotes.
+  static std::string unescape(std::string_view field);
+
+  /// Parse the given field, ignoring leading and trailing whitespace. The decimal separator is
+  /// always a point, regardless of the locale. Return false if the field is empty, is not
+  /// entirely a number or if the number does not fit into the type, e.g. negative numbers or
+  /// numbers larger than 4294967295 for parseUInt().
+  static bool parseFloat(std::string_view field, float& out);
+  static bool parseUInt(std::string_view field, uint32_t& out);
+
+ private:
+  std::vector<std::string_view> mFields;
+  std::vector<std::string>      mHeader;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_CSV_TOKENIZER_HPP
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <doctest.h>
+
+#include "CsvTokenizer.hpp"
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CsvTokenizer::split") {
+  CsvTokenizer tokenizer;
+
+  auto const& fields = tokenizer.split("1,\"Alpha, \"\"Beta\"\"\",,3.5\r");
+  REQUIRE(fields.size() == 4);
+  CHECK(fields[0] == "1");
+  CHECK(fields[1] == "Alpha, \"\"Beta\"\"");
+  CHECK(fields[2].empty());
+  CHECK(fields[3] == "3.5");
+
+  CHECK(CsvTokenizer::unescape(fields[1]) == "Alpha, \"Beta\"");
+  CHECK(tokenizer.split("").size() == 1);
+  CHECK(tokenizer.split("a,").size() == 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CsvTokenizer::getColumn") {
+  CsvTokenizer tokenizer;
+  tokenizer.setHeader("id, Proper ,RA,dec");
+
+  CHECK(tokenizer.getColumn({"proper"}) == 1);
+  CHECK(tokenizer.getColumn({"vmag", "ra"}) == 2);
+  CHECK(tokenizer.getColumn({"mag"}) == -1);
+
+  tokenizer.split("7,Sirius");
+  CHECK(tokenizer.getField(1) == "Sirius");
+  CHECK(tokenizer.getField(3).empty());
+  CHECK(tokenizer.getField(-1).empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CsvTokenizer::parseFloat") {
+  float value = 0.F;
+
+  CHECK(CsvTokenizer::parseFloat(" -1.5 ", value));
+  CHECK(value == -1.5F);
+  CHECK(CsvTokenizer::parseFloat("+2e3", value));
+  CHECK(value == 2000.F);
+
+  CHECK_FALSE(CsvTokenizer::parseFloat("", value));
+  CHECK_FALSE(CsvTokenizer::parseFloat("1,5", value));
+  CHECK_FALSE(CsvTokenizer::parseFloat("1.5 mag", value));
+  CHECK_FALSE(CsvTokenizer::parseFloat("+-1", value));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::CsvTokenizer::parseUInt") {
+  uint32_t value = 0;
+
+  CHECK(CsvTokenizer::parseUInt("32349", value));
+  CHECK(value == 32349);
+  CHECK(CsvTokenizer::parseUInt("4294967295", value));
+  CHECK(value == 4294967295U);
+
+  CHECK_FALSE(CsvTokenizer::parseUInt("4294967296", value));
+  CHECK_FALSE(CsvTokenizer::parseUInt("-1", value));
+  CHECK_FALSE(CsvTokenizer::parseUInt("1.0", value));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DebugView.hpp"
+
+#include "logger.hpp"
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int   DebugView::cTileSize      = 16;
+const int   DebugView::cHistogramBins = 100;
+const float DebugView::cHistogramMin  = -5.F;
+const float DebugView::cHistogramMax  = 20.F;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DebugView::~DebugView() {
+  for (auto& target : mTargets) {
+    if (target.mFramebuffer != 0) {
+      glDeleteFramebuffers(1, &target.mFramebuffer);
+      glDeleteTextures(1, &target.mTexture);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DebugView::bindTarget(Target target, int viewportWidth, int viewportHeight) {
+  auto& t = mTargets.at(static_cast<size_t>(target));
+
+  int width  = viewportWidth;
+  int height = viewportHeight;
+
+  if (target == Target::eTiles) {
+    width  = (viewportWidth + cTileSize - 1) / cTileSize;
+    height = (viewportHeight + cTileSize - 1) / cTileSize;
+  } else if (target == Target::eHistogram) {
+    width  = cHistogramBins;
+    height = 1;
+  }
+
+  if (t.mFramebuffer == 0) {
+    glGenFramebuffers(1, &t.mFramebuffer);
+    glGenTextures(1, &t.mTexture);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, t.mFramebuffer);
+
+  // The textures are only reallocated if the viewport size changes.
+  if (t.mWidth != width || t.mHeight != height) {
+    t.mWidth  = width;
+    t.mHeight = height;
+
+    glBindTexture(GL_TEXTURE_2D, t.mTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t.mTexture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      logger().warn("Failed to create render target for the debug view!");
+    }
+  }
+
+  glViewport(0, 0, width, height);
+  glClearColor(0.F, 0.F, 0.F, 0.F);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DebugView::draw(std::array<int, 4> const& viewport, float minMagnitude, float maxMagnitude) {
+  if (mShaderDirty) {
+    mShader = VistaGLSLShader();
+    mShader.InitVertexShaderFromString(cDebugViewVert);
+    mShader.InitFragmentShaderFromString(cDebugViewFrag);
+    mShader.Link();
+
+    mShaderDirty = false;
+  }
+
+  mShader.Bind();
+
+  for (size_t i = 0; i < mTargets.size(); ++i) {
+    glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + i));
+    glBindTexture(GL_TEXTURE_2D, mTargets.at(i).mTexture);
+  }
+
+  mShader.SetUniform(mShader.GetUniformLocation("uFragments"), 0);
+  mShader.SetUniform(mShader.GetUniformLocation("uTiles"), 1);
+  mShader.SetUniform(mShader.GetUniformLocation("uHistogram"), 2);
+  mShader.SetUniform(mShader.GetUniformLocation("uTileSize"), cTileSize);
+  glUniform2i(mShader.GetUniformLocation("uViewportOrigin"), viewport.at(0), viewport.at(1));
+  mShader.SetUniform(mShader.GetUniformLocation("uMagnitudeRange"), minMagnitude, maxMagnitude);
+  mShader.SetUniform(mShader.GetUniformLocation("uHistogramRange"), cHistogramMin, cHistogramMax);
+
+  mVAO.Bind();
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  mVAO.Release();
+
+  for (size_t i = mTargets.size(); i > 0; --i) {
+    glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + i - 1));
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  mShader.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t DebugView::getSizeInBytes() const {
+  size_t bytes = 0;
+
+  for (auto const& target : mTargets) {
+    bytes += static_cast<size_t>(target.mWidth * target.mHeight) * sizeof(float);
+  }
+
+  return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
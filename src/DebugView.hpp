@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_DEBUG_VIEW_HPP
+#define CSP_STARS_DEBUG_VIEW_HPP
+
+#include <VistaOGLExt/VistaGLSLShader.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+
+#include <array>
+
+namespace csp::stars {
+
+/// Visualizes where the stars spend their fill rate. The stars are drawn into three small float
+/// render targets with additive blending, so that everything is counted on the GPU without any
+/// read-back: The number of fragments per pixel, the number of stars per screen tile and a
+/// histogram of the apparent magnitudes of all submitted stars. draw() then shows the fragment
+/// counts as a heatmap on top of the star density per tile, with the histogram in the lower left
+/// corner.
+class DebugView {
+ public:
+  enum class Target { eFragments, eTiles, eHistogram, eCount };
+
+  /// The size of the screen tiles in pixels.
+  static const int cTileSize;
+
+  /// The magnitude histogram has cHistogramBins bins covering [cHistogramMin, cHistogramMax].
+  /// Stars outside this range are counted in the first or last bin.
+  static const int   cHistogramBins;
+  static const float cHistogramMin;
+  static const float cHistogramMax;
+
+  DebugView() = default;
+  ~DebugView();
+
+  DebugView(DebugView const& other) = delete;
+  DebugView(DebugView&& other)      = delete;
+  DebugView& operator=(DebugView const& other) = delete;
+  DebugView& operator=(DebugView&& other) = delete;
+
+  /// Binds and clears the given render target and sets the viewport accordingly. For the fragment
+  /// target, viewportWidth and viewportHeight are the size of the current viewport. The caller has
+  /// to restore the previous framebuffer and viewport afterwards.
+  void bindTarget(Target target, int viewportWidth, int viewportHeight);
+
+  /// Draws the debug visualization into the current viewport. The stars within the given
+  /// magnitude range are highlighted in the histogram.
+  void draw(std::array<int, 4> const& viewport, float minMagnitude, float maxMagnitude);
+
+  /// Returns the video memory used by the render targets.
+  size_t getSizeInBytes() const;
+
+ private:
+  struct RenderTarget {
+    GLuint mFramebuffer = 0;
+    GLuint mTexture     = 0;
+    int    mWidth       = 0;
+    int    mHeight      = 0;
+  };
+
+  std::array<RenderTarget, static_cast<size_t>(Target::eCount)> mTargets;
+  VistaGLSLShader                                               mShader;
+  VistaVertexArrayObject                                        mVAO;
+  bool                                                          mShaderDirty = true;
+
+  static const char* cDebugViewVert;
+  static const char* cDebugViewFrag;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_DEBUG_VIEW_HPP
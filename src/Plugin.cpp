@@ -9,12 +9,22 @@
 #include "../../../src/cs-core/GraphicsEngine.hpp"
 #include "../../../src/cs-core/GuiManager.hpp"
 #include "../../../src/cs-core/SolarSystem.hpp"
+#include "../../../src/cs-core/TimeControl.hpp"
 #include "../../../src/cs-utils/logger.hpp"
+#include "Tracing.hpp"
 #include "logger.hpp"
 
+#include <VistaKernel/Cluster/VistaClusterDataSync.h>
+#include <VistaKernel/Cluster/VistaClusterMode.h>
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
+#include <VistaKernel/VistaSystem.h>
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 EXPORT_FN cs::core::PluginBase* create() {
@@ -33,6 +43,67 @@ namespace csp::stars {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Parses a JSON array of [ascension, declination, distance, magnitude, color index] arrays as
+// passed to the dynamic star callbacks.
+std::optional<std::vector<Stars::DynamicStar>> parseDynamicStars(std::string const& json) {
+  try {
+    auto array = nlohmann::json::parse(json);
+
+    std::vector<Stars::DynamicStar> stars;
+    stars.reserve(array.size());
+
+    for (auto const& star : array) {
+      stars.push_back({star.at(0).get<float>(), star.at(1).get<float>(), star.at(2).get<float>(),
+          star.at(3).get<float>(), star.at(4).get<float>()});
+    }
+
+    return stars;
+  } catch (std::exception const& e) {
+    logger().warn("Failed to parse dynamic stars: {}", e.what());
+    return std::nullopt;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void from_json(nlohmann::json const& j, Stars::IngestFilter::RejectedFlag& o) {
+  cs::core::Settings::deserialize(j, "catalog", o.mCatalog);
+  cs::core::Settings::deserialize(j, "column", o.mColumn);
+  cs::core::Settings::deserialize(j, "characters", o.mCharacters);
+}
+
+void to_json(nlohmann::json& j, Stars::IngestFilter::RejectedFlag const& o) {
+  cs::core::Settings::serialize(j, "catalog", o.mCatalog);
+  cs::core::Settings::serialize(j, "column", o.mColumn);
+  cs::core::Settings::serialize(j, "characters", o.mCharacters);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void from_json(nlohmann::json const& j, Stars::IngestFilter& o) {
+  cs::core::Settings::deserialize(j, "maxMagnitude", o.mMaxMagnitude);
+  cs::core::Settings::deserialize(j, "minParallaxQuality", o.mMinParallaxQuality);
+  cs::core::Settings::deserialize(j, "regions", o.mRegions);
+  cs::core::Settings::deserialize(j, "rejectedFlags", o.mRejectedFlags);
+}
+
+void to_json(nlohmann::json& j, Stars::IngestFilter const& o) {
+  cs::core::Settings::serialize(j, "maxMagnitude", o.mMaxMagnitude);
+  cs::core::Settings::serialize(j, "minParallaxQuality", o.mMinParallaxQuality);
+  cs::core::Settings::serialize(j, "regions", o.mRegions);
+  cs::core::Settings::serialize(j, "rejectedFlags", o.mRejectedFlags);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "celestialGridTexture", o.mCelestialGridTexture);
   cs::core::Settings::deserialize(j, "starFiguresTexture", o.mStarFiguresTexture);
@@ -43,12 +114,26 @@ void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "hipparcosCatalog", o.mHipparcosCatalog);
   cs::core::Settings::deserialize(j, "tychoCatalog", o.mTychoCatalog);
   cs::core::Settings::deserialize(j, "tycho2Catalog", o.mTycho2Catalog);
+  cs::core::Settings::deserialize(j, "hygCatalog", o.mHygCatalog);
+  cs::core::Settings::deserialize(j, "arrowCatalog", o.mArrowCatalog);
+  cs::core::Settings::deserialize(j, "variableStars", o.mVariableStars);
+  cs::core::Settings::deserialize(j, "idleTimeout", o.mIdleTimeout);
+  cs::core::Settings::deserialize(j, "enableSharedMemory", o.mEnableSharedMemory);
+  cs::core::Settings::deserialize(j, "enableOcclusionCulling", o.mEnableOcclusionCulling);
+  cs::core::Settings::deserialize(j, "ingestFilter", o.mIngestFilter);
+  cs::core::Settings::deserialize(j, "clusterDirectory", o.mClusterDirectory);
   cs::core::Settings::deserialize(j, "enabled", o.mEnabled);
   cs::core::Settings::deserialize(j, "enableCelestialGrid", o.mEnableCelestialGrid);
   cs::core::Settings::deserialize(j, "enableStarFigures", o.mEnableStarFigures);
+  cs::core::Settings::deserialize(j, "enableDebugView", o.mEnableDebugView);
+  cs::core::Settings::deserialize(j, "enableFaintStars", o.mEnableFaintStars);
   cs::core::Settings::deserialize(j, "luminanceMultiplicator", o.mLuminanceMultiplicator);
   cs::core::Settings::deserialize(j, "drawMode", o.mDrawMode);
+  cs::core::Settings::deserialize(j, "colorModel", o.mColorModel);
   cs::core::Settings::deserialize(j, "size", o.mSize);
+  cs::core::Settings::deserialize(j, "maxSpriteSize", o.mMaxSpriteSize);
+  cs::core::Settings::deserialize(j, "projection", o.mProjection);
+  cs::core::Settings::deserialize(j, "fisheyeAperture", o.mFisheyeAperture);
   cs::core::Settings::deserialize(j, "magnitudeRange", o.mMagnitudeRange);
 }
 
@@ -62,12 +147,26 @@ void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "hipparcosCatalog", o.mHipparcosCatalog);
   cs::core::Settings::serialize(j, "tychoCatalog", o.mTychoCatalog);
   cs::core::Settings::serialize(j, "tycho2Catalog", o.mTycho2Catalog);
+  cs::core::Settings::serialize(j, "hygCatalog", o.mHygCatalog);
+  cs::core::Settings::serialize(j, "arrowCatalog", o.mArrowCatalog);
+  cs::core::Settings::serialize(j, "variableStars", o.mVariableStars);
+  cs::core::Settings::serialize(j, "idleTimeout", o.mIdleTimeout);
+  cs::core::Settings::serialize(j, "enableSharedMemory", o.mEnableSharedMemory);
+  cs::core::Settings::serialize(j, "enableOcclusionCulling", o.mEnableOcclusionCulling);
+  cs::core::Settings::serialize(j, "ingestFilter", o.mIngestFilter);
+  cs::core::Settings::serialize(j, "clusterDirectory", o.mClusterDirectory);
   cs::core::Settings::serialize(j, "enabled", o.mEnabled);
   cs::core::Settings::serialize(j, "enableCelestialGrid", o.mEnableCelestialGrid);
   cs::core::Settings::serialize(j, "enableStarFigures", o.mEnableStarFigures);
+  cs::core::Settings::serialize(j, "enableDebugView", o.mEnableDebugView);
+  cs::core::Settings::serialize(j, "enableFaintStars", o.mEnableFaintStars);
   cs::core::Settings::serialize(j, "luminanceMultiplicator", o.mLuminanceMultiplicator);
   cs::core::Settings::serialize(j, "drawMode", o.mDrawMode);
+  cs::core::Settings::serialize(j, "colorModel", o.mColorModel);
   cs::core::Settings::serialize(j, "size", o.mSize);
+  cs::core::Settings::serialize(j, "maxSpriteSize", o.mMaxSpriteSize);
+  cs::core::Settings::serialize(j, "projection", o.mProjection);
+  cs::core::Settings::serialize(j, "fisheyeAperture", o.mFisheyeAperture);
   cs::core::Settings::serialize(j, "magnitudeRange", o.mMagnitudeRange);
 }
 
@@ -93,13 +192,31 @@ void Plugin::init() {
 
   mStarsNode.reset(mSceneGraph->NewOpenGLNode(mStarsTransform.get(), mStars.get()));
 
+  // The stars themselves are drawn after the opaque geometry, so that the sky tiles which are
+  // hidden behind the planets can be culled.
+  mStarsForegroundNode.reset(
+      mSceneGraph->NewOpenGLNode(mStarsTransform.get(), mStars->getForegroundDraw()));
+
   VistaOpenSGMaterialTools::SetSortKeyOnSubtree(
       mStarsTransform.get(), static_cast<int>(cs::utils::DrawOrder::eStars));
+  VistaOpenSGMaterialTools::SetSortKeyOnSubtree(
+      mStarsForegroundNode.get(), static_cast<int>(cs::utils::DrawOrder::eOpaqueItems) + 1);
 
   // Configure the stars node when a public property is changed.
-  mPluginSettings.mEnabled.connect([this](bool val) { mStarsNode->SetIsEnabled(val); });
+  mPluginSettings.mEnabled.connect([this](bool val) {
+    mStarsNode->SetIsEnabled(val);
+    mStarsForegroundNode->SetIsEnabled(val);
+  });
+  mPluginSettings.mEnableDebugView.connect([this](bool val) { mStars->setEnableDebugView(val); });
+  mPluginSettings.mEnableFaintStars.connect([this](bool val) { mStars->setEnableFaintStars(val); });
   mPluginSettings.mDrawMode.connect([this](Stars::DrawMode val) { mStars->setDrawMode(val); });
+  mPluginSettings.mColorModel.connect(
+      [this](Stars::ColorModel val) { mStars->setColorModel(val); });
   mPluginSettings.mSize.connect([this](float val) { mStars->setSolidAngle(val * 0.0001F); });
+  mPluginSettings.mMaxSpriteSize.connect([this](float val) { mStars->setMaxSpriteSize(val); });
+  mPluginSettings.mProjection.connect(
+      [this](Stars::Projection val) { mStars->setProjection(val); });
+  mPluginSettings.mFisheyeAperture.connect([this](float val) { mStars->setFisheyeAperture(val); });
   mPluginSettings.mMagnitudeRange.connect([this](glm::vec2 const& val) {
     mStars->setMinMagnitude(val.x);
     mStars->setMaxMagnitude(val.y);
@@ -131,6 +248,19 @@ void Plugin::init() {
   mPluginSettings.mEnableStarFigures.connectAndTouch(
       [this](bool enable) { mGuiManager->setCheckboxValue("stars.setEnableFigures", enable); });
 
+  mGuiManager->getGui()->registerCallback("stars.setEnableDebugView",
+      "If enabled, the number of fragments per pixel, the number of stars per screen tile and a "
+      "histogram of the star magnitudes are shown instead of the sky.",
+      std::function([this](bool enable) { mPluginSettings.mEnableDebugView = enable; }));
+  mPluginSettings.mEnableDebugView.connectAndTouch(
+      [this](bool enable) { mGuiManager->setCheckboxValue("stars.setEnableDebugView", enable); });
+
+  mGuiManager->getGui()->registerCallback("stars.setEnableFaintStars",
+      "If enabled, the light of all stars fainter than the magnitude range is drawn as a glow.",
+      std::function([this](bool enable) { mPluginSettings.mEnableFaintStars = enable; }));
+  mPluginSettings.mEnableFaintStars.connectAndTouch(
+      [this](bool enable) { mGuiManager->setCheckboxValue("stars.setEnableFaintStars", enable); });
+
   mGuiManager->getGui()->registerCallback("stars.setLuminanceBoost",
       "Adds an artificial brightness boost to the stars.", std::function([this](double value) {
         mPluginSettings.mLuminanceMultiplicator = static_cast<float>(value);
@@ -189,9 +319,90 @@ void Plugin::init() {
     }
   });
 
+  mGuiManager->getGui()->registerCallback("stars.setColorModel0",
+      "Colors the stars with their measured spectral colors.",
+      std::function([this]() { mPluginSettings.mColorModel = Stars::ColorModel::eSpectral; }));
+  mGuiManager->getGui()->registerCallback("stars.setColorModel1",
+      "Colors the stars like black bodies of their estimated temperature.",
+      std::function([this]() { mPluginSettings.mColorModel = Stars::ColorModel::eBlackbody; }));
+  mGuiManager->getGui()->registerCallback("stars.setColorModel2",
+      "Colors the stars with desaturated spectral colors.",
+      std::function([this]() { mPluginSettings.mColorModel = Stars::ColorModel::eDesaturated; }));
+  mGuiManager->getGui()->registerCallback("stars.setColorModel3",
+      "Colors the stars depending on their distance.",
+      std::function([this]() { mPluginSettings.mColorModel = Stars::ColorModel::eDistance; }));
+  mPluginSettings.mColorModel.connect([this](Stars::ColorModel colorModel) {
+    if (colorModel == Stars::ColorModel::eSpectral) {
+      mGuiManager->setRadioChecked("stars.setColorModel0");
+    } else if (colorModel == Stars::ColorModel::eBlackbody) {
+      mGuiManager->setRadioChecked("stars.setColorModel1");
+    } else if (colorModel == Stars::ColorModel::eDesaturated) {
+      mGuiManager->setRadioChecked("stars.setColorModel2");
+    } else if (colorModel == Stars::ColorModel::eDistance) {
+      mGuiManager->setRadioChecked("stars.setColorModel3");
+    }
+  });
+
+  mGuiManager->getGui()->registerCallback("stars.setDynamicStars",
+      "Replaces the dynamic star list with the given name. The stars are given as a JSON array of "
+      "[ascension, declination, distance, magnitude, colorIndex] arrays in degrees and parsecs. An "
+      "empty array removes the list.",
+      std::function([this](std::string&& list, std::string&& json) {
+        if (auto stars = parseDynamicStars(json)) {
+          mStars->setDynamicStars(list, std::move(*stars));
+        }
+      }));
+
+  mGuiManager->getGui()->registerCallback("stars.updateDynamicStars",
+      "Replaces the stars of the dynamic star list with the given name, starting at the given "
+      "index. The stars are given in the same format as for stars.setDynamicStars.",
+      std::function([this](std::string&& list, double first, std::string&& json) {
+        // JavaScript passes all numbers as doubles.
+        if (!std::isfinite(first) || first < 0.0 || std::floor(first) != first ||
+            first > static_cast<double>(std::numeric_limits<uint32_t>::max())) {
+          logger().warn("Ignoring dynamic stars '{}': Invalid first index {}!", list, first);
+          return;
+        }
+
+        if (auto stars = parseDynamicStars(json)) {
+          mStars->updateDynamicStars(list, static_cast<size_t>(first), *stars);
+        }
+      }));
+
+  mGuiManager->getGui()->registerCallback("stars.dumpTrace",
+      "Writes the recorded trace events to the given file in the Chrome trace event format. This "
+      "requires the plugin to be compiled with CSP_STARS_ENABLE_TRACING.",
+      std::function([](std::string&& file) { tracing::dump(file); }));
+
+  mGuiManager->getGui()->registerCallback("stars.printMemoryReport",
+      "Prints the current and peak memory usage of the stars as JSON to the log.",
+      std::function([this]() { logger().info("Memory usage: {}", mStars->getMemoryReport()); }));
+
+  mGuiManager->getGui()->registerCallback("stars.printStatistics",
+      "Prints the state of the star data and the culling and overdraw of a recent frame as JSON to "
+      "the log.",
+      std::function([this]() { logger().info("Statistics: {}", mStars->getStatisticsReport()); }));
+
+  mGuiManager->getGui()->registerCallback("stars.exportArrow",
+      "Writes the loaded stars to the given Apache Arrow IPC file in the background. The apparent "
+      "magnitudes are computed for the current observer position.",
+      std::function([this](std::string&& file) {
+        mStars->exportArrow(file, mStars->getObserverPosition());
+      }));
+
   mEnableHDRConnection = mAllSettings->mGraphics.pEnableHDR.connectAndTouch(
       [this](bool value) { mStars->setEnableHDR(value); });
 
+  // All nodes use the random session ID of the cluster leader, see DirectoryClusterTransport.
+  if (GetVistaSystem()->GetIsClusterLeader()) {
+    std::random_device device;
+    std::ostringstream session;
+    session << std::hex << device() << device();
+    mClusterSession = session.str();
+  }
+
+  GetVistaSystem()->GetClusterMode()->GetDefaultDataSync()->SyncData(mClusterSession);
+
   // Load settings.
   onLoad();
 
@@ -220,9 +431,21 @@ void Plugin::deInit() {
   mGuiManager->getGui()->unregisterCallback("stars.setDrawMode2");
   mGuiManager->getGui()->unregisterCallback("stars.setDrawMode3");
   mGuiManager->getGui()->unregisterCallback("stars.setDrawMode4");
+  mGuiManager->getGui()->unregisterCallback("stars.setColorModel0");
+  mGuiManager->getGui()->unregisterCallback("stars.setColorModel1");
+  mGuiManager->getGui()->unregisterCallback("stars.setColorModel2");
+  mGuiManager->getGui()->unregisterCallback("stars.setColorModel3");
   mGuiManager->getGui()->unregisterCallback("stars.setEnabled");
   mGuiManager->getGui()->unregisterCallback("stars.setEnableGrid");
   mGuiManager->getGui()->unregisterCallback("stars.setEnableFigures");
+  mGuiManager->getGui()->unregisterCallback("stars.setEnableDebugView");
+  mGuiManager->getGui()->unregisterCallback("stars.setEnableFaintStars");
+  mGuiManager->getGui()->unregisterCallback("stars.setDynamicStars");
+  mGuiManager->getGui()->unregisterCallback("stars.updateDynamicStars");
+  mGuiManager->getGui()->unregisterCallback("stars.dumpTrace");
+  mGuiManager->getGui()->unregisterCallback("stars.printMemoryReport");
+  mGuiManager->getGui()->unregisterCallback("stars.printStatistics");
+  mGuiManager->getGui()->unregisterCallback("stars.exportArrow");
 
   mAllSettings->onLoad().disconnect(mOnLoadConnection);
   mAllSettings->onSave().disconnect(mOnSaveConnection);
@@ -243,6 +466,31 @@ void Plugin::update() {
     fIntensity = 1.F;
   }
 
+  mStars->setSimulationTime(mTimeControl->pSimulationTime.get());
+
+  // Releases the star data if the stars have been disabled for a while.
+  mStars->update();
+
+  // Show the progress of loading the catalogs in the settings. The GUI is updated a few times per
+  // second only.
+  auto progress = mStars->getLoadingProgress();
+  auto now      = std::chrono::steady_clock::now();
+
+  if (progress.mLoading != mShowLoadingProgress ||
+      (progress.mLoading && now - mLastLoadingProgressUpdate > std::chrono::milliseconds(250))) {
+    auto fraction = [](int64_t read, int64_t total) {
+      return total > 0 ? static_cast<double>(read) / static_cast<double>(total) : 0.0;
+    };
+
+    mGuiManager->getGui()->callJavascript("CosmoScout.stars.setLoadingProgress", progress.mLoading,
+        progress.mCatalog, fraction(progress.mBytesRead, progress.mBytes),
+        fraction(progress.mCatalogBytesRead, progress.mCatalogBytes), progress.mBytesPerSecond,
+        progress.mRemainingSeconds, progress.mWaitingForCluster);
+
+    mShowLoadingProgress       = progress.mLoading;
+    mLastLoadingProgressUpdate = now;
+  }
+
   mStars->setLuminanceMultiplicator(
       fIntensity * std::exp(mPluginSettings.mLuminanceMultiplicator.get()));
   mStars->setCelestialGridColor(VistaColor(0.5F, 0.8F, 1.F,
@@ -269,6 +517,19 @@ void Plugin::onLoad() {
   mStars->setStarFiguresColor(VistaColor(bg2.r, bg2.g, bg2.b, bg2.a));
 
   mStars->setCacheFile(mPluginSettings.mCacheFile.value_or("star_cache.dat"));
+  mStars->setIdleTimeout(mPluginSettings.mIdleTimeout.value_or(-1.0));
+  mStars->setEnableSharedMemory(mPluginSettings.mEnableSharedMemory.value_or(false));
+  mStars->setEnableOcclusionCulling(mPluginSettings.mEnableOcclusionCulling.value_or(true));
+
+  // In a cluster, the stars are loaded by the leader and distributed via the given directory.
+  if (mPluginSettings.mClusterDirectory) {
+    auto const* clusterMode = GetVistaSystem()->GetClusterMode();
+    mStars->setClusterTransport(std::make_shared<DirectoryClusterTransport>(
+        *mPluginSettings.mClusterDirectory, clusterMode->GetNodeName(), mClusterSession,
+        clusterMode->GetNumberOfNodes(), GetVistaSystem()->GetIsClusterLeader()));
+  } else {
+    mStars->setClusterTransport(nullptr);
+  }
 
   std::map<Stars::CatalogType, std::string> catalogs;
 
@@ -284,7 +545,17 @@ void Plugin::onLoad() {
     catalogs[Stars::CatalogType::eTycho2] = *mPluginSettings.mTycho2Catalog;
   }
 
+  if (mPluginSettings.mHygCatalog) {
+    catalogs[Stars::CatalogType::eHYG] = *mPluginSettings.mHygCatalog;
+  }
+
+  if (mPluginSettings.mArrowCatalog) {
+    catalogs[Stars::CatalogType::eArrow] = *mPluginSettings.mArrowCatalog;
+  }
+
+  mStars->setIngestFilter(mPluginSettings.mIngestFilter.value_or(Stars::IngestFilter{}));
   mStars->setCatalogs(catalogs);
+  mStars->setVariableStarsFile(mPluginSettings.mVariableStars.value_or(""));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,7 @@
 #include "Stars.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLNode.h>
+#include <chrono>
 #include <optional>
 
 namespace csp::stars {
@@ -21,22 +22,36 @@ namespace csp::stars {
 class Plugin : public cs::core::PluginBase {
  public:
   struct Settings {
-    cs::utils::DefaultProperty<std::string>     mCelestialGridTexture{""};
-    cs::utils::DefaultProperty<std::string>     mStarFiguresTexture{""};
-    cs::utils::DefaultProperty<glm::vec4>       mCelestialGridColor{glm::vec4(0.5F)};
-    cs::utils::DefaultProperty<glm::vec4>       mStarFiguresColor{glm::vec4(0.5F)};
-    std::string                                 mStarTexture;
-    std::optional<std::string>                  mCacheFile;
-    std::optional<std::string>                  mHipparcosCatalog;
-    std::optional<std::string>                  mTychoCatalog;
-    std::optional<std::string>                  mTycho2Catalog;
-    cs::utils::DefaultProperty<bool>            mEnabled{true};
-    cs::utils::DefaultProperty<bool>            mEnableCelestialGrid{false};
-    cs::utils::DefaultProperty<bool>            mEnableStarFigures{false};
-    cs::utils::DefaultProperty<float>           mLuminanceMultiplicator{0.F};
-    cs::utils::DefaultProperty<Stars::DrawMode> mDrawMode{Stars::DrawMode::eSmoothDisc};
-    cs::utils::DefaultProperty<float>           mSize{0.05F};
-    cs::utils::DefaultProperty<glm::vec2>       mMagnitudeRange{glm::vec2(-5.F, 15.F)};
+    cs::utils::DefaultProperty<std::string>       mCelestialGridTexture{""};
+    cs::utils::DefaultProperty<std::string>       mStarFiguresTexture{""};
+    cs::utils::DefaultProperty<glm::vec4>         mCelestialGridColor{glm::vec4(0.5F)};
+    cs::utils::DefaultProperty<glm::vec4>         mStarFiguresColor{glm::vec4(0.5F)};
+    std::string                                   mStarTexture;
+    std::optional<std::string>                    mCacheFile;
+    std::optional<std::string>                    mHipparcosCatalog;
+    std::optional<std::string>                    mTychoCatalog;
+    std::optional<std::string>                    mTycho2Catalog;
+    std::optional<std::string>                    mHygCatalog;
+    std::optional<std::string>                    mArrowCatalog;
+    std::optional<std::string>                    mVariableStars;
+    std::optional<double>                         mIdleTimeout;
+    std::optional<bool>                           mEnableSharedMemory;
+    std::optional<bool>                           mEnableOcclusionCulling;
+    std::optional<Stars::IngestFilter>            mIngestFilter;
+    std::optional<std::string>                    mClusterDirectory;
+    cs::utils::DefaultProperty<bool>              mEnabled{true};
+    cs::utils::DefaultProperty<bool>              mEnableCelestialGrid{false};
+    cs::utils::DefaultProperty<bool>              mEnableStarFigures{false};
+    cs::utils::DefaultProperty<bool>              mEnableDebugView{false};
+    cs::utils::DefaultProperty<bool>              mEnableFaintStars{true};
+    cs::utils::DefaultProperty<float>             mLuminanceMultiplicator{0.F};
+    cs::utils::DefaultProperty<Stars::DrawMode>   mDrawMode{Stars::DrawMode::eSmoothDisc};
+    cs::utils::DefaultProperty<Stars::ColorModel> mColorModel{Stars::ColorModel::eSpectral};
+    cs::utils::DefaultProperty<float>             mSize{0.05F};
+    cs::utils::DefaultProperty<float>             mMaxSpriteSize{0.F};
+    cs::utils::DefaultProperty<Stars::Projection> mProjection{Stars::Projection::ePerspective};
+    cs::utils::DefaultProperty<float>             mFisheyeAperture{180.F};
+    cs::utils::DefaultProperty<glm::vec2>         mMagnitudeRange{glm::vec2(-5.F, 15.F)};
   };
 
   void init() override;
@@ -51,6 +66,13 @@ class Plugin : public cs::core::PluginBase {
   std::unique_ptr<Stars>                          mStars;
   std::shared_ptr<cs::scene::CelestialAnchorNode> mStarsTransform;
   std::unique_ptr<VistaOpenGLNode>                mStarsNode;
+  std::unique_ptr<VistaOpenGLNode>                mStarsForegroundNode;
+
+  bool                                  mShowLoadingProgress = false;
+  std::chrono::steady_clock::time_point mLastLoadingProgressUpdate;
+
+  /// Shared by all nodes of the cluster, see DirectoryClusterTransport.
+  std::string mClusterSession;
 
   int mEnableHDRConnection = -1;
   int mOnLoadConnection    = -1;
@@ -4,7 +4,9 @@
 //                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include "DebugView.hpp"
 #include "Stars.hpp"
+#include "TileCuller.hpp"
 
 namespace csp::stars {
 
@@ -19,6 +21,20 @@ float getApparentMagnitude(float absMagnitude, float distInParsce) {
     return absMagnitude + 5.0*log10(distInParsce / 10.0);
 }
 
+// The apparent magnitudes of distant stars are precomputed for a position close to the observer.
+// For near stars, NEAR_STAR_MAGNITUDE is stored instead and the magnitude is computed here. If the
+// observer has left the region for which the magnitudes have been computed, uPerVertexPhotometry
+// is set and the magnitudes of all stars are computed here.
+const float NEAR_STAR_MAGNITUDE = 1000.0;
+uniform bool uPerVertexPhotometry;
+
+float getStarMagnitude(float absMagnitude, float farMagnitude, vec3 starPos, vec3 observerPos) {
+    if (uPerVertexPhotometry || farMagnitude >= NEAR_STAR_MAGNITUDE) {
+        return getApparentMagnitude(absMagnitude, length(starPos - observerPos));
+    }
+    return farMagnitude;
+}
+
 // formula from https://en.wikipedia.org/wiki/Surface_brightness
 float magnitudeToLuminance(float apparentMagnitude, float solidAngle) {
     const float steradiansToSquareArcSecs = 4.25e10;
@@ -26,6 +42,111 @@ float magnitudeToLuminance(float apparentMagnitude, float solidAngle) {
     return 10.8e4 * pow(10, -0.4 * surfaceBrightness);
 }
 
+// The star colors are stored in a lookup table with linear RGB values. Depending on the color
+// model, it is indexed either by the B-V color index or by the log10 of the distance in parsec.
+uniform sampler1D uColorLUT;
+uniform vec2      uColorLUTRange;
+
+vec3 getStarColor(float colorIndex, float distInParsec) {
+    #ifdef COLOR_BY_DISTANCE
+        float value = log10(distInParsec);
+    #else
+        float value = colorIndex;
+    #endif
+    float coord = (value - uColorLUTRange.x) / (uColorLUTRange.y - uColorLUTRange.x);
+    return texture(uColorLUT, clamp(coord, 0.0, 1.0)).rgb;
+}
+
+// Variable stars have a non-zero index into uVariableStars. Each entry contains the period in days,
+// the epoch of maximum brightness (or of the primary eclipse) in days since J2000, the amplitude in
+// magnitudes and the light curve type. The simulation time is given in days since J2000, split
+// into integer and fractional part.
+uniform samplerBuffer uVariableStars;
+uniform vec2          uSimulationTime;
+
+float getVariableMagnitudeOffset(int variableIndex) {
+    if (variableIndex == 0) {
+        return 0.0;
+    }
+
+    vec4  params = texelFetch(uVariableStars, variableIndex);
+    float phase  = fract((uSimulationTime.x - params.y) / params.x + uSimulationTime.y / params.x);
+    int   type   = int(params.w + 0.5);
+
+    // mira: sinusoidal variation around the catalog magnitude
+    if (type == 0) {
+        return -0.5 * params.z * cos(6.28318530718 * phase);
+    }
+
+    // cepheid: linear decline for 80% of the period, followed by a fast rise
+    if (type == 1) {
+        float curve = phase < 0.8 ? phase / 0.8 : (1.0 - phase) / 0.2;
+        return params.z * (curve - 0.5);
+    }
+
+    // eclipsing: a dip lasting 10% of the period centered at phase zero
+    float d = min(phase, 1.0 - phase) / 0.05;
+    return params.z * max(0.0, 1.0 - d * d);
+}
+
+// In fisheye mode, view space is mapped to the screen with an azimuthal equidistant projection
+// around the negative z-axis: The distance to the center of the screen is proportional to the angle
+// to the view direction. uFisheyeScale converts radians to normalized device coordinates,
+// uFisheyeMaxAngle is the angle in the corners of the viewport.
+#ifdef PROJECTION_FISHEYE
+    uniform vec2  uFisheyeScale;
+    uniform float uFisheyeMaxAngle;
+#endif
+
+// Projects a star at the given position in view space. If it is in front of the observer, the
+// result is divided by w and placed directly in front of the far plane.
+vec4 projectStar(vec3 viewPos, mat4 matP) {
+    #ifdef PROJECTION_FISHEYE
+        vec3  dir   = normalize(viewPos);
+        float angle = acos(clamp(-dir.z, -1.0, 1.0));
+
+        // Stars outside of the viewport are clipped, so that the quads of stars close to the
+        // opposite of the view direction are never stretched across the screen.
+        if (angle > uFisheyeMaxAngle) {
+            return vec4(2.0, 2.0, 2.0, 1.0);
+        }
+
+        float len = length(dir.xy);
+        vec2  pos = len > 0.0 ? dir.xy / len * angle * uFisheyeScale : vec2(0.0);
+        return vec4(pos, 0.999999, 1.0);
+    #else
+        vec4 pos = matP * vec4(viewPos, 1.0);
+        if (pos.w > 0) {
+            pos /= pos.w;
+            if (pos.z >= 1) {
+                pos.z = 0.999999;
+            }
+        }
+        return pos;
+    #endif
+}
+
+// Returns the direction in view space which is projected to the given normalized device
+// coordinates. It is not normalized.
+vec3 getViewDirection(vec3 ndc, mat4 invP) {
+    #ifdef PROJECTION_FISHEYE
+        vec2  angles = ndc.xy / uFisheyeScale;
+        float angle  = length(angles);
+        return angle > 0.0 ? vec3(angles / angle * sin(angle), -cos(angle)) : vec3(0.0, 0.0, -1.0);
+    #else
+        return (invP * vec4(ndc, 1.0)).xyz;
+    #endif
+}
+
+// The number of pixels per radian in the center of the screen.
+float getPixelsPerRadian(mat4 matP, vec2 resolution) {
+    #ifdef PROJECTION_FISHEYE
+        return uFisheyeScale.y * 0.5 * resolution.y;
+    #else
+        return matP[1][1] * 0.5 * resolution.y;
+    #endif
+}
+
 vec3 SRGBtoLINEAR(vec3 srgbIn) {
   vec3 bLess = step(vec3(0.04045),srgbIn);
   return mix( srgbIn/vec3(12.92), pow((srgbIn+vec3(0.055))/vec3(1.055),vec3(2.4)), bLess );
@@ -51,8 +172,10 @@ const char* Stars::cStarsVert = R"(
 // inputs
 layout(location = 0) in vec2  inDir;
 layout(location = 1) in float inDist;
-layout(location = 2) in vec3  inColor;
+layout(location = 2) in float inColorIndex;
 layout(location = 3) in float inAbsMagnitude;
+layout(location = 4) in int   inVariableIndex;
+layout(location = 5) in float inFarMagnitude;
                                                                             
 // uniforms
 uniform mat4 uMatMV;
@@ -71,8 +194,9 @@ void main() {
     const float parsecToMeter = 3.08567758e16;
     vec3 observerPos = (uInvMV * vec4(0, 0, 0, 1) / parsecToMeter).xyz;
 
-    vMagnitude = getApparentMagnitude(inAbsMagnitude, length(starPos-observerPos));
-    vColor = inColor;
+    vMagnitude = getStarMagnitude(inAbsMagnitude, inFarMagnitude, starPos, observerPos) +
+                 getVariableMagnitudeOffset(inVariableIndex);
+    vColor = getStarColor(inColorIndex, inDist);
 
     gl_Position = uMatMV * vec4(starPos*parsecToMeter, 1);
 }
@@ -91,19 +215,23 @@ in float vMagnitude[];
 
 // uniforms
 uniform mat4  uMatP;
+uniform vec2  uResolution;
 uniform float uSolidAngle;
 uniform float uMinMagnitude;
 uniform float uMaxMagnitude;
+uniform float uMaxSpriteSize;
 
 // outputs
 out vec3  iColor;
 out float iMagnitude;
 out vec2  iTexcoords;
+out float iFluxScale;
 
 void main() {
-    iColor = SRGBtoLINEAR(vColor[0]);
+    iColor = vColor[0];
 
     iMagnitude = vMagnitude[0];
+    iFluxScale = 1.0;
 
     if (iMagnitude > uMaxMagnitude || iMagnitude < uMinMagnitude) {
         return;
@@ -127,6 +255,17 @@ void main() {
         float luminance = magnitudeToLuminance(iMagnitude, uSolidAngle);
         float scaleFac = pow(luminance / referenceLuminance, 1.0 / 3.0);
         scale *= scaleFac;
+
+        // Limit the size of the quad on screen. The sprite is shrunk as a whole and brightened by
+        // the inverse area ratio, so that its total flux stays the same.
+        if (uMaxSpriteSize > 0) {
+            float sizeInPixels = scale / dist * getPixelsPerRadian(uMatP, uResolution);
+            if (sizeInPixels > uMaxSpriteSize) {
+                float shrink = uMaxSpriteSize / sizeInPixels;
+                scale *= shrink;
+                iFluxScale = 1.0 / (shrink * shrink);
+            }
+        }
     #endif
 
     for(int j=0; j!=2; ++j) {
@@ -135,13 +274,11 @@ void main() {
 
             vec3 pos = gl_in[0].gl_Position.xyz + (xo[i] * x + yo[j] * y) * scale;
 
-            gl_Position = uMatP * vec4(pos, 1);
+            // In fisheye mode, each corner is projected individually, so that the quad covers the
+            // same solid angle on the sky anywhere on screen.
+            gl_Position = projectStar(pos, uMatP);
 
             if (gl_Position.w > 0) {
-                gl_Position /= gl_Position.w;
-                if (gl_Position.z >= 1) {
-                    gl_Position.z = 0.999999;
-                }
                 EmitVertex();
             }
         }
@@ -158,6 +295,7 @@ const char* Stars::cStarsFrag = R"(
 in vec3  iColor;
 in float iMagnitude;
 in vec2  iTexcoords;
+in float iFluxScale;
 
 // uniforms
 uniform sampler2D iTexture;
@@ -188,6 +326,7 @@ void main() {
         // star texture, 4.5e-12 has been retrieved by trial and error when trying to adjust the
         // total scene brightness to the other implemented methods
         float fac = texture(iTexture, iTexcoords * 0.5 + 0.5).r * 4.5e-12 / 0.001744984 * scaleFac / uSolidAngle;
+        fac *= iFluxScale;
     #endif
 
     vec3 vColor = iColor * fac * uLuminanceMultiplicator;
@@ -197,6 +336,11 @@ void main() {
     #ifndef ENABLE_HDR
         oLuminance.rgb = Uncharted2Tonemap(oLuminance.rgb * uSolidAngle * 5e8);
     #endif
+
+    // for the debug view, each fragment is counted once
+    #ifdef DEBUG_COUNT_FRAGMENTS
+        oLuminance = vec4(1.0);
+    #endif
 }
 
 )";
@@ -208,8 +352,10 @@ const char* Stars::cStarsVertOnePixel = R"(
 // inputs
 layout(location = 0) in vec2  inDir;
 layout(location = 1) in float inDist;
-layout(location = 2) in vec3  inColor;
+layout(location = 2) in float inColorIndex;
 layout(location = 3) in float inAbsMagnitude;
+layout(location = 4) in int   inVariableIndex;
+layout(location = 5) in float inFarMagnitude;
                                                                             
 // uniforms
 uniform mat4 uMatMV;
@@ -230,18 +376,12 @@ void main() {
     const float parsecToMeter = 3.08567758e16;
     vec3 observerPos = (uInvMV * vec4(0, 0, 0, 1) / parsecToMeter).xyz;
 
-    vMagnitude = getApparentMagnitude(inAbsMagnitude, length(starPos-observerPos));
+    vMagnitude = getStarMagnitude(inAbsMagnitude, inFarMagnitude, starPos, observerPos) +
+                 getVariableMagnitudeOffset(inVariableIndex);
     
-    vColor = SRGBtoLINEAR(inColor);
+    vColor = getStarColor(inColorIndex, inDist);
 
-    vScreenSpacePos = uMatP * uMatMV * vec4(starPos*parsecToMeter, 1);
-    
-    if (vScreenSpacePos.w > 0) {
-        vScreenSpacePos /= vScreenSpacePos.w;
-        if (vScreenSpacePos.z >= 1) {
-            vScreenSpacePos.z = 0.999999;
-        }
-    }
+    vScreenSpacePos = projectStar((uMatMV * vec4(starPos*parsecToMeter, 1)).xyz, uMatP);
 
     gl_Position = vScreenSpacePos;
 }
@@ -281,8 +421,7 @@ float getSolidAngleOfPixel(vec4 screenSpacePosition, vec2 resolution, mat4 invPr
     );
 
     for (int i=0; i<4; ++i) {
-        pixelCorners[i] = invProjection * pixelCorners[i];
-        pixelCorners[i].xyz = normalize(pixelCorners[i].xyz);
+        pixelCorners[i].xyz = normalize(getViewDirection(pixelCorners[i].xyz, invProjection));
     }
 
     return getSolidAngle(pixelCorners[0].xyz, pixelCorners[1].xyz, pixelCorners[2].xyz)
@@ -302,6 +441,71 @@ void main() {
     #ifndef ENABLE_HDR
         oLuminance.rgb = Uncharted2Tonemap(oLuminance.rgb * uSolidAngle * 5e8);
     #endif
+
+    // for the debug view, each fragment is counted once
+    #ifdef DEBUG_COUNT_FRAGMENTS
+        oLuminance = vec4(1.0);
+    #endif
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* Stars::cStarsVertDebug = R"(
+// inputs
+layout(location = 0) in vec2  inDir;
+layout(location = 1) in float inDist;
+layout(location = 3) in float inAbsMagnitude;
+layout(location = 4) in int   inVariableIndex;
+layout(location = 5) in float inFarMagnitude;
+
+// uniforms
+uniform mat4  uMatMV;
+uniform mat4  uMatP;
+uniform mat4  uInvMV;
+uniform float uMinMagnitude;
+uniform float uMaxMagnitude;
+uniform vec2  uHistogramRange;
+uniform int   uHistogramBins;
+
+void main() {
+    vec3 starPos = vec3(
+        cos(inDir.x) * cos(inDir.y) * inDist,
+        sin(inDir.x) * inDist,
+        cos(inDir.x) * sin(inDir.y) * inDist);
+
+    const float parsecToMeter = 3.08567758e16;
+    vec3 observerPos = (uInvMV * vec4(0, 0, 0, 1) / parsecToMeter).xyz;
+
+    float magnitude = getStarMagnitude(inAbsMagnitude, inFarMagnitude, starPos, observerPos) +
+                      getVariableMagnitudeOffset(inVariableIndex);
+
+    #ifdef DEBUG_MAGNITUDE_HISTOGRAM
+        // Each star is moved to the center of the texel of its magnitude bin.
+        float t = (magnitude - uHistogramRange.x) / (uHistogramRange.y - uHistogramRange.x);
+        float bin = clamp(floor(t * uHistogramBins), 0.0, float(uHistogramBins - 1));
+        gl_Position = vec4((2.0 * bin + 1.0) / uHistogramBins - 1.0, 0.0, 0.0, 1.0);
+    #else
+        // Each star is projected into the tile it covers on screen. Stars which are not drawn are
+        // moved outside of the viewport.
+        if (magnitude > uMaxMagnitude || magnitude < uMinMagnitude) {
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            return;
+        }
+
+        gl_Position = projectStar((uMatMV * vec4(starPos*parsecToMeter, 1)).xyz, uMatP);
+    #endif
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* Stars::cStarsFragDebug = R"(
+// outputs
+out vec4 oCount;
+
+void main() {
+    oCount = vec4(1.0);
 }
 )";
 
@@ -318,11 +522,22 @@ uniform mat4 uInvMV;
 // outputs
 out vec3 vView;
 
+// The fisheye projection is not linear, so the rays cannot be interpolated. Instead, the angles to
+// the view direction are interpolated and the rays are computed per fragment.
+#ifdef PROJECTION_FISHEYE
+    uniform vec2 uFisheyeScale;
+    out vec2     vFisheyeAngles;
+#endif
+
 void main() {
     vec3 vRayOrigin = (uInvMV * vec4(0, 0, 0, 1)).xyz;
     vec4 vRayEnd    = uInvMVP * vec4(vPosition, 0, 1);
     vView           = vRayEnd.xyz / vRayEnd.w - vRayOrigin;
     gl_Position     = vec4(vPosition, 1, 1);
+
+    #ifdef PROJECTION_FISHEYE
+        vFisheyeAngles = vPosition / uFisheyeScale;
+    #endif
 }
 )";
 
@@ -332,10 +547,19 @@ const char* Stars::cBackgroundFrag = R"(
 // inputs
 in vec3 vView;
 
+#ifdef PROJECTION_FISHEYE
+    in vec2      vFisheyeAngles;
+    uniform mat4 uInvMV;
+#endif
+
 // uniforms
 uniform sampler2D iTexture;
 uniform vec4      cColor;
 
+#ifdef FAINT_STARS
+    uniform float uSolidAngle;
+#endif
+
 // outputs
 layout(location = 0) out vec3 vOutColor;
 
@@ -345,9 +569,141 @@ float my_atan2(float a, float b) {
 
 void main() {
     const float PI = 3.14159265359;
-    vec3 view = normalize(vView);
+
+    #ifdef PROJECTION_FISHEYE
+        float angle = min(length(vFisheyeAngles), PI);
+        vec3  dir   = angle > 0.0 ? vec3(vFisheyeAngles / angle * sin(angle), -cos(angle))
+                                  : vec3(0.0, 0.0, -1.0);
+        vec3  view  = normalize((uInvMV * vec4(dir, 0.0)).xyz);
+    #else
+        vec3 view = normalize(vView);
+    #endif
     vec2 texcoord = vec2(0.5*my_atan2(view.x, -view.z)/PI, acos(view.y)/PI);
-    vOutColor = texture(iTexture, texcoord).rgb * cColor.rgb * cColor.a;
+
+    // The horizontal texture coordinate jumps at the seam of the equirectangular projection. The
+    // derivatives are corrected there, else the coarsest mipmap level would be selected.
+    vec2 dx = dFdx(texcoord);
+    vec2 dy = dFdy(texcoord);
+    dx.x -= round(dx.x);
+    dy.x -= round(dy.x);
+
+    vOutColor = textureGrad(iTexture, texcoord, dx, dy).rgb * cColor.rgb * cColor.a;
+
+    // The faint star map contains luminance values which are tone mapped like the stars.
+    #if defined(FAINT_STARS) && !defined(ENABLE_HDR)
+        vOutColor = Uncharted2Tonemap(vOutColor * uSolidAngle * 5e8);
+    #endif
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* DebugView::cDebugViewVert = R"(
+#version 330
+
+// Draws a full-screen quad without any vertex attributes.
+void main() {
+    vec2 position = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* DebugView::cDebugViewFrag = R"(
+#version 330
+
+// uniforms
+uniform sampler2D uFragments;
+uniform sampler2D uTiles;
+uniform sampler2D uHistogram;
+uniform int       uTileSize;
+uniform ivec2     uViewportOrigin;
+uniform vec2      uMagnitudeRange;
+uniform vec2      uHistogramRange;
+
+// outputs
+layout(location = 0) out vec3 oColor;
+
+// Maps [0..1] to black, blue, cyan, green, yellow, red.
+vec3 heat(float t) {
+    vec3 color = clamp(vec3(4.0 * t - 2.0, 2.0 - abs(4.0 * t - 2.0), 2.0 - 4.0 * t), 0.0, 1.0);
+    return color * clamp(t * 8.0, 0.0, 1.0);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) - uViewportOrigin;
+
+    // The number of stars per tile is shown as a dim blue background on a logarithmic scale which
+    // saturates at 1000 stars.
+    float stars = texelFetch(uTiles, pixel / uTileSize, 0).r;
+    oColor = vec3(0.05, 0.1, 0.4) * clamp(log(1.0 + stars) / log(1001.0), 0.0, 1.0);
+
+    if (any(equal(pixel % uTileSize, ivec2(0)))) {
+        oColor += vec3(0.02);
+    }
+
+    // The number of fragments per pixel is shown as a heatmap on a logarithmic scale which
+    // saturates at 64 fragments.
+    float fragments = texelFetch(uFragments, pixel, 0).r;
+    if (fragments > 0.0) {
+        oColor = heat(clamp(log2(1.0 + fragments) / log2(65.0), 0.0, 1.0));
+    }
+
+    // The magnitude histogram is drawn in the lower left corner with a logarithmic vertical axis
+    // up to ten million stars. Bins outside the displayed magnitude range are drawn in gray.
+    const ivec2 histogramOrigin = ivec2(20, 20);
+    const ivec2 histogramSize   = ivec2(400, 150);
+
+    ivec2 p = pixel - histogramOrigin;
+    if (all(greaterThanEqual(p, ivec2(0))) && all(lessThan(p, histogramSize))) {
+        int   bins  = textureSize(uHistogram, 0).x;
+        int   bin   = p.x * bins / histogramSize.x;
+        float count = texelFetch(uHistogram, ivec2(bin, 0), 0).r;
+        float height = log(1.0 + count) / log(1e7) * float(histogramSize.y);
+
+        float magnitude = mix(uHistogramRange.x, uHistogramRange.y, (float(bin) + 0.5) / bins);
+        bool  visible   = magnitude >= uMagnitudeRange.x && magnitude <= uMagnitudeRange.y;
+
+        if (float(p.y) < height) {
+            oColor = visible ? vec3(0.9) : vec3(0.4);
+        } else {
+            oColor *= 0.3;
+        }
+    }
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* TileCuller::cTileCullerVert = R"(
+#version 330
+
+// inputs
+layout(location = 0) in vec3 inDir;
+
+// uniforms
+uniform mat4 uMatMV;
+uniform mat4 uMatP;
+
+void main() {
+    // The corners of the bounding quads are points at infinity, so that only the rotation of the
+    // observer matters. They are drawn at the same depth as the stars.
+    gl_Position   = uMatP * vec4((uMatMV * vec4(inDir, 0.0)).xyz, 0.0);
+    gl_Position.z = gl_Position.w * 0.999999;
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* TileCuller::cTileCullerFrag = R"(
+#version 330
+
+// outputs
+layout(location = 0) out vec4 oColor;
+
+void main() {
+    oColor = vec4(1.0);
 }
 )";
 
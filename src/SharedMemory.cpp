@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SharedMemory.hpp"
+
+#include "logger.hpp"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SharedMemory> SharedMemory::create(std::string const& name, size_t size) {
+#ifdef _WIN32
+  return nullptr;
+#else
+  // O_EXCL makes sure that only one process creates and fills the segment.
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    if (errno != EEXIST) {
+      logger().warn("Failed to create shared memory '{}': {}", name, std::strerror(errno));
+    }
+    return nullptr;
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    logger().warn("Failed to resize shared memory '{}': {}", name, std::strerror(errno));
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    logger().warn("Failed to map shared memory '{}': {}", name, std::strerror(errno));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  return std::shared_ptr<SharedMemory>(new SharedMemory(name, data, size, true));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SharedMemory> SharedMemory::open(std::string const& name) {
+#ifdef _WIN32
+  return nullptr;
+#else
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  auto  size = static_cast<size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    logger().warn("Failed to map shared memory '{}': {}", name, std::strerror(errno));
+    return nullptr;
+  }
+
+  return std::shared_ptr<SharedMemory>(new SharedMemory(name, data, size, false));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SharedMemory> SharedMemory::mapFile(std::string const& file) {
+#ifdef _WIN32
+  return nullptr;
+#else
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  auto  size = static_cast<size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    logger().warn("Failed to map file '{}': {}", file, std::strerror(errno));
+    return nullptr;
+  }
+
+  // The file is not removed when the mapping is destroyed, as this object does not own it.
+  return std::shared_ptr<SharedMemory>(new SharedMemory(file, data, size, false));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedMemory::remove(std::string const& name) {
+#ifndef _WIN32
+  if (shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+    logger().warn("Failed to remove shared memory '{}': {}", name, std::strerror(errno));
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::time_t> SharedMemory::getModificationTime(std::string const& name) {
+#ifdef _WIN32
+  return std::nullopt;
+#else
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  struct stat info {};
+  int         status = fstat(fd, &info);
+  close(fd);
+
+  if (status != 0) {
+    return std::nullopt;
+  }
+
+  return info.st_mtime;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SharedMemory::SharedMemory(std::string name, void* data, size_t size, bool owner)
+    : mName(std::move(name))
+    , mData(data)
+    , mSize(size)
+    , mOwner(owner) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SharedMemory::~SharedMemory() {
+#ifndef _WIN32
+  munmap(mData, mSize);
+
+  if (mOwner) {
+    shm_unlink(mName.c_str());
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* SharedMemory::getData() {
+  return mData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void const* SharedMemory::getData() const {
+  return mData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t SharedMemory::getSize() const {
+  return mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
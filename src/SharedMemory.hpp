@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_SHARED_MEMORY_HPP
+#define CSP_STARS_SHARED_MEMORY_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace csp::stars {
+
+/// A named POSIX shared memory segment which is mapped into the address space of this process.
+/// Segments are used to share the immutable star data between several processes on one host. A
+/// regular file can be mapped in the same way. On platforms without POSIX shared memory, create(),
+/// open() and mapFile() always return nullptr.
+class SharedMemory {
+ public:
+  /// Creates a new segment of the given size which is mapped read-write. Returns nullptr if a
+  /// segment with this name already exists or if it could not be created. The name of the segment
+  /// is removed when the returned object is destroyed; other processes keep their mappings.
+  static std::shared_ptr<SharedMemory> create(std::string const& name, size_t size);
+
+  /// Maps an existing segment read-only. Returns nullptr if there is no such segment.
+  static std::shared_ptr<SharedMemory> open(std::string const& name);
+
+  /// Maps an existing file read-only. Returns nullptr if the file does not exist or is empty.
+  static std::shared_ptr<SharedMemory> mapFile(std::string const& file);
+
+  /// Removes the name of a segment, for example if it has been left behind by a crashed process.
+  /// Processes which have mapped the segment keep their mappings.
+  static void remove(std::string const& name);
+
+  /// Returns the time at which the segment has been created or resized the last time. Returns an
+  /// empty optional if there is no such segment.
+  static std::optional<std::time_t> getModificationTime(std::string const& name);
+
+  ~SharedMemory();
+
+  SharedMemory(SharedMemory const& other) = delete;
+  SharedMemory(SharedMemory&& other)      = delete;
+  SharedMemory& operator=(SharedMemory const& other) = delete;
+  SharedMemory& operator=(SharedMemory&& other) = delete;
+
+  /// Writing is only allowed for segments which have been created by this process.
+  void*       getData();
+  void const* getData() const;
+  size_t      getSize() const;
+
+ private:
+  SharedMemory(std::string name, void* data, size_t size, bool owner);
+
+  std::string mName;
+  void*       mData;
+  size_t      mSize;
+  bool        mOwner;
+};
+
+/// An array which either owns its elements or refers to read-only elements in a SharedMemory
+/// segment. It offers the subset of the std::vector interface which is used for the star data.
+/// Modifying a shared array first copies its elements.
+template <typename T>
+class SharedArray {
+ public:
+  SharedArray() = default;
+
+  explicit SharedArray(std::vector<T>&& values)
+      : mValues(std::move(values))
+      , mData(mValues.data())
+      , mSize(mValues.size()) {
+  }
+
+  /// The given memory has to stay valid as long as this array refers to it.
+  SharedArray(T const* data, size_t size)
+      : mData(data)
+      , mSize(size) {
+  }
+
+  SharedArray(SharedArray const& other)
+      : mValues(other.begin(), other.end())
+      , mData(mValues.data())
+      , mSize(mValues.size()) {
+  }
+
+  // The buffer of a moved vector stays valid, hence mData does not need to be updated.
+  SharedArray(SharedArray&& other) noexcept
+      : mValues(std::move(other.mValues))
+      , mData(other.mData)
+      , mSize(other.mSize) {
+    other.mData = nullptr;
+    other.mSize = 0;
+  }
+
+  SharedArray& operator=(SharedArray const& other) {
+    if (this != &other) {
+      mValues.assign(other.begin(), other.end());
+      mData = mValues.data();
+      mSize = mValues.size();
+    }
+    return *this;
+  }
+
+  SharedArray& operator=(SharedArray&& other) noexcept {
+    if (this != &other) {
+      mValues     = std::move(other.mValues);
+      mData       = other.mData;
+      mSize       = other.mSize;
+      other.mData = nullptr;
+      other.mSize = 0;
+    }
+    return *this;
+  }
+
+  ~SharedArray() = default;
+
+  T const& operator[](size_t index) const {
+    return mData[index];
+  }
+
+  T const* data() const {
+    return mData;
+  }
+
+  T const* begin() const {
+    return mData;
+  }
+
+  T const* end() const {
+    return mData + mSize;
+  }
+
+  size_t size() const {
+    return mSize;
+  }
+
+  bool empty() const {
+    return mSize == 0;
+  }
+
+  /// Returns true if the elements are stored in a shared memory segment.
+  bool isShared() const {
+    return mSize > 0 && mValues.empty();
+  }
+
+  /// Returns the number of elements allocated by this array. This is zero for shared arrays.
+  size_t capacity() const {
+    return mValues.capacity();
+  }
+
+  void push_back(T const& value) {
+    makeOwned();
+    mValues.push_back(value);
+    update();
+  }
+
+  void resize(size_t count) {
+    makeOwned();
+    mValues.resize(count);
+    update();
+  }
+
+  void reserve(size_t count) {
+    makeOwned();
+    mValues.reserve(count);
+    update();
+  }
+
+  void clear() {
+    mValues.clear();
+    update();
+  }
+
+ private:
+  void makeOwned() {
+    if (isShared()) {
+      mValues.assign(mData, mData + mSize);
+    }
+  }
+
+  void update() {
+    mData = mValues.data();
+    mSize = mValues.size();
+  }
+
+  std::vector<T> mValues;
+  T const*       mData = nullptr;
+  size_t         mSize = 0;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_SHARED_MEMORY_HPP
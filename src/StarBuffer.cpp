@@ -0,0 +1,429 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StarBuffer.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const size_t StarBuffer::cPageSize         = 16384;
+const float  StarBuffer::cRemovedMagnitude = 1000000.F;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct AttributeLayout {
+  GLuint mLocation;
+  GLint  mComponents;
+  GLenum mType;
+  size_t mSize;
+};
+
+// The blocks are stored in this order. The integer block comes last, so that all float blocks are
+// aligned to four bytes.
+const std::array<AttributeLayout, static_cast<size_t>(StarBuffer::Attribute::eCount)> cLayouts{{
+    {0, 2, GL_FLOAT, 2 * sizeof(float)},         // direction
+    {1, 1, GL_FLOAT, sizeof(float)},             // distance
+    {2, 1, GL_FLOAT, sizeof(float)},             // color index
+    {3, 1, GL_FLOAT, sizeof(float)},             // absolute magnitude
+    {5, 1, GL_FLOAT, sizeof(float)},             // precomputed apparent magnitude
+    {4, 1, GL_UNSIGNED_SHORT, sizeof(uint16_t)}, // variable star index
+}};
+
+AttributeLayout const& getLayout(StarBuffer::Attribute attribute) {
+  return cLayouts.at(static_cast<size_t>(attribute));
+}
+
+size_t getSlotSize() {
+  size_t size = 0;
+  for (auto const& layout : cLayouts) {
+    size += layout.mSize;
+  }
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StarBuffer::StarBuffer()
+    : mVBO(std::make_unique<VistaBufferObject>()) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::allocate(size_t count) {
+  size_t first = 0;
+
+  for (auto const& [rangeFirst, rangeCount] : mRanges) {
+    if (rangeFirst - first >= count) {
+      break;
+    }
+    first = rangeFirst + rangeCount;
+  }
+
+  if (first + count > mCapacity) {
+    // Appending grows the buffer by at least half of its size, so that adding many small ranges
+    // does not copy the buffer each time.
+    grow(std::max(first + count, mCapacity + mCapacity / 2));
+  }
+
+  mRanges[first] = count;
+
+  return first;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::free(size_t first) {
+  auto range = mRanges.find(first);
+
+  if (range == mRanges.end()) {
+    return;
+  }
+
+  tombstone(range->first, range->second);
+  mRanges.erase(range);
+
+  if (mRanges.empty()) {
+    clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::write(Attribute attribute, size_t first, size_t count, void const* data) {
+  size_t      size  = getLayout(attribute).mSize;
+  auto const* bytes = static_cast<uint8_t const*>(data);
+
+  // The data is split at page boundaries, so that flush() can upload it page by page.
+  while (count > 0) {
+    size_t chunkCount = std::min(count, cPageSize - first % cPageSize);
+
+    Chunk chunk{attribute, first, std::vector<uint8_t>(bytes, bytes + chunkCount * size)};
+    mStagedBytes += chunk.mData.size();
+    mStagedChunks.push_back(std::move(chunk));
+
+    bytes += chunkCount * size;
+    first += chunkCount;
+    count -= chunkCount;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarBuffer::flush(size_t maxBytes) {
+  if (mStagedChunks.empty()) {
+    return true;
+  }
+
+  size_t uploaded = 0;
+
+  mVBO->Bind(GL_ARRAY_BUFFER);
+
+  while (!mStagedChunks.empty() && uploaded < maxBytes) {
+    auto const& chunk = mStagedChunks.front();
+
+    // Ranges which have been removed since the chunk was written may already lie beyond the end
+    // of the buffer.
+    if (chunk.mFirst < mCapacity) {
+      size_t offset = getBlockOffset(chunk.mAttribute, mCapacity) +
+                      chunk.mFirst * getLayout(chunk.mAttribute).mSize;
+      mVBO->BufferSubData(static_cast<GLintptr>(offset),
+          static_cast<GLsizeiptr>(chunk.mData.size()), chunk.mData.data());
+      uploaded += chunk.mData.size();
+    }
+
+    mStagedBytes -= chunk.mData.size();
+    mStagedChunks.pop_front();
+  }
+
+  mVBO->Release();
+
+  return mStagedChunks.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarBuffer::compact(MoveCallback const& onMove) {
+  if (!mStagedChunks.empty() || mRanges.empty()) {
+    return false;
+  }
+
+  auto [lastFirst, lastCount] = *mRanges.rbegin();
+
+  // Find the first gap which is large enough. It always ends before the last range starts, hence
+  // the source and the destination of the copy do not overlap.
+  size_t first = 0;
+  for (auto const& [rangeFirst, rangeCount] : mRanges) {
+    if (rangeFirst - first >= lastCount) {
+      break;
+    }
+    if (rangeFirst == lastFirst) {
+      return false;
+    }
+    first = rangeFirst + rangeCount;
+  }
+
+  glBindBuffer(GL_COPY_READ_BUFFER, mVBO->GetId());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mVBO->GetId());
+
+  for (size_t i = 0; i < cLayouts.size(); ++i) {
+    auto   attribute = static_cast<Attribute>(i);
+    size_t size      = cLayouts.at(i).mSize;
+    size_t offset    = getBlockOffset(attribute, mCapacity);
+
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(offset + lastFirst * size),
+        static_cast<GLintptr>(offset + first * size), static_cast<GLsizeiptr>(lastCount * size));
+  }
+
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  mRanges.erase(lastFirst);
+  mRanges[first] = lastCount;
+  tombstone(lastFirst, lastCount);
+
+  onMove(lastFirst, first, lastCount);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::clear() {
+  mRanges.clear();
+  mStagedChunks.clear();
+  mStagedBytes = 0;
+  mCapacity    = 0;
+
+  mVBO->Bind(GL_ARRAY_BUFFER);
+  mVBO->BufferData(0, nullptr, GL_DYNAMIC_DRAW);
+  mVBO->Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::bind() {
+  mVAO.Bind();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::release() {
+  mVAO.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getSize() const {
+  if (mRanges.empty()) {
+    return 0;
+  }
+
+  return mRanges.rbegin()->first + mRanges.rbegin()->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getNumRemoved() const {
+  size_t used = 0;
+  for (auto const& range : mRanges) {
+    used += range.second;
+  }
+
+  return getSize() - used;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarBuffer::hasStagedWrites() const {
+  return !mStagedChunks.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getSizeInBytes() const {
+  return mCapacity * getSlotSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getStagedBytes() const {
+  return mStagedBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getAttributeSize(Attribute attribute) {
+  return getLayout(attribute).mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarBuffer::getBlockOffset(Attribute attribute, size_t capacity) {
+  size_t offset = 0;
+  for (size_t i = 0; i < static_cast<size_t>(attribute); ++i) {
+    offset += cLayouts.at(i).mSize * capacity;
+  }
+  return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::specifyAttributes(
+    VistaVertexArrayObject& vao, VistaBufferObject& vbo, size_t capacity) {
+  for (size_t i = 0; i < cLayouts.size(); ++i) {
+    auto const& layout    = cLayouts.at(i);
+    auto        attribute = static_cast<Attribute>(i);
+    auto        offset    = static_cast<GLintptr>(getBlockOffset(attribute, capacity));
+    auto        stride    = static_cast<GLsizei>(layout.mSize);
+
+    vao.EnableAttributeArray(layout.mLocation);
+
+    if (layout.mType == GL_FLOAT) {
+      vao.SpecifyAttributeArrayFloat(
+          layout.mLocation, layout.mComponents, layout.mType, GL_FALSE, stride, offset, &vbo);
+    } else {
+      vao.SpecifyAttributeArrayInteger(
+          layout.mLocation, layout.mComponents, layout.mType, stride, offset, &vbo);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::grow(size_t capacity) {
+  capacity = (capacity + cPageSize - 1) / cPageSize * cPageSize;
+
+  auto vbo = std::make_unique<VistaBufferObject>();
+  vbo->Bind(GL_ARRAY_BUFFER);
+  vbo->BufferData(static_cast<GLsizeiptr>(capacity * getSlotSize()), nullptr, GL_DYNAMIC_DRAW);
+  vbo->Release();
+
+  // The content of the old buffer is copied block by block. The new slots are tombstoned right
+  // away, as they are drawn as soon as they are allocated.
+  size_t oldCapacity = mCapacity;
+
+  if (oldCapacity > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, mVBO->GetId());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo->GetId());
+
+    size_t oldOffset = 0;
+    size_t newOffset = 0;
+
+    for (auto const& layout : cLayouts) {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+          static_cast<GLintptr>(oldOffset), static_cast<GLintptr>(newOffset),
+          static_cast<GLsizeiptr>(oldCapacity * layout.mSize));
+      oldOffset += oldCapacity * layout.mSize;
+      newOffset += capacity * layout.mSize;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  mVBO      = std::move(vbo);
+  mCapacity = capacity;
+
+  std::vector<float> removed(capacity - oldCapacity, cRemovedMagnitude);
+
+  mVBO->Bind(GL_ARRAY_BUFFER);
+  for (auto attribute : {Attribute::eAbsMagnitude, Attribute::eFarMagnitude}) {
+    size_t offset = getBlockOffset(attribute, mCapacity) + oldCapacity * sizeof(float);
+    mVBO->BufferSubData(static_cast<GLintptr>(offset),
+        static_cast<GLsizeiptr>(removed.size() * sizeof(float)), removed.data());
+  }
+  mVBO->Release();
+
+  specifyAttributes(mVAO, *mVBO, mCapacity);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarBuffer::tombstone(size_t first, size_t count) {
+  std::vector<float> removed(std::min(count, cPageSize), cRemovedMagnitude);
+
+  for (size_t i = 0; i < count; i += removed.size()) {
+    size_t chunkCount = std::min(removed.size(), count - i);
+    write(Attribute::eAbsMagnitude, first + i, chunkCount, removed.data());
+    write(Attribute::eFarMagnitude, first + i, chunkCount, removed.data());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStarBuffer::resize(size_t count) {
+  mData.resize(count * getSlotSize());
+  mStagedSize = count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* StreamingStarBuffer::getData(StarBuffer::Attribute attribute) {
+  return mData.data() + StarBuffer::getBlockOffset(attribute, mStagedSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStarBuffer::upload() {
+  // Passing the data to glBufferData allocates new storage, the old one is released by the driver
+  // once it is not used anymore.
+  mVBO.Bind(GL_ARRAY_BUFFER);
+  mVBO.BufferData(static_cast<GLsizeiptr>(mData.size()), mData.data(), GL_STREAM_DRAW);
+  mVBO.Release();
+
+  // The block offsets depend on the number of stars.
+  if (mUploadedSize != mStagedSize) {
+    StarBuffer::specifyAttributes(mVAO, mVBO, mStagedSize);
+    mUploadedSize = mStagedSize;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStarBuffer::bind() {
+  mVAO.Bind();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStarBuffer::release() {
+  mVAO.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StreamingStarBuffer::getSize() const {
+  return mUploadedSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StreamingStarBuffer::getSizeInBytes() const {
+  return mUploadedSize * getSlotSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StreamingStarBuffer::getStagedBytes() const {
+  return mData.capacity();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_STAR_BUFFER_HPP
+#define CSP_STARS_STAR_BUFFER_HPP
+
+#include <VistaOGLExt/VistaBufferObject.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace csp::stars {
+
+/// Manages the vertex buffer of the stars. Stars are stored in ranges of consecutive slots which
+/// can be allocated and removed individually, so that star sets can be changed without uploading
+/// all other stars again. The buffer grows in pages of cPageSize slots; when it grows, the old
+/// content is copied on the GPU.
+///
+/// Each attribute is stored in its own contiguous block. Writes are staged in main memory in
+/// chunks of at most one page and uploaded in the order in which they were made by flush(), which
+/// can be limited to a number of bytes per frame. Slots which do not belong to a range are
+/// tombstoned: Their magnitudes are set to cRemovedMagnitude, so that the star shaders discard
+/// them. Hence the buffer can always be drawn with getSize() vertices.
+class StarBuffer {
+ public:
+  /// The vertex attributes of the stars. The variable star index is an unsigned 16 bit integer,
+  /// directions are two floats (declination and ascension), all other attributes are one float.
+  enum class Attribute {
+    eDirection,
+    eDistance,
+    eColorIndex,
+    eAbsMagnitude,
+    eFarMagnitude,
+    eVariableIndex,
+    eCount
+  };
+
+  /// The number of slots by which the buffer grows.
+  static const size_t cPageSize;
+
+  /// The absolute and apparent magnitude of removed slots.
+  static const float cRemovedMagnitude;
+
+  /// This is called by compact() when a range has been moved.
+  using MoveCallback = std::function<void(size_t oldFirst, size_t newFirst, size_t count)>;
+
+  StarBuffer();
+  ~StarBuffer() = default;
+
+  StarBuffer(StarBuffer const& other) = delete;
+  StarBuffer(StarBuffer&& other)      = delete;
+  StarBuffer& operator=(StarBuffer const& other) = delete;
+  StarBuffer& operator=(StarBuffer&& other) = delete;
+
+  /// Allocates a range of count slots and returns the index of its first slot. The first gap
+  /// between the existing ranges which is large enough is reused, else the range is appended. The
+  /// slots stay removed until their absolute magnitude is uploaded, hence all other attributes of
+  /// the range should be written before the absolute magnitudes.
+  size_t allocate(size_t count);
+
+  /// Removes the range which starts at the given slot. If this was the last range, the video
+  /// memory is released.
+  void free(size_t first);
+
+  /// Stages count values of the given attribute for the slots starting at first. The data is
+  /// copied, it is uploaded by the next calls to flush().
+  void write(Attribute attribute, size_t first, size_t count, void const* data);
+
+  /// Uploads staged writes until at least maxBytes have been uploaded. Returns true if nothing is
+  /// staged anymore.
+  bool flush(size_t maxBytes = SIZE_MAX);
+
+  /// Moves the last range into the first gap which is large enough, so that fewer removed slots
+  /// are drawn. At most one range is moved per call and only if there are no staged writes, as
+  /// these refer to the old slots. Returns true if a range has been moved.
+  bool compact(MoveCallback const& onMove);
+
+  /// Removes all ranges and staged writes and releases the video memory.
+  void clear();
+
+  /// Binds and releases the vertex array object of the buffer.
+  void bind();
+  void release();
+
+  /// Returns the number of slots which have to be drawn. This includes removed slots in gaps.
+  size_t getSize() const;
+
+  /// Returns the number of removed slots below getSize().
+  size_t getNumRemoved() const;
+
+  /// Returns true if there are writes which have not been uploaded yet.
+  bool hasStagedWrites() const;
+
+  /// Returns the video memory used by the buffer and the main memory used by staged writes.
+  size_t getSizeInBytes() const;
+  size_t getStagedBytes() const;
+
+  /// Returns the size of one value of the given attribute in bytes.
+  static size_t getAttributeSize(Attribute attribute);
+
+  /// Returns the offset of the block of the given attribute in a buffer with the given capacity.
+  static size_t getBlockOffset(Attribute attribute, size_t capacity);
+
+  /// Points the vertex attributes of the star shaders to the blocks of the given buffer.
+  static void specifyAttributes(
+      VistaVertexArrayObject& vao, VistaBufferObject& vbo, size_t capacity);
+
+ private:
+  struct Chunk {
+    Attribute            mAttribute;
+    size_t               mFirst;
+    std::vector<uint8_t> mData;
+  };
+
+  /// Reallocates the buffer for at least the given number of slots.
+  void grow(size_t capacity);
+
+  /// Stages cRemovedMagnitude for the magnitudes of the given slots.
+  void tombstone(size_t first, size_t count);
+
+  std::unique_ptr<VistaBufferObject> mVBO;
+  VistaVertexArrayObject             mVAO;
+  size_t                             mCapacity = 0;
+
+  /// The allocated ranges; the key is the first slot, the value the number of slots.
+  std::map<size_t, size_t> mRanges;
+
+  std::deque<Chunk> mStagedChunks;
+  size_t            mStagedBytes = 0;
+};
+
+/// A vertex buffer with the same layout as StarBuffer for stars which change frequently, see
+/// Stars::setDynamicStars(). Its content is always replaced as a whole: The vertex data is written
+/// to getData() and then uploaded into new storage, orphaning the previous one. Hence the driver
+/// never has to wait until the GPU has finished drawing from the previous content.
+class StreamingStarBuffer {
+ public:
+  StreamingStarBuffer()  = default;
+  ~StreamingStarBuffer() = default;
+
+  StreamingStarBuffer(StreamingStarBuffer const& other) = delete;
+  StreamingStarBuffer(StreamingStarBuffer&& other)      = delete;
+  StreamingStarBuffer& operator=(StreamingStarBuffer const& other) = delete;
+  StreamingStarBuffer& operator=(StreamingStarBuffer&& other) = delete;
+
+  /// Resizes the staged vertex data to the given number of stars. Afterwards, all attributes have
+  /// to be written again.
+  void resize(size_t count);
+
+  /// Returns the staged values of the given attribute for all stars.
+  void* getData(StarBuffer::Attribute attribute);
+
+  /// Uploads the staged vertex data.
+  void upload();
+
+  /// Binds and releases the vertex array object of the buffer.
+  void bind();
+  void release();
+
+  /// Returns the number of stars which have been uploaded.
+  size_t getSize() const;
+
+  /// Returns the video memory used by the buffer and the main memory used by the staged data.
+  size_t getSizeInBytes() const;
+  size_t getStagedBytes() const;
+
+ private:
+  VistaBufferObject      mVBO;
+  VistaVertexArrayObject mVAO;
+  std::vector<uint8_t>   mData;
+  size_t                 mStagedSize   = 0;
+  size_t                 mUploadedSize = 0;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_STAR_BUFFER_HPP
@@ -0,0 +1,462 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StarIdentifiers.hpp"
+
+#include "CacheFile.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Decodes the variable-length, zig-zag encoded difference starting at bytes[offset], advances
+// offset to the next encoded value and returns the predecessor plus the decoded difference.
+uint32_t decodeNext(std::vector<uint8_t> const& bytes, size_t& offset, uint32_t predecessor) {
+  uint64_t zigZag = 0;
+  uint32_t shift  = 0;
+  uint8_t  byte   = 0;
+  do {
+    byte = bytes[offset++];
+    zigZag |= static_cast<uint64_t>(byte & 0x7FU) << shift;
+    shift += 7;
+  } while ((byte & 0x80U) != 0);
+
+  auto delta = static_cast<int64_t>(zigZag >> 1U) ^ -static_cast<int64_t>(zigZag & 1U);
+  return static_cast<uint32_t>(static_cast<int64_t>(predecessor) + delta);
+}
+
+// Like decodeNext(), but returns false instead of reading beyond the end of bytes or producing a
+// value outside of the range of uint32_t. This is used to validate deserialized columns.
+bool tryDecodeNext(
+    std::vector<uint8_t> const& bytes, size_t& offset, uint32_t predecessor, uint32_t& value) {
+  uint64_t zigZag = 0;
+  uint32_t shift  = 0;
+  uint8_t  byte   = 0;
+  do {
+    if (offset >= bytes.size() || shift > 63) {
+      return false;
+    }
+    byte = bytes[offset++];
+    zigZag |= static_cast<uint64_t>(byte & 0x7FU) << shift;
+    shift += 7;
+  } while ((byte & 0x80U) != 0);
+
+  auto delta  = static_cast<int64_t>(zigZag >> 1U) ^ -static_cast<int64_t>(zigZag & 1U);
+  auto result = static_cast<int64_t>(predecessor) + delta;
+
+  if (result < 0 || result > static_cast<int64_t>(UINT32_MAX)) {
+    return false;
+  }
+
+  value = static_cast<uint32_t>(result);
+  return true;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const size_t StarIdentifiers::DeltaColumn::cBlockSize = 128;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StarIdentifiers::StarIdentifiers(StarIdentifiers&& other) noexcept {
+  *this = std::move(other);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StarIdentifiers& StarIdentifiers::operator=(StarIdentifiers&& other) noexcept {
+  if (this != &other) {
+    mHipparcos       = std::move(other.mHipparcos);
+    mTycho           = std::move(other.mTycho);
+    mNames           = std::move(other.mNames);
+    mLookupsValid    = other.mLookupsValid;
+    mHipparcosLookup = std::move(other.mHipparcosLookup);
+    mTychoLookup     = std::move(other.mTychoLookup);
+    mNameLookup      = std::move(other.mNameLookup);
+
+    other.clear();
+  }
+
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t StarIdentifiers::packTycho(uint32_t tyc1, uint32_t tyc2, uint32_t tyc3) {
+  // TYC1 < 2^14, TYC2 < 2^14 and TYC3 < 2^3
+  return (tyc1 << 17U) | (tyc2 << 3U) | tyc3;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string StarIdentifiers::tychoToString(uint32_t packedTycho) {
+  return std::to_string(packedTycho >> 17U) + "-" + std::to_string((packedTycho >> 3U) & 0x3FFFU) +
+         "-" + std::to_string(packedTycho & 0x7U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::push_back(uint32_t hipparcos, uint32_t tycho) {
+  mHipparcos.push_back(hipparcos);
+  mTycho.push_back(tycho);
+  mLookupsValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarIdentifiers::size() const {
+  return mHipparcos.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::setName(size_t index, std::string name) {
+  if (name.empty()) {
+    mNames.erase(static_cast<uint32_t>(index));
+  } else {
+    mNames[static_cast<uint32_t>(index)] = std::move(name);
+  }
+
+  mLookupsValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& StarIdentifiers::getName(size_t index) const {
+  static const std::string empty;
+
+  auto it = mNames.find(static_cast<uint32_t>(index));
+  if (it == mNames.end()) {
+    return empty;
+  }
+
+  return it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::map<uint32_t, std::string> const& StarIdentifiers::getNames() const {
+  return mNames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::clear() {
+  mHipparcos.clear();
+  mTycho.clear();
+  mNames.clear();
+
+  mLookupsValid    = false;
+  mHipparcosLookup = {};
+  mTychoLookup     = {};
+  mNameLookup      = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t StarIdentifiers::getHipparcos(size_t index) const {
+  return mHipparcos.at(index);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t StarIdentifiers::getTycho(size_t index) const {
+  return mTycho.at(index);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint32_t> StarIdentifiers::decodeHipparcos() const {
+  std::vector<uint32_t> result(mHipparcos.size());
+  mHipparcos.forEach([&result](size_t index, uint32_t id) { result[index] = id; });
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint32_t> StarIdentifiers::decodeTycho() const {
+  std::vector<uint32_t> result(mTycho.size());
+  mTycho.forEach([&result](size_t index, uint32_t id) { result[index] = id; });
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<size_t> StarIdentifiers::findHipparcos(uint32_t hipparcos) const {
+  buildLookups();
+
+  auto it = mHipparcosLookup.find(hipparcos);
+  if (it == mHipparcosLookup.end()) {
+    return std::nullopt;
+  }
+
+  return it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<size_t> StarIdentifiers::findTycho(uint32_t packedTycho) const {
+  buildLookups();
+
+  auto it = mTychoLookup.find(packedTycho);
+  if (it == mTychoLookup.end()) {
+    return std::nullopt;
+  }
+
+  return it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<size_t> StarIdentifiers::findName(std::string const& name) const {
+  buildLookups();
+
+  auto it = mNameLookup.find(name);
+  if (it == mNameLookup.end()) {
+    return std::nullopt;
+  }
+
+  return it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarIdentifiers::getSizeInBytes() const {
+  size_t names = 0;
+  for (auto const& [index, name] : mNames) {
+    names += sizeof(index) + name.size();
+  }
+
+  return mHipparcos.getSizeInBytes() + mTycho.getSizeInBytes() + names;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::serialize(CacheWriter& writer) const {
+  mHipparcos.serialize(writer);
+  mTycho.serialize(writer);
+
+  writer.writeUInt32(static_cast<uint32_t>(mNames.size()));
+  for (auto const& [index, name] : mNames) {
+    writer.writeUInt32(index);
+    writer.writeString(name);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarIdentifiers::deserialize(CacheReader& reader) {
+  clear();
+
+  if (!mHipparcos.deserialize(reader) || !mTycho.deserialize(reader) ||
+      mHipparcos.size() != mTycho.size()) {
+    return false;
+  }
+
+  uint32_t numNames = 0;
+  if (!reader.readUInt32(numNames)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < numNames; ++i) {
+    uint32_t    index = 0;
+    std::string name;
+    if (!reader.readUInt32(index) || !reader.readString(name) || index >= mHipparcos.size()) {
+      return false;
+    }
+    mNames.emplace(index, std::move(name));
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::buildLookups() const {
+  std::lock_guard<std::mutex> lock(mLookupMutex);
+
+  if (mLookupsValid) {
+    return;
+  }
+
+  mHipparcosLookup.clear();
+  mTychoLookup.clear();
+  mNameLookup.clear();
+
+  mHipparcos.forEach([this](size_t index, uint32_t id) {
+    if (id != 0) {
+      mHipparcosLookup.emplace(id, static_cast<uint32_t>(index));
+    }
+  });
+
+  mTycho.forEach([this](size_t index, uint32_t id) {
+    if (id != 0) {
+      mTychoLookup.emplace(id, static_cast<uint32_t>(index));
+    }
+  });
+
+  for (auto const& [index, name] : mNames) {
+    mNameLookup.emplace(name, index);
+  }
+
+  mLookupsValid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::DeltaColumn::push_back(uint32_t value) {
+  if (mCount % cBlockSize == 0) {
+    mBlockValues.push_back(value);
+    mBlockOffsets.push_back(static_cast<uint32_t>(mBytes.size()));
+  } else {
+    // zig-zag encoding maps small negative and positive differences to small unsigned numbers
+    int64_t  delta  = static_cast<int64_t>(value) - static_cast<int64_t>(mLastValue);
+    uint64_t zigZag = (static_cast<uint64_t>(delta) << 1U) ^ static_cast<uint64_t>(delta >> 63);
+    do {
+      auto byte = static_cast<uint8_t>(zigZag & 0x7FU);
+      zigZag >>= 7U;
+      mBytes.push_back(zigZag != 0 ? (byte | 0x80U) : byte);
+    } while (zigZag != 0);
+  }
+
+  mLastValue = value;
+  ++mCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t StarIdentifiers::DeltaColumn::at(size_t index) const {
+  if (index >= mCount) {
+    throw std::out_of_range("Star identifier index out of range!");
+  }
+
+  size_t   block  = index / cBlockSize;
+  uint32_t value  = mBlockValues[block];
+  size_t   offset = mBlockOffsets[block];
+
+  for (size_t i = block * cBlockSize + 1; i <= index; ++i) {
+    value = decodeNext(mBytes, offset, value);
+  }
+
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+void StarIdentifiers::DeltaColumn::forEach(F const& func) const {
+  size_t   offset = 0;
+  uint32_t value  = 0;
+
+  for (size_t i = 0; i < mCount; ++i) {
+    if (i % cBlockSize == 0) {
+      value = mBlockValues[i / cBlockSize];
+    } else {
+      value = decodeNext(mBytes, offset, value);
+    }
+
+    func(i, value);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarIdentifiers::DeltaColumn::size() const {
+  return mCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::DeltaColumn::clear() {
+  mBytes        = {};
+  mBlockValues  = {};
+  mBlockOffsets = {};
+  mLastValue    = 0;
+  mCount        = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarIdentifiers::DeltaColumn::getSizeInBytes() const {
+  return mBytes.size() + (mBlockValues.size() + mBlockOffsets.size()) * sizeof(uint32_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarIdentifiers::DeltaColumn::serialize(CacheWriter& writer) const {
+  writer.writeUInt32(static_cast<uint32_t>(mCount));
+  writer.writeUInt32(mLastValue);
+  writer.writeUInt32(static_cast<uint32_t>(mBytes.size()));
+  writer.writeVector(mBytes);
+  writer.writeVector(mBlockValues);
+  writer.writeVector(mBlockOffsets);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarIdentifiers::DeltaColumn::deserialize(CacheReader& reader) {
+  uint32_t count    = 0;
+  uint32_t numBytes = 0;
+
+  if (!reader.readUInt32(count) || !reader.readUInt32(mLastValue) || !reader.readUInt32(numBytes)) {
+    clear();
+    return false;
+  }
+
+  // Each value except the first of each block needs at least one byte, so the counts of a corrupt
+  // segment are rejected before anything is allocated.
+  size_t numBlocks = (count + cBlockSize - 1) / cBlockSize;
+
+  if (numBytes < count - numBlocks ||
+      numBytes + 2 * numBlocks * sizeof(uint32_t) > reader.getRemainingSize()) {
+    clear();
+    return false;
+  }
+
+  if (!reader.readVector(mBytes, numBytes) || !reader.readVector(mBlockValues, numBlocks) ||
+      !reader.readVector(mBlockOffsets, numBlocks)) {
+    clear();
+    return false;
+  }
+
+  // The column is decoded once, so that at() and forEach() can rely on the block offsets and on
+  // the encoded differences staying inside mBytes.
+  size_t   offset = 0;
+  uint32_t value  = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (i % cBlockSize == 0) {
+      if (mBlockOffsets[i / cBlockSize] != offset) {
+        clear();
+        return false;
+      }
+      value = mBlockValues[i / cBlockSize];
+    } else if (!tryDecodeNext(mBytes, offset, value, value)) {
+      clear();
+      return false;
+    }
+  }
+
+  if (offset != mBytes.size() || value != mLastValue) {
+    clear();
+    return false;
+  }
+
+  mCount = count;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_STAR_IDENTIFIERS_HPP
+#define CSP_STARS_STAR_IDENTIFIERS_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::stars {
+
+class CacheWriter;
+class CacheReader;
+
+/// Stores the Hipparcos and Tycho identifiers and the proper names of all loaded stars. The
+/// identifiers are kept apart from the star data used for rendering and are stored delta-encoded,
+/// as the catalogs are sorted by identifier. Only few stars have a name, so the names are stored
+/// sparsely. The lookup tables from identifier to star index are only built when one of the
+/// find methods is called for the first time. The find methods may be called concurrently, the
+/// modifying methods must not be called while other threads access this object.
+class StarIdentifiers {
+ public:
+  StarIdentifiers() = default;
+
+  /// The lookup tables are moved as well.
+  StarIdentifiers(StarIdentifiers&& other) noexcept;
+  StarIdentifiers& operator=(StarIdentifiers&& other) noexcept;
+
+  StarIdentifiers(StarIdentifiers const& other) = delete;
+  StarIdentifiers& operator=(StarIdentifiers const& other) = delete;
+
+  ~StarIdentifiers() = default;
+
+  /// Packs a Tycho identifier (TYC1-TYC2-TYC3) into 31 bits. Zero is never a valid packed Tycho
+  /// identifier, as TYC3 is at least one.
+  static uint32_t    packTycho(uint32_t tyc1, uint32_t tyc2, uint32_t tyc3);
+  static std::string tychoToString(uint32_t packedTycho);
+
+  /// Appends the identifiers of one star. Zero means that the star has no identifier in the
+  /// respective catalog.
+  void push_back(uint32_t hipparcos, uint32_t tycho);
+
+  size_t size() const;
+
+  /// Sets the proper name of the star at the given index, e.g. "Sirius". An empty name removes it.
+  void setName(size_t index, std::string name);
+
+  /// Returns the proper name of the star at the given index or an empty string if it has none.
+  std::string const& getName(size_t index) const;
+
+  /// Returns the proper names of all stars which have one, indexed by star index.
+  std::map<uint32_t, std::string> const& getNames() const;
+
+  /// Removes all identifiers and frees the memory.
+  void clear();
+
+  /// Returns the identifiers of the star at the given index. Zero means that the star has no
+  /// identifier in the respective catalog.
+  uint32_t getHipparcos(size_t index) const;
+  uint32_t getTycho(size_t index) const;
+
+  /// Returns the identifiers of all stars.
+  std::vector<uint32_t> decodeHipparcos() const;
+  std::vector<uint32_t> decodeTycho() const;
+
+  /// Returns the index of the star with the given identifier, if there is one.
+  std::optional<size_t> findHipparcos(uint32_t hipparcos) const;
+  std::optional<size_t> findTycho(uint32_t packedTycho) const;
+
+  /// Returns the index of the star with the given proper name, if there is one. The name is
+  /// compared case-sensitively.
+  std::optional<size_t> findName(std::string const& name) const;
+
+  /// Returns the number of bytes used by the encoded columns and the names.
+  size_t getSizeInBytes() const;
+
+  void serialize(CacheWriter& writer) const;
+  bool deserialize(CacheReader& reader);
+
+ private:
+  /// A column of unsigned integers stored as zig-zag encoded variable-length differences to the
+  /// respective predecessor. Every cBlockSize values, the absolute value and the byte offset are
+  /// stored so that random access has to decode at most cBlockSize values.
+  class DeltaColumn {
+   public:
+    void     push_back(uint32_t value);
+    uint32_t at(size_t index) const;
+    size_t   size() const;
+    void     clear();
+    size_t   getSizeInBytes() const;
+
+    /// Calls func(index, value) for all values in the column.
+    template <typename F>
+    void forEach(F const& func) const;
+
+    void serialize(CacheWriter& writer) const;
+    bool deserialize(CacheReader& reader);
+
+   private:
+    static const size_t cBlockSize;
+
+    std::vector<uint8_t>  mBytes;
+    std::vector<uint32_t> mBlockValues;
+    std::vector<uint32_t> mBlockOffsets;
+    uint32_t              mLastValue = 0;
+    size_t                mCount     = 0;
+  };
+
+  void buildLookups() const;
+
+  DeltaColumn mHipparcos;
+  DeltaColumn mTycho;
+
+  std::map<uint32_t, std::string> mNames;
+
+  mutable std::mutex                                mLookupMutex;
+  mutable bool                                      mLookupsValid = false;
+  mutable std::unordered_map<uint32_t, uint32_t>    mHipparcosLookup;
+  mutable std::unordered_map<uint32_t, uint32_t>    mTychoLookup;
+  mutable std::unordered_map<std::string, uint32_t> mNameLookup;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_STAR_IDENTIFIERS_HPP
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include <doctest.h>
+
+#include "CacheFile.hpp"
+#include "StarIdentifiers.hpp"
+
+#include <filesystem>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::StarIdentifiers::packTycho") {
+  uint32_t packed = StarIdentifiers::packTycho(9999, 16383, 4);
+  CHECK(packed != 0);
+  CHECK(StarIdentifiers::tychoToString(packed) == "9999-16383-4");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::stars::StarIdentifiers::serialize / deserialize") {
+  std::string file = (std::filesystem::temp_directory_path() / "csp-stars-test-ids.dat").string();
+
+  // The columns are delta-encoded in blocks, so there are enough stars for several blocks. The
+  // identifiers are mostly ascending, but contain gaps, zeros and descending values as well.
+  std::vector<uint32_t> hipparcos;
+  std::vector<uint32_t> tycho;
+
+  for (uint32_t i = 0; i < 5000; ++i) {
+    hipparcos.push_back(i % 7 == 0 ? 0 : i * 3 + (i % 5 == 0 ? 100000 : 0));
+    tycho.push_back(i % 11 == 0 ? 0 : StarIdentifiers::packTycho(i % 9000, 5000 - i, 1 + i % 3));
+  }
+  hipparcos.back() = UINT32_MAX;
+
+  StarIdentifiers identifiers;
+  for (size_t i = 0; i < hipparcos.size(); ++i) {
+    identifiers.push_back(hipparcos[i], tycho[i]);
+  }
+  identifiers.setName(1, "Sirius");
+  identifiers.setName(4321, "Vega");
+
+  {
+    CacheWriter writer(file);
+    identifiers.serialize(writer);
+    REQUIRE(writer.commit());
+  }
+
+  CacheReader     reader(file);
+  StarIdentifiers read;
+  REQUIRE(reader.isValid());
+  REQUIRE(read.deserialize(reader));
+
+  CHECK(read.size() == hipparcos.size());
+  CHECK(read.decodeHipparcos() == hipparcos);
+  CHECK(read.decodeTycho() == tycho);
+  CHECK(read.getHipparcos(4998) == hipparcos[4998]);
+  CHECK(read.getTycho(4998) == tycho[4998]);
+
+  CHECK(read.getNames().size() == 2);
+  CHECK(read.getName(4321) == "Vega");
+  CHECK(read.getName(2).empty());
+  CHECK(read.findName("Sirius") == 1);
+  CHECK(read.findHipparcos(hipparcos[1234]) == 1234);
+  CHECK(read.findTycho(tycho[1234]) == 1234);
+  CHECK_FALSE(read.findHipparcos(2).has_value());
+
+  std::filesystem::remove(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
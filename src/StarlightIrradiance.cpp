@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StarlightIrradiance.hpp"
+
+#include "CacheFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const float cPi = 3.14159265358979F;
+
+// Evaluates the real spherical-harmonic basis functions of the first three bands.
+std::array<float, StarlightIrradiance::cNumCoefficients> evaluateBasis(
+    float x, float y, float z) {
+  return {0.282095F, 0.488603F * y, 0.488603F * z, 0.488603F * x, 1.092548F * x * y,
+      1.092548F * y * z, 0.315392F * (3.F * z * z - 1.F), 1.092548F * x * z,
+      0.546274F * (x * x - y * y)};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int StarlightIrradiance::cNSide = 8;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarlightIrradiance::getNumPixels() {
+  return static_cast<size_t>(12 * cNSide * cNSide);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t StarlightIrradiance::getPixel(VistaVector3D const& direction) {
+  // This follows ang2pix_ring of the HEALPix library, with the y-axis as pole.
+  float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                           direction[2] * direction[2]);
+  float z      = length > 0.F ? std::clamp(direction[1] / length, -1.F, 1.F) : 1.F;
+  float phi    = std::atan2(direction[2], direction[0]);
+
+  if (phi < 0.F) {
+    phi += 2.F * cPi;
+  }
+
+  const int nl4 = 4 * cNSide;
+  float     za  = std::abs(z);
+  float     tt  = std::min(phi / (0.5F * cPi), 4.F - 1e-6F); // in [0,4)
+
+  if (za <= 2.F / 3.F) {
+    // Equatorial region: Rings of 4 * nside pixels each.
+    float temp1  = static_cast<float>(cNSide) * (0.5F + tt);
+    float temp2  = static_cast<float>(cNSide) * z * 0.75F;
+    int   jp     = static_cast<int>(temp1 - temp2); // index of ascending edge line
+    int   jm     = static_cast<int>(temp1 + temp2); // index of descending edge line
+    int   ir     = cNSide + 1 + jp - jm;            // ring number counted from z=2/3
+    int   kshift = 1 - (ir & 1);
+    int   ip     = ((jp + jm - cNSide + kshift + 1 + 2 * nl4) / 2) % nl4;
+
+    return static_cast<size_t>(2 * cNSide * (cNSide - 1) + (ir - 1) * nl4 + ip);
+  }
+
+  // Polar caps: The number of pixels per ring grows towards the equator.
+  float tp  = tt - std::floor(tt);
+  float tmp = static_cast<float>(cNSide) * std::sqrt(3.F * (1.F - za));
+  int   jp  = static_cast<int>(tp * tmp);         // increasing edge line index
+  int   jm  = static_cast<int>((1.F - tp) * tmp); // decreasing edge line index
+  int   ir  = std::min(jp + jm + 1, cNSide);      // ring number counted from the closest pole
+  int   ip  = std::min(static_cast<int>(tt * static_cast<float>(ir)), 4 * ir - 1);
+
+  if (z > 0.F) {
+    return static_cast<size_t>(2 * ir * (ir - 1) + ip);
+  }
+
+  return getNumPixels() - static_cast<size_t>(2 * ir * (ir + 1) - ip);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarlightIrradiance::add(
+    VistaVector3D const& direction, std::array<float, 3> const& illuminance) {
+  // The radiance of a point light is a delta function, hence its projection onto each basis
+  // function is the basis function evaluated in the light's direction.
+  auto basis = evaluateBasis(direction[0], direction[1], direction[2]);
+
+  for (size_t i = 0; i < cNumCoefficients; ++i) {
+    for (size_t c = 0; c < 3; ++c) {
+      mCoefficients.at(3 * i + c) += basis.at(i) * illuminance.at(c);
+    }
+  }
+
+  // The HEALPix pixels all cover the same solid angle.
+  float  pixelSolidAngle = 4.F * cPi / static_cast<float>(getNumPixels());
+  size_t pixel           = getPixel(direction);
+
+  for (size_t c = 0; c < 3; ++c) {
+    mRadianceMap[3 * pixel + c] += illuminance.at(c) / pixelSolidAngle;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarlightIrradiance::add(StarlightIrradiance const& other) {
+  for (size_t i = 0; i < mCoefficients.size(); ++i) {
+    mCoefficients.at(i) += other.mCoefficients.at(i);
+  }
+
+  for (size_t i = 0; i < mRadianceMap.size(); ++i) {
+    mRadianceMap[i] += other.mRadianceMap[i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarlightIrradiance::clear() {
+  mCoefficients.fill(0.F);
+  std::fill(mRadianceMap.begin(), mRadianceMap.end(), 0.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaColor StarlightIrradiance::getIrradiance(VistaVector3D const& normal) const {
+  // The convolution with the clamped cosine scales each band by a constant factor, see Ramamoorthi
+  // and Hanrahan: "An Efficient Representation for Irradiance Environment Maps".
+  const std::array<float, 3> bandFactors = {cPi, 2.F * cPi / 3.F, cPi / 4.F};
+  const std::array<size_t, cNumCoefficients> bands = {0, 1, 1, 1, 2, 2, 2, 2, 2};
+
+  auto                 basis = evaluateBasis(normal[0], normal[1], normal[2]);
+  std::array<float, 3> result{};
+
+  for (size_t i = 0; i < cNumCoefficients; ++i) {
+    for (size_t c = 0; c < 3; ++c) {
+      result.at(c) += bandFactors.at(bands.at(i)) * basis.at(i) * mCoefficients.at(3 * i + c);
+    }
+  }
+
+  // The truncated expansion may ring slightly below zero opposite to bright regions.
+  return VistaColor(
+      std::max(result[0], 0.F), std::max(result[1], 0.F), std::max(result[2], 0.F), 1.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaColor StarlightIrradiance::getRadiance(VistaVector3D const& direction) const {
+  size_t pixel = getPixel(direction);
+  return VistaColor(mRadianceMap[3 * pixel], mRadianceMap[3 * pixel + 1],
+      mRadianceMap[3 * pixel + 2], 1.F);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::array<float, 3 * StarlightIrradiance::cNumCoefficients> const&
+StarlightIrradiance::getCoefficients() const {
+  return mCoefficients;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<float> const& StarlightIrradiance::getRadianceMap() const {
+  return mRadianceMap;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StarlightIrradiance::serialize(CacheWriter& writer) const {
+  writer.writeUInt32(static_cast<uint32_t>(cNSide));
+  writer.writeRaw(mCoefficients.data(), mCoefficients.size() * sizeof(float));
+  writer.writeVector(mRadianceMap);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StarlightIrradiance::deserialize(CacheReader& reader) {
+  uint32_t nside = 0;
+
+  if (!reader.readUInt32(nside) || nside != static_cast<uint32_t>(cNSide) ||
+      !reader.readRaw(mCoefficients.data(), mCoefficients.size() * sizeof(float)) ||
+      !reader.readVector(mRadianceMap, 3 * getNumPixels())) {
+    clear();
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
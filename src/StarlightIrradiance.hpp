@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_STARLIGHT_IRRADIANCE_HPP
+#define CSP_STARS_STARLIGHT_IRRADIANCE_HPP
+
+#include <VistaBase/VistaColor.h>
+#include <VistaBase/VistaVectorMath.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace csp::stars {
+
+class CacheReader;
+class CacheWriter;
+
+/// The integrated light of many stars, stored in two forms: As spherical-harmonic coefficients up
+/// to the second band, from which the irradiance on a surface with a given normal can be evaluated,
+/// and as a small HEALPix map (ring scheme) of the radiance in each direction. Both can be queried
+/// in constant time. The y-axis is the pole of the HEALPix map, matching the star frame in which
+/// the declination is measured from the xz-plane. All values are in lux (irradiance) and lux per
+/// steradian (radiance), split into linear RGB.
+class StarlightIrradiance {
+ public:
+  /// The HEALPix resolution parameter. The map has 12 * cNSide * cNSide pixels.
+  static const int cNSide;
+
+  /// The number of spherical-harmonic coefficients per color channel.
+  static const size_t cNumCoefficients = 9;
+
+  static size_t getNumPixels();
+
+  /// Returns the index of the HEALPix pixel which contains the given direction. The direction
+  /// does not need to be normalized.
+  static size_t getPixel(VistaVector3D const& direction);
+
+  /// Adds a point light source with the given illuminance (as received at normal incidence) from
+  /// the given unit direction.
+  void add(VistaVector3D const& direction, std::array<float, 3> const& illuminance);
+
+  /// Adds all light accumulated in another instance, e.g. one computed on another thread.
+  void add(StarlightIrradiance const& other);
+
+  void clear();
+
+  /// Returns the irradiance on a surface with the given unit normal.
+  VistaColor getIrradiance(VistaVector3D const& normal) const;
+
+  /// Returns the average radiance of the HEALPix pixel in the given direction.
+  VistaColor getRadiance(VistaVector3D const& direction) const;
+
+  /// The spherical-harmonic coefficients of the radiance, three per coefficient (RGB).
+  std::array<float, 3 * cNumCoefficients> const& getCoefficients() const;
+
+  /// The radiance of each HEALPix pixel, three floats (RGB) per pixel in ring order.
+  std::vector<float> const& getRadianceMap() const;
+
+  void serialize(CacheWriter& writer) const;
+  bool deserialize(CacheReader& reader);
+
+ private:
+  std::array<float, 3 * cNumCoefficients> mCoefficients{};
+  std::vector<float>                      mRadianceMap = std::vector<float>(3 * getNumPixels());
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_STARLIGHT_IRRADIANCE_HPP
@@ -6,16 +6,16 @@
 
 #include "Stars.hpp"
 
+#include "ArrowFile.hpp"
+#include "CacheFile.hpp"
+#include "CsvTokenizer.hpp"
+#include "Tracing.hpp"
 #include "logger.hpp"
 
-#include "../../../src/cs-graphics/TextureLoader.hpp"
-
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
-#include <VistaInterProcComm/Connections/VistaByteBufferDeSerializer.h>
-#include <VistaInterProcComm/Connections/VistaByteBufferSerializer.h>
 #include <VistaKernel/GraphicsManager/VistaGeometryFactory.h>
 #include <VistaKernel/GraphicsManager/VistaOpenGLNode.h>
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
@@ -25,9 +25,23 @@
 #include <VistaOGLExt/VistaTexture.h>
 #include <VistaOGLExt/VistaVertexArrayObject.h>
 #include <VistaTools/tinyXML/tinyxml.h>
+#include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <thread>
 
 namespace csp::stars {
 
@@ -61,682 +75,4183 @@ const std::array sSpectralColors = {VistaColor(0x9bb2ff), VistaColor(0x9eb5ff),
     VistaColor(0xffb765), VistaColor(0xffa94b), VistaColor(0xff9523), VistaColor(0xff7b00),
     VistaColor(0xff5200)};
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// The star color lookup table covers these B-V color indices and these log10 distances in parsec.
+const int   cColorLUTSize = 256;
+const float cMinColorIndex(-0.4F);
+const float cMaxColorIndex(2.0F);
+const float cMinLogDistance(0.F);
+const float cMaxLogDistance(5.F);
 
-} // namespace
+// Stars without a parallax are assumed to be this far away from the sun, in parsecs.
+const float cUnknownDistance = 100000.F;
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// An apparent magnitude of zero corresponds to this illuminance in lux.
+const float cZeroMagnitudeIlluminance = 2.54e-6F;
 
-const std::array<std::array<int, Stars::NUM_COLUMNS>, Stars::NUM_CATALOGS> Stars::cColumnMapping{
-    std::array{34, 32, 11, 8, 9, 31}, // CatalogType::eHipparcos
-    std::array{34, 32, 11, 8, 9, 31}, // CatalogType::eTycho
-    std::array{19, 17, -1, 2, 3, 23}  // CatalogType::eTycho2
-};
+float srgbToLinear(float value) {
+  return value <= 0.04045F ? value / 12.92F : std::pow((value + 0.055F) / 1.055F, 2.4F);
+}
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the linear spectral color for the given B-V color index by interpolating sSpectralColors.
+std::array<float, 3> getSpectralColor(float bvIndex) {
+  const float step(0.05F);
+  float       bvClamped = std::clamp(bvIndex, cMinColorIndex, cMaxColorIndex);
+  float       position  = (bvClamped - cMinColorIndex) / step;
+  auto        index     = std::min(static_cast<size_t>(position), sSpectralColors.size() - 2);
+  float       alpha     = position - static_cast<float>(index);
 
-// Increase this if the cache format changed and is incompatible now. This will
-// force a reload.
-const int Stars::cCacheVersion = 3;
+  VistaColor const& a = sSpectralColors.at(index);
+  VistaColor const& b = sSpectralColors.at(index + 1);
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+  return {srgbToLinear(a.GetRed() + alpha * (b.GetRed() - a.GetRed())),
+      srgbToLinear(a.GetGreen() + alpha * (b.GetGreen() - a.GetGreen())),
+      srgbToLinear(a.GetBlue() + alpha * (b.GetBlue() - a.GetBlue()))};
+}
 
-void Stars::setCatalogs(std::map<Stars::CatalogType, std::string> catalogs) {
-  if (mCatalogs != catalogs) {
+// Returns the linear color of a black body with the temperature estimated from the given B-V
+// color index. The temperature is computed with the formula of Ballesteros (2012), the conversion
+// to sRGB uses the approximation of Tanner Helland.
+std::array<float, 3> getBlackbodyColor(float bvIndex) {
+  float temperature =
+      4600.F * (1.F / (0.92F * bvIndex + 1.7F) + 1.F / (0.92F * bvIndex + 0.62F));
+  float t = temperature / 100.F;
+
+  float r = t <= 66.F ? 255.F : 329.698727446F * std::pow(t - 60.F, -0.1332047592F);
+  float g = t <= 66.F ? 99.4708025861F * std::log(t) - 161.1195681661F
+                      : 288.1221695283F * std::pow(t - 60.F, -0.0755148492F);
+  float b = 255.F;
+  if (t <= 19.F) {
+    b = 0.F;
+  } else if (t < 66.F) {
+    b = 138.5177312231F * std::log(t - 10.F) - 305.0447927307F;
+  }
 
-    mCatalogs = std::move(catalogs);
+  return {srgbToLinear(std::clamp(r, 0.F, 255.F) / 255.F),
+      srgbToLinear(std::clamp(g, 0.F, 255.F) / 255.F),
+      srgbToLinear(std::clamp(b, 0.F, 255.F) / 255.F)};
+}
 
-    // Clear stars first.
-    mStars.clear();
+// Computes the color lookup table for the given color model. The table contains linear RGB values
+// which are normalized so that the brightest channel is one.
+std::vector<float> createColorLUT(Stars::ColorModel model) {
+  std::vector<float> lut(3 * cColorLUTSize);
+
+  for (int i = 0; i < cColorLUTSize; ++i) {
+    float alpha   = static_cast<float>(i) / static_cast<float>(cColorLUTSize - 1);
+    float bvIndex = cMinColorIndex + alpha * (cMaxColorIndex - cMinColorIndex);
+
+    std::array<float, 3> color{};
+
+    if (model == Stars::ColorModel::eSpectral) {
+      color = getSpectralColor(bvIndex);
+    } else if (model == Stars::ColorModel::eBlackbody) {
+      color = getBlackbodyColor(bvIndex);
+    } else if (model == Stars::ColorModel::eDesaturated) {
+      // The human eye perceives star colors much less saturated than they actually are.
+      color           = getSpectralColor(bvIndex);
+      float luminance = 0.2126F * color[0] + 0.7152F * color[1] + 0.0722F * color[2];
+      for (auto& c : color) {
+        c = luminance + 0.35F * (c - luminance);
+      }
+    } else if (model == Stars::ColorModel::eDistance) {
+      // hue from blue (near) to red (far)
+      float hue = 4.F * (1.F - alpha);
+      color     = {std::clamp(std::abs(hue - 3.F) - 1.F, 0.F, 1.F),
+          std::clamp(2.F - std::abs(hue - 2.F), 0.F, 1.F),
+          std::clamp(2.F - std::abs(hue - 4.F), 0.F, 1.F)};
+    }
 
-    // Read star catalogs.
-    if (!readStarCache(mCacheFile)) {
-      std::map<CatalogType, std::string>::const_iterator it;
+    float maxChannel = std::max({color[0], color[1], color[2], 0.0001F});
+    for (int c = 0; c < 3; ++c) {
+      lut[3 * i + c] = color.at(c) / maxChannel;
+    }
+  }
 
-      it = mCatalogs.find(CatalogType::eHipparcos);
-      if (it != mCatalogs.end()) {
-        readStarsFromCatalog(it->first, it->second);
-      }
+  return lut;
+}
 
-      it = mCatalogs.find(CatalogType::eTycho);
-      if (it != mCatalogs.end()) {
-        readStarsFromCatalog(it->first, it->second);
-      }
+// Creates a simple star sprite which is used until the configured star texture has been loaded.
+// The intensity falls off like a Gaussian which reaches zero at the border of the texture.
+std::unique_ptr<VistaTexture> createFallbackStarTexture() {
+  const int            size = 64;
+  std::vector<uint8_t> pixels(size * size * 4);
+
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      float dx        = (static_cast<float>(x) + 0.5F) / (0.5F * size) - 1.F;
+      float dy        = (static_cast<float>(y) + 0.5F) / (0.5F * size) - 1.F;
+      float r2        = std::min(1.F, dx * dx + dy * dy);
+      float intensity = (std::exp(-8.F * r2) - std::exp(-8.F)) / (1.F - std::exp(-8.F));
+      auto  value     = static_cast<uint8_t>(255.F * intensity + 0.5F);
+
+      size_t i      = 4 * (y * size + x);
+      pixels[i]     = value;
+      pixels[i + 1] = value;
+      pixels[i + 2] = value;
+      pixels[i + 3] = 255;
+    }
+  }
 
-      it = mCatalogs.find(CatalogType::eTycho2);
-      if (it != mCatalogs.end()) {
-        // do not load tycho and tycho 2
-        if (mCatalogs.find(CatalogType::eTycho) == mCatalogs.end()) {
-          readStarsFromCatalog(it->first, it->second);
-        } else {
-          logger().warn("Failed to load Tycho2 catalog: Tycho already loaded!");
-        }
-      }
+  auto texture = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+  texture->Bind();
+  AsyncTexture::uploadPointSpread(size, size, pixels.data());
+  texture->SetMinFilter(GL_LINEAR_MIPMAP_LINEAR);
+  texture->SetMagFilter(GL_LINEAR);
+  texture->SetWrapS(GL_CLAMP_TO_EDGE);
+  texture->SetWrapT(GL_CLAMP_TO_EDGE);
+  texture->Unbind();
 
-      if (!mStars.empty()) {
-        writeStarCache(mCacheFile);
-      } else {
-        logger().warn("Loaded no stars! Stars will not work properly.");
+  return texture;
+}
+
+// Returns the length of the region coordinates at the beginning of the given string, i.e. of three
+// integers separated by underscores like "12_-3_0", or zero if it does not start with them.
+size_t getRegionLength(std::string_view name) {
+  size_t length = 0;
+
+  for (int i = 0; i < 3; ++i) {
+    if (i > 0) {
+      if (length >= name.size() || name[length] != '_') {
+        return 0;
       }
+      ++length;
+    }
+
+    if (length < name.size() && name[length] == '-') {
+      ++length;
+    }
+
+    size_t digits = 0;
+    while (length + digits < name.size() &&
+           std::isdigit(static_cast<unsigned char>(name[length + digits]))) {
+      ++digits;
     }
 
-    // Create buffers,
-    buildStarVAO();
-    buildBackgroundVAO();
+    if (digits == 0) {
+      return 0;
+    }
+    length += digits;
   }
+
+  return length;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Removes all but the given number of most recently written files in the directory of prefix
+// whose names consist of the file name of prefix, region coordinates and the given suffix. Files
+// of other ingest filters, lock files and temporary files are left alone.
+void removeOldCacheFiles(std::string const& prefix, std::string const& suffix, size_t keep) {
+  std::filesystem::path directory = std::filesystem::path(prefix).parent_path();
+  std::string           name      = std::filesystem::path(prefix).filename().string();
 
-std::map<Stars::CatalogType, std::string> const& Stars::getCatalogs() const {
-  return mCatalogs;
+  if (directory.empty()) {
+    directory = ".";
+  }
+
+  std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+  std::error_code                                                                 error;
+
+  for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error)) {
+    std::string file = it->path().filename().string();
+
+    if (file.size() > name.size() + suffix.size() && file.rfind(name, 0) == 0 &&
+        file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+        getRegionLength(file.substr(name.size())) == file.size() - name.size() - suffix.size()) {
+      files.emplace_back(std::filesystem::last_write_time(it->path(), error), it->path());
+    }
+  }
+
+  if (files.size() <= keep) {
+    return;
+  }
+
+  std::sort(files.begin(), files.end(), [](auto const& a, auto const& b) { return a > b; });
+
+  for (size_t i = keep; i < files.size(); ++i) {
+    std::filesystem::remove(files[i].second, error);
+  }
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the size of the given file in bytes or -1 if it cannot be opened.
+int64_t getFileSize(std::string const& filename) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return -1;
+  }
+  return static_cast<int64_t>(file.tellg());
+}
 
-void Stars::setCacheFile(std::string cacheFile) {
-  mCacheFile = std::move(cacheFile);
+// Counts the bytes of the lines which have been read from a catalog file. The count is published
+// every few lines only, as the atomic store may be contended.
+class CatalogProgress {
+ public:
+  CatalogProgress(std::atomic<bool> const& cancelled, std::atomic<int64_t>& bytesRead)
+      : mCancelled(cancelled)
+      , mBytesRead(bytesRead) {
+  }
+
+  // Adds the given line to the count. Returns false if loading has been cancelled.
+  bool addLine(std::string const& line) {
+    mBytes += static_cast<int64_t>(line.size()) + 1;
+    if (++mLines % 1024 == 0) {
+      mBytesRead.store(mBytes, std::memory_order_relaxed);
+    }
+
+    return !mCancelled.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> const& mCancelled;
+  std::atomic<int64_t>&    mBytesRead;
+  int64_t                  mBytes = 0;
+  int                      mLines = 0;
+};
+
+// HYG stores this distance in parsecs for stars without a known parallax.
+const float cUnknownCsvDistance = 100000.F;
+
+// Returns true if the given catalog row contains any of the flags which are rejected by the filter
+// for the given catalog. The items are either strings or string views.
+template <typename T>
+bool hasRejectedFlag(Stars::IngestFilter const& filter, Stars::CatalogType type,
+    std::vector<T> const& items) {
+  for (auto const& flag : filter.mRejectedFlags) {
+    if (flag.mCatalog == type && flag.mColumn >= 0 &&
+        static_cast<size_t>(flag.mColumn) < items.size() &&
+        items[flag.mColumn].find_first_of(flag.mCharacters) != T::npos) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns true if the given position in degrees is inside the given polygon. The polygon may
+// extend beyond 360 degrees of right ascension, hence the position is also tested with the
+// right ascension shifted by a full turn.
+bool isInsideRegion(
+    std::vector<std::array<float, 2>> const& polygon, float ascension, float declination) {
+  for (float shift : {0.F, -360.F, 360.F}) {
+    float x      = ascension + shift;
+    bool  inside = false;
+
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+      auto const& a = polygon[i];
+      auto const& b = polygon[j];
+
+      if ((a[1] > declination) != (b[1] > declination) &&
+          x < (b[0] - a[0]) * (declination - a[1]) / (b[1] - a[1]) + a[0]) {
+        inside = !inside;
+      }
+    }
 
-std::string const& Stars::getCacheFile() const {
-  return mCacheFile;
+    if (inside) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns true if the filter has no regions or if the given position in degrees is inside any of
+// them.
+bool isInsideRegions(Stars::IngestFilter const& filter, float ascension, float declination) {
+  return filter.mRegions.empty() ||
+         std::any_of(filter.mRegions.begin(), filter.mRegions.end(), [&](auto const& region) {
+           return isInsideRegion(region, ascension, declination);
+         });
+}
 
-void Stars::setDrawMode(Stars::DrawMode value) {
-  if (mDrawMode != value) {
-    mShaderDirty = true;
-    mDrawMode    = value;
+// Splits the range [0, count) into contiguous chunks and calls func(begin, end) for each chunk on
+// its own thread. The chunks are large enough so that the thread startup costs are negligible.
+template <typename F>
+void parallelFor(size_t count, F const& func) {
+  const size_t minChunkSize = 16384;
+  size_t       numThreads   = std::max(1U, std::thread::hardware_concurrency());
+  numThreads                = std::min(numThreads, (count + minChunkSize - 1) / minChunkSize);
+
+  if (numThreads <= 1) {
+    func(size_t(0), count);
+    return;
+  }
+
+  size_t                   chunkSize = (count + numThreads - 1) / numThreads;
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+
+  for (size_t i = 1; i < numThreads; ++i) {
+    size_t begin = std::min(count, i * chunkSize);
+    size_t end   = std::min(count, begin + chunkSize);
+    threads.emplace_back([&func, begin, end]() { func(begin, end); });
+  }
+
+  func(size_t(0), std::min(count, chunkSize));
+
+  for (auto& thread : threads) {
+    thread.join();
   }
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// The layout of a shared memory segment with star data: The header is followed by the catalog
+// fingerprint and by cNumSharedColumns arrays of 32 bit values with one value per star. These are
+// the five star data columns, the magnitude order and the Hipparcos and Tycho identifiers. Each
+// array starts at a multiple of 16 bytes. The arrays are followed by mNamesSize bytes with the
+// proper names, each stored as star index, name length and characters. mReady is set once the
+// segment has been filled.
+struct SharedStarsHeader {
+  uint32_t              mMagic;
+  uint32_t              mVersion;
+  std::atomic<uint32_t> mReady;
+  uint32_t              mFingerprintSize;
+  uint64_t              mNumStars;
+  uint64_t              mNamesSize;
+};
 
-Stars::DrawMode Stars::getDrawMode() const {
-  return mDrawMode;
+const uint32_t cSharedStarsMagic   = 0x53524154; // "STAR"
+const size_t   cNumSharedColumns   = 8;
+const double   cSharedStarsTimeout = 60.0;
+
+size_t alignSharedOffset(size_t offset) {
+  return (offset + 15) / 16 * 16;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t getSharedColumnOffset(size_t fingerprintSize, size_t numStars, size_t column) {
+  return alignSharedOffset(sizeof(SharedStarsHeader) + fingerprintSize) +
+         column * alignSharedOffset(numStars * sizeof(uint32_t));
+}
 
-void Stars::setEnableHDR(bool value) {
-  if (mEnableHDR != value) {
-    mShaderDirty = true;
-    mEnableHDR   = value;
+// Cluster messages consist of the catalog fingerprint, the session of the cluster transport and a
+// number which is incremented for each message of the session: "<fingerprint>#<session>:<number>".
+bool parseClusterMessage(
+    std::string const& message, std::string& fingerprint, std::string& session) {
+  size_t separator = message.rfind('#');
+  size_t number    = message.rfind(':');
+
+  if (separator == std::string::npos || number == std::string::npos || number < separator) {
+    return false;
   }
+
+  fingerprint = message.substr(0, separator);
+  session     = message.substr(separator + 1, number - separator - 1);
+
+  return true;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+// Called for segments which are not ready yet. Filling a segment takes far less than
+// cSharedStarsTimeout seconds, so an older incomplete segment has been left behind by a crashed
+// process. Its name is removed, so that the stars can be published again.
+void removeStaleSharedStars(std::string const& name) {
+  auto modified = SharedMemory::getModificationTime(name);
+  if (!modified) {
+    return;
+  }
 
-void Stars::setSolidAngle(float value) {
-  mSolidAngle = value;
+  if (std::difftime(std::time(nullptr), *modified) > cSharedStarsTimeout) {
+    logger().warn("Removing shared star data '{}': It has not been completed.", name);
+    SharedMemory::remove(name);
+  } else {
+    logger().info("Ignoring shared star data '{}': It is incomplete.", name);
+  }
+}
+
+// Dynamic stars are placed at their distance from the sun, so it has to be positive.
+bool isValidDynamicStar(Stars::DynamicStar const& star) {
+  return std::isfinite(star.mAscension) && std::isfinite(star.mDeclination) &&
+         std::isfinite(star.mDistance) && star.mDistance > 0.F && std::isfinite(star.mMagnitude) &&
+         std::isfinite(star.mColorIndex);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float Stars::getSolidAngle() const {
-  return mSolidAngle;
-}
+} // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Stars::getEnableHDR() const {
-  return mEnableHDR;
+size_t Stars::StarData::size() const {
+  return mVMagnitudes.size();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setMinMagnitude(float value) {
-  mMinMagnitude = value;
+bool Stars::StarData::empty() const {
+  return mVMagnitudes.empty();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float Stars::getMinMagnitude() const {
-  return mMinMagnitude;
+void Stars::StarData::clear() {
+  mVMagnitudes.clear();
+  mColorIndices.clear();
+  mAscensions.clear();
+  mDeclinations.clear();
+  mParallaxes.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setMaxMagnitude(float value) {
-  mMaxMagnitude = value;
+void Stars::StarData::resize(size_t count) {
+  mVMagnitudes.resize(count);
+  mColorIndices.resize(count);
+  mAscensions.resize(count);
+  mDeclinations.resize(count);
+  mParallaxes.resize(count);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float Stars::getMaxMagnitude() const {
-  return mMaxMagnitude;
+void Stars::StarData::reserve(size_t count) {
+  mVMagnitudes.reserve(count);
+  mColorIndices.reserve(count);
+  mAscensions.reserve(count);
+  mDeclinations.reserve(count);
+  mParallaxes.reserve(count);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setLuminanceMultiplicator(float value) {
-  mLuminanceMultiplicator = value;
+void Stars::StarData::append(StarData const& other, size_t index) {
+  mVMagnitudes.push_back(other.mVMagnitudes[index]);
+  mColorIndices.push_back(other.mColorIndices[index]);
+  mAscensions.push_back(other.mAscensions[index]);
+  mDeclinations.push_back(other.mDeclinations[index]);
+  mParallaxes.push_back(other.mParallaxes[index]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-float Stars::getLuminanceMultiplicator() const {
-  return mLuminanceMultiplicator;
+void Stars::StarData::push_back(Star const& star) {
+  mVMagnitudes.push_back(star.mVMagnitude);
+  mColorIndices.push_back(star.mBMagnitude - star.mVMagnitude);
+  mAscensions.push_back(star.mAscension);
+  mDeclinations.push_back(star.mDeclination);
+  mParallaxes.push_back(star.mParallax);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setCelestialGridColor(const VistaColor& value) {
-  mBackgroundColor1 = value;
+size_t Stars::StarData::getSizeInBytes() const {
+  return (mVMagnitudes.capacity() + mColorIndices.capacity() + mAscensions.capacity() +
+             mDeclinations.capacity() + mParallaxes.capacity()) *
+         sizeof(float);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VistaColor const& Stars::getCelestialGridColor() const {
-  return mBackgroundColor1;
-}
+const std::array<std::array<int, Stars::NUM_COLUMNS>, Stars::NUM_CATALOGS> Stars::cColumnMapping{
+    std::array{34, 32, 11, 8, 9, 1, -1, 16},    // CatalogType::eHipparcos
+    std::array{34, 32, 11, 8, 9, 31, 1, 16},    // CatalogType::eTycho
+    std::array{19, 17, -1, 2, 3, 23, 0, -1},    // CatalogType::eTycho2
+    std::array{-1, -1, -1, -1, -1, -1, -1, -1}, // CatalogType::eHYG, columns are looked up by name
+    std::array{-1, -1, -1, -1, -1, -1, -1, -1}, // CatalogType::eArrow, see readStarsFromArrow()
+};
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setStarFiguresColor(VistaColor const& value) {
-  mBackgroundColor2 = value;
-}
+// The starlight irradiance is cached for cubic regions of this edge length in parsecs. At most
+// cMaxIrradianceCacheFiles regions are kept on disk, the least recently written ones are removed.
+const float  Stars::cIrradianceRegionSize    = 0.1F;
+const size_t Stars::cMaxIrradianceCacheFiles = 16;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VistaColor const& Stars::getStarFiguresColor() const {
-  return mBackgroundColor2;
-}
+// The faint star map has a resolution of about 0.7 degrees, the glow of the unresolved stars has
+// no finer structure worth drawing.
+const int Stars::cFaintStarMapWidth  = 512;
+const int Stars::cFaintStarMapHeight = 256;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setStarTexture(std::string const& filename) {
-  if (filename != mStarTextureFile) {
-    mStarTextureFile = filename;
-    if (filename.empty()) {
-      mStarTexture.reset();
-    } else {
-      mStarTexture = cs::graphics::TextureLoader::loadFromFile(filename);
-    }
-  }
+// The apparent magnitudes of the far stars are recomputed when the observer has moved by more than
+// this distance in parsecs (about 1000 AU). With the given error in magnitudes, stars closer than
+// about 11 parsecs are near stars. The magnitude of near stars is replaced by cNearStarMagnitude in
+// the star VBO; this value has to match NEAR_STAR_MAGNITUDE in the shaders.
+const float Stars::cPhotometryRegionRadius = 0.005F;
+const float Stars::cMaxPhotometryError     = 0.001F;
+const float Stars::cNearStarMagnitude      = 1000.F;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The cluster nodes wait at most cClusterTimeout seconds for each other once they have loaded the
+// stars. The other nodes wait at most cClusterMasterTimeout seconds for the stars of the master,
+// which may have to parse its catalogs first; afterwards, they load their own catalogs.
+const int Stars::cClusterTimeout       = 10;
+const int Stars::cClusterMasterTimeout = 300;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// At most this much vertex data is uploaded per frame. A full Gaia catalog is uploaded within a few
+// frames; changes of a few thousand stars within one.
+const size_t Stars::cMaxUploadBytesPerFrame = 16 * 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Increase this if the cache format changed and is incompatible now. This will
+// force a reload.
+const int Stars::cCacheVersion = 9;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::Stars() {
+  buildBackgroundVAO();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setCelestialGridTexture(std::string const& filename) {
-  if (filename != mCelestialGridTextureFile) {
-    mCelestialGridTextureFile = filename;
-    if (filename.empty()) {
-      mCelestialGridTexture.reset();
-    } else {
-      mCelestialGridTexture = cs::graphics::TextureLoader::loadFromFile(filename);
+Stars::~Stars() {
+  cancelLoading();
+  cancelStarlightIrradiance();
+  cancelFaintStarMap();
+  waitForArrowExport();
+
+  if (mCacheWriteTask.valid()) {
+    mCacheWriteTask.wait();
+  }
+
+  for (auto& query : mOverdrawQueries) {
+    if (query.mQuery != 0) {
+      glDeleteQueries(1, &query.mQuery);
     }
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::setStarFiguresTexture(std::string const& filename) {
-  if (filename != mStarFiguresTextureFile) {
-    mStarFiguresTextureFile = filename;
-    if (filename.empty()) {
-      mStarFiguresTexture.reset();
-    } else {
-      mStarFiguresTexture = cs::graphics::TextureLoader::loadFromFile(filename);
-    }
+void Stars::setCatalogs(std::map<Stars::CatalogType, std::string> catalogs) {
+  if (mCatalogs != catalogs) {
+    mCatalogs = std::move(catalogs);
+
+    cancelLoading();
+
+    // The new catalogs are loaded when the stars are drawn for the next time.
+    releaseStars();
+    mDataState = DataState::eUnloaded;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Stars::Do() {
-  // save current state of the OpenGL state machine
-  glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
-  glDepthMask(GL_FALSE);
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_ONE, GL_ONE);
+std::map<Stars::CatalogType, std::string> const& Stars::getCatalogs() const {
+  return mCatalogs;
+}
 
-  // get matrices
-  std::array<GLfloat, 16> glMat{};
-  glGetFloatv(GL_MODELVIEW_MATRIX, glMat.data());
-  VistaTransformMatrix matModelView(glMat.data(), true);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  glGetFloatv(GL_PROJECTION_MATRIX, glMat.data());
-  VistaTransformMatrix matProjection(glMat.data(), true);
+void Stars::setCacheFile(std::string cacheFile) {
+  mCacheFile = std::move(cacheFile);
+}
 
-  if (mShaderDirty) {
-    std::string defines = "#version 330\n";
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (mEnableHDR) {
-      defines += "#define ENABLE_HDR\n";
-    }
+std::string const& Stars::getCacheFile() const {
+  return mCacheFile;
+}
 
-    if (mDrawMode == DrawMode::eSmoothPoint) {
-      defines += "#define DRAWMODE_SMOOTH_POINT\n";
-    } else if (mDrawMode == DrawMode::ePoint) {
-      defines += "#define DRAWMODE_POINT\n";
-    } else if (mDrawMode == DrawMode::eDisc) {
-      defines += "#define DRAWMODE_DISC\n";
-    } else if (mDrawMode == DrawMode::eSmoothDisc) {
-      defines += "#define DRAWMODE_SMOOTH_DISC\n";
-    } else if (mDrawMode == DrawMode::eSprite) {
-      defines += "#define DRAWMODE_SPRITE\n";
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    mStarShader = VistaGLSLShader();
-    if (mDrawMode == DrawMode::ePoint || mDrawMode == DrawMode::eSmoothPoint) {
-      mStarShader.InitVertexShaderFromString(defines + cStarsSnippets + cStarsVertOnePixel);
-      mStarShader.InitFragmentShaderFromString(defines + cStarsSnippets + cStarsFragOnePixel);
-    } else {
-      mStarShader.InitVertexShaderFromString(defines + cStarsSnippets + cStarsVert);
-      mStarShader.InitGeometryShaderFromString(defines + cStarsSnippets + cStarsGeom);
-      mStarShader.InitFragmentShaderFromString(defines + cStarsSnippets + cStarsFrag);
-    }
+std::string Stars::IngestFilter::getFingerprint() const {
+  // Nine digits are enough to distinguish all floats.
+  std::ostringstream fingerprint;
+  fingerprint << std::setprecision(9);
 
-    mStarShader.Link();
+  if (mMaxMagnitude) {
+    fingerprint << "mag<" << *mMaxMagnitude << ";";
+  }
 
-    mBackgroundShader = VistaGLSLShader();
-    mBackgroundShader.InitVertexShaderFromString(defines + cBackgroundVert);
-    mBackgroundShader.InitFragmentShaderFromString(defines + cBackgroundFrag);
-    mBackgroundShader.Link();
+  if (mMinParallaxQuality) {
+    fingerprint << "plx>" << *mMinParallaxQuality << ";";
+  }
 
-    mShaderDirty = false;
+  for (auto const& region : mRegions) {
+    fingerprint << "region";
+    for (auto const& vertex : region) {
+      fingerprint << ":" << vertex[0] << "," << vertex[1];
+    }
+    fingerprint << ";";
   }
 
-  // draw background
-  if ((mCelestialGridTexture && mBackgroundColor1[3] != 0.F) ||
-      (mStarFiguresTexture && mBackgroundColor2[3] != 0.F)) {
-    mBackgroundVAO.Bind();
-    mBackgroundShader.Bind();
-    mBackgroundShader.SetUniform(mBackgroundShader.GetUniformLocation("iTexture"), 0);
+  for (auto const& flag : mRejectedFlags) {
+    fingerprint << "flag:" << cs::utils::enumCast(flag.mCatalog) << ":" << flag.mColumn << ":"
+                << flag.mCharacters << ";";
+  }
 
-    float backgroundIntensity = 1.0F;
+  return fingerprint.str();
+}
 
-    if (mEnableHDR) {
-      backgroundIntensity = 0.001F * mLuminanceMultiplicator;
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    VistaTransformMatrix matMVNoTranslation = matModelView;
+void Stars::setIngestFilter(IngestFilter filter) {
+  if (mIngestFilter.getFingerprint() != filter.getFingerprint()) {
+    mIngestFilter = std::move(filter);
 
-    // reduce jitter
-    matMVNoTranslation[0][3] = 0.F;
-    matMVNoTranslation[1][3] = 0.F;
-    matMVNoTranslation[2][3] = 0.F;
+    cancelLoading();
 
-    VistaTransformMatrix matMVP(matProjection * matMVNoTranslation);
-    VistaTransformMatrix matInverseMVP(matMVP.GetInverted());
-    VistaTransformMatrix matInverseMV(matMVNoTranslation.GetInverted());
+    // The filtered catalogs are loaded when the stars are drawn for the next time.
+    releaseStars();
+    mDataState = DataState::eUnloaded;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::IngestFilter const& Stars::getIngestFilter() const {
+  return mIngestFilter;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setDrawMode(Stars::DrawMode value) {
+  if (mDrawMode != value) {
+    mShaderDirty = true;
+    mDrawMode    = value;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::DrawMode Stars::getDrawMode() const {
+  return mDrawMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setProjection(Stars::Projection value) {
+  if (mProjection != value) {
+    mShaderDirty = true;
+    mProjection  = value;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::Projection Stars::getProjection() const {
+  return mProjection;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setFisheyeAperture(float degrees) {
+  mFisheyeAperture = degrees;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getFisheyeAperture() const {
+  return mFisheyeAperture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setColorModel(Stars::ColorModel value) {
+  if (mColorModel != value) {
+    // The distance-based model uses a different input for the lookup table.
+    if (mColorModel == ColorModel::eDistance || value == ColorModel::eDistance) {
+      mShaderDirty = true;
+    }
+
+    mColorLUTDirty = true;
+    mColorModel    = value;
+
+    resetFaintStarMap();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::ColorModel Stars::getColorModel() const {
+  return mColorModel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setEnableHDR(bool value) {
+  if (mEnableHDR != value) {
+    mShaderDirty = true;
+    mEnableHDR   = value;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setSolidAngle(float value) {
+  mSolidAngle = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getSolidAngle() const {
+  return mSolidAngle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setMaxSpriteSize(float value) {
+  mMaxSpriteSize = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getMaxSpriteSize() const {
+  return mMaxSpriteSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setEnableDebugView(bool value) {
+  if (value != mEnableDebugView) {
+    mEnableDebugView = value;
+    mShaderDirty     = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::getEnableDebugView() const {
+  return mEnableDebugView;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::getEnableHDR() const {
+  return mEnableHDR;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setMinMagnitude(float value) {
+  mMinMagnitude = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getMinMagnitude() const {
+  return mMinMagnitude;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setMaxMagnitude(float value) {
+  mMaxMagnitude = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getMaxMagnitude() const {
+  return mMaxMagnitude;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setEnableFaintStars(bool value) {
+  mEnableFaintStars = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::getEnableFaintStars() const {
+  return mEnableFaintStars;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setLuminanceMultiplicator(float value) {
+  mLuminanceMultiplicator = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getLuminanceMultiplicator() const {
+  return mLuminanceMultiplicator;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setCelestialGridColor(const VistaColor& value) {
+  mBackgroundColor1 = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaColor const& Stars::getCelestialGridColor() const {
+  return mBackgroundColor1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setStarFiguresColor(VistaColor const& value) {
+  mBackgroundColor2 = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaColor const& Stars::getStarFiguresColor() const {
+  return mBackgroundColor2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setStarTexture(std::string const& filename) {
+  if (filename != mStarTextureFile) {
+    mStarTextureFile = filename;
+    if (filename.empty()) {
+      mStarTexture.reset();
+    } else {
+      mStarTexture = std::make_unique<AsyncTexture>(filename, AsyncTexture::Mipmaps::ePointSpread);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setCelestialGridTexture(std::string const& filename) {
+  if (filename != mCelestialGridTextureFile) {
+    mCelestialGridTextureFile = filename;
+    if (filename.empty()) {
+      mCelestialGridTexture.reset();
+    } else {
+      mCelestialGridTexture =
+          std::make_unique<AsyncTexture>(filename, AsyncTexture::Mipmaps::eBox, GL_REPEAT);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setStarFiguresTexture(std::string const& filename) {
+  if (filename != mStarFiguresTextureFile) {
+    mStarFiguresTextureFile = filename;
+    if (filename.empty()) {
+      mStarFiguresTexture.reset();
+    } else {
+      mStarFiguresTexture =
+          std::make_unique<AsyncTexture>(filename, AsyncTexture::Mipmaps::eBox, GL_REPEAT);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setVariableStarsFile(std::string const& filename) {
+  if (filename == mVariableStarsFile) {
+    return;
+  }
+
+  mVariableStarsFile = filename;
+  mVariableStars.clear();
+
+  if (!filename.empty()) {
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+      logger().error("Failed to load variable stars: Cannot open file '{}'!", filename);
+    }
+
+    const std::map<std::string, VariableType> types = {{"mira", VariableType::eMira},
+        {"cepheid", VariableType::eCepheid}, {"eclipsing", VariableType::eEclipsing}};
+
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+
+      std::stringstream        stream(line);
+      std::string              item;
+      std::vector<std::string> items;
+
+      while (getline(stream, item, ',')) {
+        items.emplace_back(item);
+      }
+
+      VariableStar star{};
+      double       epoch{};
+      std::string  type;
+
+      bool valid = items.size() >= 5 && fromString<uint32_t>(items[0], star.mHipparcos) &&
+                   fromString<float>(items[1], star.mPeriod) &&
+                   fromString<double>(items[2], epoch) &&
+                   fromString<float>(items[3], star.mAmplitude) &&
+                   fromString<std::string>(items[4], type);
+
+      if (!valid || types.find(type) == types.end() || star.mPeriod <= 0.F) {
+        logger().warn("Ignoring invalid line in variable stars file: '{}'", line);
+        continue;
+      }
+
+      // The epoch is stored in days since J2000.
+      star.mEpoch = static_cast<float>(epoch - 2451545.0);
+      star.mType  = types.at(type);
+
+      mVariableStars.push_back(star);
+    }
+
+    logger().info("Read {} variable stars from '{}'.", mVariableStars.size(), filename);
+  }
+
+  updateStarDataMemoryUsage();
+  buildVariableStarBuffers();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& Stars::getVariableStarsFile() const {
+  return mVariableStarsFile;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setSimulationTime(double tdbSeconds) {
+  mSimulationTime = tdbSeconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double Stars::getSimulationTime() const {
+  return mSimulationTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StarIdentifiers const& Stars::getStarIdentifiers() const {
+  return mStarIdentifiers;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::exportArrow(std::string const& file, VistaVector3D const& observer) {
+  if (mDataState != DataState::eLoaded || mStars.empty()) {
+    logger().warn("Cannot export stars to '{}': No stars are loaded!", file);
+    return false;
+  }
+
+  if (mExportTask.valid() &&
+      mExportTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    logger().warn("Cannot export stars to '{}': Another export is still running!", file);
+    return false;
+  }
+
+  mExportTask = std::async(
+      std::launch::async, [this, file, observer]() { return writeArrowFile(file, observer); });
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::waitForArrowExport() {
+  if (mExportTask.valid()) {
+    mExportTask.wait();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::writeArrowFile(std::string const& file, VistaVector3D const& observer) {
+  CSP_STARS_TRACE_ZONE("Export Arrow file");
+
+  const size_t numStars = mStars.size();
+
+  std::vector<float> ascensions(numStars);
+  std::vector<float> declinations(numStars);
+  std::vector<float> apparentMagnitudes(numStars);
+
+  parallelFor(numStars, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      float asc = mStars.mAscensions[i];
+      float dec = mStars.mDeclinations[i];
+
+      // This inverts the conversion in readStarsFromCatalog().
+      float ra        = std::fmod(450.F - asc * 180.F / Vista::Pi, 360.F);
+      ascensions[i]   = ra < 0.F ? ra + 360.F : ra;
+      declinations[i] = dec * 180.F / Vista::Pi;
+
+      apparentMagnitudes[i] = getApparentMagnitude(i, observer);
+    }
+  });
+
+  std::vector<uint32_t> hipparcos = mStarIdentifiers.decodeHipparcos();
+  std::vector<uint32_t> tycho     = mStarIdentifiers.decodeTycho();
+  hipparcos.resize(numStars, 0);
+  tycho.resize(numStars, 0);
+
+  // Most stars have no name, so the characters of the few named stars are collected in one
+  // buffer and all other rows are empty strings.
+  std::vector<int32_t> nameOffsets(numStars + 1, 0);
+  std::string          nameChars;
+
+  auto const& names = mStarIdentifiers.getNames();
+  auto        name  = names.begin();
+
+  for (size_t i = 0; i < numStars; ++i) {
+    if (name != names.end() && name->first == i) {
+      nameChars += name->second;
+      ++name;
+    }
+    nameOffsets[i + 1] = static_cast<int32_t>(nameChars.size());
+  }
+
+  setMemoryUsage(MemoryCategory::eTransient,
+      numStars * (3 * sizeof(float) + 2 * sizeof(uint32_t) + sizeof(int32_t)) +
+          nameChars.size());
+
+  ArrowWriter writer(numStars);
+  writer.addFloatColumn("ra", ascensions.data());
+  writer.addFloatColumn("dec", declinations.data());
+  writer.addFloatColumn("parallax", mStars.mParallaxes.data());
+  writer.addFloatColumn("vmag", mStars.mVMagnitudes.data());
+  writer.addFloatColumn("color_index", mStars.mColorIndices.data());
+  writer.addFloatColumn("apparent_vmag", apparentMagnitudes.data());
+  writer.addUInt32Column("hip", hipparcos.data());
+  writer.addUInt32Column("tycho", tycho.data());
+  writer.addStringColumn("name", nameOffsets.data(), nameChars.data());
+
+  bool success = writer.write(file);
+
+  setMemoryUsage(MemoryCategory::eTransient, 0);
+
+  if (success) {
+    logger().info("Exported {} stars to '{}'.", numStars, file);
+  }
+
+  return success;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StarlightIrradiance const& Stars::getStarlightIrradiance() const {
+  return mStarlightIrradiance;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setObserverPosition(VistaVector3D const& parsecs) {
+  mObserverPosition = parsecs;
+
+  if (mDataState == DataState::eLoaded && getObserverRegion() != mIrradianceRegion) {
+    mIrradianceDirty = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VistaVector3D const& Stars::getObserverPosition() const {
+  return mObserverPosition;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setIdleTimeout(double seconds) {
+  mIdleTimeout = seconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double Stars::getIdleTimeout() const {
+  return mIdleTimeout;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setEnableSharedMemory(bool value) {
+  mEnableSharedMemory = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::getEnableSharedMemory() const {
+  return mEnableSharedMemory;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setEnableOcclusionCulling(bool value) {
+  mEnableOcclusionCulling = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::getEnableOcclusionCulling() const {
+  return mEnableOcclusionCulling;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setClusterTransport(std::shared_ptr<ClusterTransport> transport) {
+  mClusterTransport = std::move(transport);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setDynamicStars(std::string const& list, std::vector<DynamicStar> stars) {
+  if (!std::all_of(stars.begin(), stars.end(), isValidDynamicStar)) {
+    logger().warn("Ignoring dynamic stars '{}': All values have to be finite and all distances "
+                  "have to be positive!",
+        list);
+    return;
+  }
+
+  if (stars.empty()) {
+    mDynamicStars.erase(list);
+  } else {
+    mDynamicStars[list] = std::move(stars);
+  }
+
+  mDynamicStarsDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::updateDynamicStars(
+    std::string const& list, size_t first, std::vector<DynamicStar> const& stars) {
+  if (stars.empty()) {
+    return;
+  }
+
+  auto   existing = mDynamicStars.find(list);
+  size_t size     = existing == mDynamicStars.end() ? 0 : existing->second.size();
+
+  if (first > size) {
+    logger().warn("Ignoring dynamic stars '{}': The first index {} is behind the end of the list "
+                  "with {} stars!",
+        list, first, size);
+    return;
+  }
+
+  if (!std::all_of(stars.begin(), stars.end(), isValidDynamicStar)) {
+    logger().warn("Ignoring dynamic stars '{}': All values have to be finite and all distances "
+                  "have to be positive!",
+        list);
+    return;
+  }
+
+  auto& dynamicStars = mDynamicStars[list];
+
+  if (dynamicStars.size() < first + stars.size()) {
+    dynamicStars.resize(first + stars.size());
+  }
+
+  std::copy(stars.begin(), stars.end(), dynamicStars.begin() + static_cast<std::ptrdiff_t>(first));
+
+  mDynamicStarsDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> Stars::getDynamicStarLists() const {
+  std::vector<std::string> lists;
+  lists.reserve(mDynamicStars.size());
+
+  for (auto const& list : mDynamicStars) {
+    lists.push_back(list.first);
+  }
+
+  return lists;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::update() {
+  // The cache segments are freed once they have been written.
+  if (mPendingCacheSegments.empty() && mCacheWriteTask.valid() &&
+      mCacheWriteTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    mCacheWriteTask.get();
+    setMemoryUsage(MemoryCategory::eCacheSegments, 0);
+  }
+
+  if (mIdleTimeout < 0.0 || mDataState != DataState::eLoaded ||
+      std::chrono::steady_clock::now() - mLastDrawTime <
+          std::chrono::duration<double>(mIdleTimeout)) {
+    return;
+  }
+
+  // Do not release the stars while their cache segments are not written yet. Else the catalogs
+  // would have to be parsed again when the stars are reloaded.
+  if (!mPendingCacheSegments.empty() ||
+      (mCacheWriteTask.valid() &&
+          mCacheWriteTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+    return;
+  }
+
+  logger().info("Releasing {} stars as they have not been drawn for {} seconds.", mStars.size(),
+      mIdleTimeout);
+
+  releaseStars();
+  mDataState = DataState::eReleased;
+  ++mReleaseCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::Statistics Stars::getStatistics() const {
+  MemoryUsage usage = getMemoryUsage();
+
+  Statistics stats{};
+  stats.mState            = mDataState;
+  stats.mNumStars         = mStars.size();
+  stats.mCPUBytes         = usage.mCPU.mCurrent;
+  stats.mGPUBytes         = usage.mGPU.mCurrent;
+  stats.mLoadCount        = mLoadCount;
+  stats.mReleaseCount     = mReleaseCount;
+  stats.mLastLoadDuration = mLastLoadDuration;
+  stats.mSamplesPassed    = mSamplesPassed;
+  stats.mOverdraw         = mOverdraw;
+  stats.mNumNearStars     = mPerVertexPhotometry ? mStars.size() : mNumNearStars;
+  stats.mNumDynamicStars  = mDynamicStarBuffer.getSize();
+  stats.mNumCulledTiles   = mEnableOcclusionCulling ? mTileCuller.getNumCulledTiles() : 0;
+  stats.mNumCulledStars   = mEnableOcclusionCulling ? mTileCuller.getNumCulledStars() : 0;
+
+  return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::MemoryUsage Stars::getMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mMemoryUsageMutex);
+  return mMemoryUsage;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::LoadingProgress Stars::getLoadingProgress() const {
+  LoadingProgress progress{};
+  progress.mRemainingSeconds = -1.0;
+
+  if (mDataState != DataState::eLoading || !mLoadingState) {
+    return progress;
+  }
+
+  auto const& state = *mLoadingState;
+
+  progress.mLoading   = true;
+  progress.mBytes     = state.mBytes;
+  progress.mBytesRead = state.mFinishedBytes + state.mCatalogBytesRead;
+
+  progress.mWaitingForCluster = state.mWaitingForCluster;
+
+  if (state.mJobIndex < state.mJobs.size()) {
+    auto const& job           = state.mJobs.at(state.mJobIndex);
+    progress.mCatalog          = job.mCatalogFile;
+    progress.mCatalogBytes     = job.mFileSize;
+    progress.mCatalogBytesRead = std::min(state.mCatalogBytesRead.load(), job.mFileSize);
+  }
+
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - state.mStartTime).count();
+
+  if (seconds > 0.0) {
+    progress.mBytesPerSecond = static_cast<double>(progress.mBytesRead) / seconds;
+  }
+
+  if (progress.mBytesPerSecond > 0.0) {
+    progress.mRemainingSeconds =
+        static_cast<double>(std::max<int64_t>(progress.mBytes - progress.mBytesRead, 0)) /
+        progress.mBytesPerSecond;
+  }
+
+  return progress;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Stars::getStatisticsReport() const {
+  const std::array<std::string, 4> states = {"unloaded", "loading", "loaded", "released"};
+
+  Statistics stats = getStatistics();
+
+  nlohmann::json report;
+  report["state"]            = states.at(cs::utils::enumCast(stats.mState));
+  report["numStars"]         = stats.mNumStars;
+  report["cpuBytes"]         = stats.mCPUBytes;
+  report["gpuBytes"]         = stats.mGPUBytes;
+  report["loadCount"]        = stats.mLoadCount;
+  report["releaseCount"]     = stats.mReleaseCount;
+  report["lastLoadDuration"] = stats.mLastLoadDuration;
+  report["samplesPassed"]    = stats.mSamplesPassed;
+  report["overdraw"]         = stats.mOverdraw;
+  report["numNearStars"]     = stats.mNumNearStars;
+  report["numDynamicStars"]  = stats.mNumDynamicStars;
+  report["numCulledTiles"]   = stats.mNumCulledTiles;
+  report["numCulledStars"]   = stats.mNumCulledStars;
+
+  return report.dump(2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Stars::getMemoryReport() const {
+  const std::array<std::string, cs::utils::enumCast(MemoryCategory::eCount)> names = {
+      "starData", "cacheSegments", "transient", "sharedMemory", "vertexBuffers", "variableStars",
+      "textures"};
+
+  MemoryUsage usage = getMemoryUsage();
+
+  auto toJson = [](MemoryUsage::Entry const& entry) {
+    nlohmann::json json;
+    json["current"] = entry.mCurrent;
+    json["peak"]    = entry.mPeak;
+    return json;
+  };
+
+  nlohmann::json report;
+  report["numStars"] = mStars.size();
+  report["cpu"]      = toJson(usage.mCPU);
+  report["gpu"]      = toJson(usage.mGPU);
+
+  for (size_t i = 0; i < names.size(); ++i) {
+    report["categories"][names.at(i)] = toJson(usage.mCategories.at(i));
+  }
+
+  return report.dump(2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::Do() {
+  CSP_STARS_TRACE_ZONE("Stars::Do");
+
+  // The stars are loaded lazily, so that no memory is used as long as they are not drawn. Until
+  // the loading thread has finished, only the background is drawn.
+  if (mDataState == DataState::eUnloaded || mDataState == DataState::eReleased) {
+    startLoading();
+  }
+
+  if (mDataState == DataState::eLoading) {
+    finishLoading();
+  }
+
+  if (mEnableFaintStars && mDataState == DataState::eLoaded) {
+    updateFaintStarMap();
+  }
+
+  mLastDrawTime = std::chrono::steady_clock::now();
+
+  // save current state of the OpenGL state machine
+  glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+
+  // get matrices
+  std::array<GLfloat, 16> glMat{};
+  glGetFloatv(GL_MODELVIEW_MATRIX, glMat.data());
+  VistaTransformMatrix matModelView(glMat.data(), true);
+
+  glGetFloatv(GL_PROJECTION_MATRIX, glMat.data());
+  VistaTransformMatrix matProjection(glMat.data(), true);
+
+  std::array<int, 4> viewport{};
+  glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+  // The observer position in parsecs, as computed in the star vertex shaders.
+  const float          parsecToMeter = 3.08567758e16F;
+  VistaTransformMatrix matInverseMV(matModelView.GetInverted());
+  VistaVector3D        observer(matInverseMV[0][3] / parsecToMeter,
+      matInverseMV[1][3] / parsecToMeter, matInverseMV[2][3] / parsecToMeter);
+
+  setObserverPosition(observer);
+  updateStarlightIrradiance();
+
+  if (mDataState == DataState::eLoaded) {
+    float dx = observer[0] - mPhotometryOrigin[0];
+    float dy = observer[1] - mPhotometryOrigin[1];
+    float dz = observer[2] - mPhotometryOrigin[2];
+
+    // When the observer travels fast, the magnitudes are updated at most once per second.
+    // Meanwhile, all of them are computed in the vertex shader.
+    float distance2      = dx * dx + dy * dy + dz * dz;
+    mPerVertexPhotometry = mPhotometryDirty ||
+                           distance2 > cPhotometryRegionRadius * cPhotometryRegionRadius;
+
+    if (mPerVertexPhotometry &&
+        (mPhotometryDirty ||
+            std::chrono::steady_clock::now() - mLastPhotometryUpdate > std::chrono::seconds(1))) {
+      updateFarStarMagnitudes(observer);
+    }
+  }
+
+  if (mDynamicStarsDirty) {
+    buildDynamicStarVAO();
+  }
+
+  // Staged vertex data is uploaded in portions, so that large changes of the star set do not stall
+  // rendering. Until the precomputed magnitudes have been uploaded, all magnitudes are computed in
+  // the vertex shader.
+  if (mStarBuffer.hasStagedWrites()) {
+    CSP_STARS_TRACE_ZONE("Upload vertex data");
+    mStarBuffer.flush(cMaxUploadBytesPerFrame);
+    mPerVertexPhotometry = true;
+    updateStarBufferMemoryUsage();
+  } else {
+    // Once everything is uploaded, ranges are moved to the front of the buffer, so that fewer
+    // removed stars are drawn.
+    bool moved = mStarBuffer.compact([this](size_t oldFirst, size_t newFirst, size_t /*count*/) {
+      if (oldFirst == mCatalogStarsFirst) {
+        mCatalogStarsFirst = newFirst;
+      }
+    });
+
+    if (moved) {
+      updateStarBufferMemoryUsage();
+    }
+  }
+
+  if (mShaderDirty) {
+    CSP_STARS_TRACE_ZONE("Compile shaders");
+
+    std::string defines = "#version 330\n";
+
+    if (mEnableHDR) {
+      defines += "#define ENABLE_HDR\n";
+    }
+
+    if (mDrawMode == DrawMode::eSmoothPoint) {
+      defines += "#define DRAWMODE_SMOOTH_POINT\n";
+    } else if (mDrawMode == DrawMode::ePoint) {
+      defines += "#define DRAWMODE_POINT\n";
+    } else if (mDrawMode == DrawMode::eDisc) {
+      defines += "#define DRAWMODE_DISC\n";
+    } else if (mDrawMode == DrawMode::eSmoothDisc) {
+      defines += "#define DRAWMODE_SMOOTH_DISC\n";
+    } else if (mDrawMode == DrawMode::eSprite) {
+      defines += "#define DRAWMODE_SPRITE\n";
+    }
+
+    if (mColorModel == ColorModel::eDistance) {
+      defines += "#define COLOR_BY_DISTANCE\n";
+    }
+
+    if (mProjection == Projection::eFisheye) {
+      defines += "#define PROJECTION_FISHEYE\n";
+    }
+
+    auto initStarShader = [this](VistaGLSLShader& shader, std::string const& defines) {
+      shader = VistaGLSLShader();
+      if (mDrawMode == DrawMode::ePoint || mDrawMode == DrawMode::eSmoothPoint) {
+        shader.InitVertexShaderFromString(defines + cStarsSnippets + cStarsVertOnePixel);
+        shader.InitFragmentShaderFromString(defines + cStarsSnippets + cStarsFragOnePixel);
+      } else {
+        shader.InitVertexShaderFromString(defines + cStarsSnippets + cStarsVert);
+        shader.InitGeometryShaderFromString(defines + cStarsSnippets + cStarsGeom);
+        shader.InitFragmentShaderFromString(defines + cStarsSnippets + cStarsFrag);
+      }
+      shader.Link();
+    };
+
+    initStarShader(mStarShader, defines);
+
+    if (mEnableDebugView) {
+      initStarShader(mDebugFragmentShader, defines + "#define DEBUG_COUNT_FRAGMENTS\n");
+
+      mDebugTileShader = VistaGLSLShader();
+      mDebugTileShader.InitVertexShaderFromString(defines + cStarsSnippets + cStarsVertDebug);
+      mDebugTileShader.InitFragmentShaderFromString(defines + cStarsFragDebug);
+      mDebugTileShader.Link();
+
+      std::string histogramDefines = defines + "#define DEBUG_MAGNITUDE_HISTOGRAM\n";
+      mDebugHistogramShader        = VistaGLSLShader();
+      mDebugHistogramShader.InitVertexShaderFromString(
+          histogramDefines + cStarsSnippets + cStarsVertDebug);
+      mDebugHistogramShader.InitFragmentShaderFromString(histogramDefines + cStarsFragDebug);
+      mDebugHistogramShader.Link();
+    }
+
+    mBackgroundShader = VistaGLSLShader();
+    mBackgroundShader.InitVertexShaderFromString(defines + cBackgroundVert);
+    mBackgroundShader.InitFragmentShaderFromString(defines + cBackgroundFrag);
+    mBackgroundShader.Link();
+
+    mFaintStarShader = VistaGLSLShader();
+    mFaintStarShader.InitVertexShaderFromString(defines + cBackgroundVert);
+    mFaintStarShader.InitFragmentShaderFromString(
+        defines + "#define FAINT_STARS\n" + cStarsSnippets + cBackgroundFrag);
+    mFaintStarShader.Link();
+
+    mShaderDirty = false;
+  }
+
+  // The textures are uploaded once they have been decoded.
+  VistaTexture* gridTexture = mCelestialGridTexture ? mCelestialGridTexture->getTexture() : nullptr;
+  VistaTexture* figuresTexture = mStarFiguresTexture ? mStarFiguresTexture->getTexture() : nullptr;
+
+  bool drawFaintStars = mEnableFaintStars && mFaintStarTexture;
+
+  // draw background, the debug view replaces the entire sky
+  if (!mEnableDebugView && (drawFaintStars || (gridTexture && mBackgroundColor1[3] != 0.F) ||
+                               (figuresTexture && mBackgroundColor2[3] != 0.F))) {
+    CSP_STARS_TRACE_ZONE("Draw background");
+
+    mBackgroundVAO.Bind();
+
+    float backgroundIntensity = 1.0F;
+
+    if (mEnableHDR) {
+      backgroundIntensity = 0.001F * mLuminanceMultiplicator;
+    }
+
+    VistaTransformMatrix matMVNoTranslation = matModelView;
+
+    // reduce jitter
+    matMVNoTranslation[0][3] = 0.F;
+    matMVNoTranslation[1][3] = 0.F;
+    matMVNoTranslation[2][3] = 0.F;
+
+    VistaTransformMatrix matMVP(matProjection * matMVNoTranslation);
+    VistaTransformMatrix matInverseMVP(matMVP.GetInverted());
+    VistaTransformMatrix matInverseMV(matMVNoTranslation.GetInverted());
+
+    auto setBackgroundUniforms = [&](VistaGLSLShader& shader) {
+      shader.SetUniform(shader.GetUniformLocation("iTexture"), 0);
+
+      GLint loc = shader.GetUniformLocation("uInvMVP");
+      glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMVP.GetData());
+
+      loc = shader.GetUniformLocation("uInvMV");
+      glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMV.GetData());
+
+      setFisheyeUniforms(shader, viewport);
+    };
+
+    // The faint stars are drawn with the same luminance scale and tone mapping as the stars.
+    if (drawFaintStars) {
+      mFaintStarShader.Bind();
+      setBackgroundUniforms(mFaintStarShader);
+      mFaintStarShader.SetUniform(mFaintStarShader.GetUniformLocation("cColor"), 1.F, 1.F, 1.F,
+          mLuminanceMultiplicator);
+      mFaintStarShader.SetUniform(mFaintStarShader.GetUniformLocation("uSolidAngle"), mSolidAngle);
+      mFaintStarTexture->Bind(GL_TEXTURE0);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      mFaintStarTexture->Unbind(GL_TEXTURE0);
+      mFaintStarShader.Release();
+    }
+
+    mBackgroundShader.Bind();
+    setBackgroundUniforms(mBackgroundShader);
+
+    if (gridTexture && mBackgroundColor1[3] != 0.F) {
+      mBackgroundShader.SetUniform(mBackgroundShader.GetUniformLocation("cColor"),
+          mBackgroundColor1[0], mBackgroundColor1[1], mBackgroundColor1[2],
+          mBackgroundColor1[3] * backgroundIntensity);
+      gridTexture->Bind(GL_TEXTURE0);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      gridTexture->Unbind(GL_TEXTURE0);
+    }
+
+    if (figuresTexture && mBackgroundColor2[3] != 0.F) {
+      mBackgroundShader.SetUniform(mBackgroundShader.GetUniformLocation("cColor"),
+          mBackgroundColor2[0], mBackgroundColor2[1], mBackgroundColor2[2],
+          mBackgroundColor2[3] * backgroundIntensity);
+      figuresTexture->Bind(GL_TEXTURE0);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      figuresTexture->Unbind(GL_TEXTURE0);
+    }
+
+    mBackgroundShader.Release();
+    mBackgroundVAO.Release();
+  }
+
+  // With a foreground draw, the stars are drawn after the opaque geometry. If the foreground draw
+  // has not been called since the last frame, for example because its node is disabled, the stars
+  // are drawn here again until it is called once more.
+  if (mForegroundPending) {
+    mForegroundPending = false;
+    mForegroundMissed  = true;
+  }
+
+  if (mForegroundDrawAttached && !mForegroundMissed) {
+    mForegroundPending = true;
+  } else {
+    drawStarPass(matModelView, matProjection, viewport);
+  }
+
+  glDepthMask(GL_TRUE);
+  glPopAttrib();
+
+  // Now that the first frame has been drawn, newly loaded catalogs can be written to the cache.
+  if (!mPendingCacheSegments.empty()) {
+    writePendingCacheSegments();
+  }
+
+  updateTextureMemoryUsage();
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::drawStarPass(VistaTransformMatrix const& matModelView,
+    VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport) {
+  // The sprite texture is uploaded once it has been decoded.
+  VistaTexture* starTexture = mStarTexture ? mStarTexture->getTexture() : nullptr;
+
+  if (!starTexture) {
+    if (!mFallbackStarTexture) {
+      mFallbackStarTexture = createFallbackStarTexture();
+    }
+    starTexture = mFallbackStarTexture.get();
+  }
+
+  if (mDrawMode == DrawMode::ePoint || mDrawMode == DrawMode::eSmoothPoint) {
+    glPointSize(0.5F);
+  }
+
+  if (mDrawMode == DrawMode::eSmoothPoint) {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_POINT_SMOOTH);
+    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+  } else {
+    glDisable(GL_POINT_SMOOTH);
+  }
+
+  if (mColorLUTDirty) {
+    buildColorLUT();
+  }
+
+  starTexture->Bind(GL_TEXTURE0);
+  mColorLUT->Bind(GL_TEXTURE1);
+
+  VistaTexture* variableStarTexture = getVariableStarTexture();
+  variableStarTexture->Bind(GL_TEXTURE2);
+
+  if (mEnableDebugView) {
+    drawDebugView(matModelView, matProjection, viewport);
+  } else {
+    CSP_STARS_TRACE_ZONE("Draw stars");
+
+    // Tiles of catalog stars which are hidden behind the already rendered scene are skipped. The
+    // bounding quads of the tiles are tested before the star shader is bound. They are always
+    // drawn with the perspective projection.
+    bool cull = mEnableOcclusionCulling && mProjection == Projection::ePerspective &&
+                mDataState == DataState::eLoaded && !mTileCuller.empty();
+
+    if (cull) {
+      CSP_STARS_TRACE_ZONE("Test sky tiles");
+
+      const float          parsecToMeter = 3.08567758e16F;
+      VistaTransformMatrix matInverseMV(matModelView.GetInverted());
+      float                x = matInverseMV[0][3] / parsecToMeter;
+      float                y = matInverseMV[1][3] / parsecToMeter;
+      float                z = matInverseMV[2][3] / parsecToMeter;
+
+      mTileCuller.testTiles(matModelView, matProjection, getCullingMargin(matProjection, viewport),
+          std::sqrt(x * x + y * y + z * z));
+    }
+
+    mStarShader.Bind();
+    setStarUniforms(mStarShader, matModelView, matProjection, viewport);
+
+    // Count the fragments generated by the stars. Two queries are used alternately and the result
+    // of a query is only read once it is available, so that this never stalls the pipeline.
+    auto& query         = mOverdrawQueries.at(mOverdrawQueryIndex);
+    mOverdrawQueryIndex = (mOverdrawQueryIndex + 1) % mOverdrawQueries.size();
+
+    if (query.mQuery == 0) {
+      glGenQueries(1, &query.mQuery);
+    }
+
+    if (query.mPending) {
+      GLint available = 0;
+      glGetQueryObjectiv(query.mQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+      if (available != 0) {
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(query.mQuery, GL_QUERY_RESULT, &samples);
+        mSamplesPassed = samples;
+        mOverdraw      = static_cast<float>(static_cast<double>(samples) / query.mPixels);
+        query.mPending = false;
+      }
+    }
+
+    bool measure = !query.mPending;
+
+    if (measure) {
+      glBeginQuery(GL_SAMPLES_PASSED, query.mQuery);
+    }
+
+    drawStars(cull);
+
+    if (measure) {
+      glEndQuery(GL_SAMPLES_PASSED);
+      query.mPending = true;
+      query.mPixels  = std::max(1, viewport.at(2) * viewport.at(3));
+    }
+
+    mStarShader.Release();
+  }
+
+  variableStarTexture->Unbind(GL_TEXTURE2);
+  mColorLUT->Unbind(GL_TEXTURE1);
+  starTexture->Unbind(GL_TEXTURE0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::drawForeground() {
+  // The stars have already been drawn by Do() in this frame, they are deferred again in the next.
+  if (!mForegroundPending) {
+    mForegroundMissed = false;
+    return true;
+  }
+
+  mForegroundPending = false;
+
+  CSP_STARS_TRACE_ZONE("Stars::drawForeground");
+
+  glPushAttrib(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+
+  std::array<GLfloat, 16> glMat{};
+  glGetFloatv(GL_MODELVIEW_MATRIX, glMat.data());
+  VistaTransformMatrix matModelView(glMat.data(), true);
+
+  glGetFloatv(GL_PROJECTION_MATRIX, glMat.data());
+  VistaTransformMatrix matProjection(glMat.data(), true);
+
+  std::array<int, 4> viewport{};
+  glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+  drawStarPass(matModelView, matProjection, viewport);
+
+  glDepthMask(GL_TRUE);
+  glPopAttrib();
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IVistaOpenGLDraw* Stars::getForegroundDraw() {
+  mForegroundDrawAttached = true;
+  return &mForegroundDraw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Stars::ForegroundDraw::ForegroundDraw(Stars& stars)
+    : mStars(stars) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::ForegroundDraw::Do() {
+  return mStars.drawForeground();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::ForegroundDraw::GetBoundingBox(VistaBoundingBox& oBoundingBox) {
+  return mStars.GetBoundingBox(oBoundingBox);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setStarUniforms(VistaGLSLShader& shader, VistaTransformMatrix const& matModelView,
+    VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport) {
+  shader.SetUniform(shader.GetUniformLocation("uResolution"), static_cast<float>(viewport.at(2)),
+      static_cast<float>(viewport.at(3)));
+
+  shader.SetUniform(shader.GetUniformLocation("iTexture"), 0);
+  shader.SetUniform(shader.GetUniformLocation("uColorLUT"), 1);
+
+  // The sampler has to be set even if there are no variable stars, as it would otherwise use
+  // unit 0 together with the sampler2D of the sprite texture. The time is split into integer and
+  // fractional days to retain precision in the shader.
+  double days = mSimulationTime / 86400.0;
+  shader.SetUniform(shader.GetUniformLocation("uVariableStars"), 2);
+  shader.SetUniform(shader.GetUniformLocation("uSimulationTime"),
+      static_cast<float>(std::floor(days)), static_cast<float>(days - std::floor(days)));
+
+  if (mColorModel == ColorModel::eDistance) {
+    shader.SetUniform(
+        shader.GetUniformLocation("uColorLUTRange"), cMinLogDistance, cMaxLogDistance);
+  } else {
+    shader.SetUniform(shader.GetUniformLocation("uColorLUTRange"), cMinColorIndex, cMaxColorIndex);
+  }
+
+  shader.SetUniform(shader.GetUniformLocation("uMinMagnitude"), mMinMagnitude);
+  shader.SetUniform(shader.GetUniformLocation("uMaxMagnitude"), mMaxMagnitude);
+  shader.SetUniform(shader.GetUniformLocation("uSolidAngle"), mSolidAngle);
+  shader.SetUniform(shader.GetUniformLocation("uMaxSpriteSize"), mMaxSpriteSize);
+  shader.SetUniform(shader.GetUniformLocation("uLuminanceMultiplicator"), mLuminanceMultiplicator);
+  shader.SetUniform(
+      shader.GetUniformLocation("uPerVertexPhotometry"), mPerVertexPhotometry ? 1 : 0);
+
+  VistaTransformMatrix matInverseMV(matModelView.GetInverted());
+  VistaTransformMatrix matInverseP(matProjection.GetInverted());
+
+  GLint loc = shader.GetUniformLocation("uMatMV");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, matModelView.GetData());
+
+  loc = shader.GetUniformLocation("uMatP");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, matProjection.GetData());
+
+  loc = shader.GetUniformLocation("uInvMV");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMV.GetData());
+
+  loc = shader.GetUniformLocation("uInvP");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseP.GetData());
+
+  setFisheyeUniforms(shader, viewport);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::setFisheyeUniforms(VistaGLSLShader& shader, std::array<int, 4> const& viewport) {
+  if (mProjection != Projection::eFisheye) {
+    return;
+  }
+
+  // The scale converts angles to normalized device coordinates. The fisheye circle spans the
+  // height of the viewport and is kept round on non-square viewports.
+  float aperture = std::clamp(mFisheyeAperture, 1.F, 360.F) / 180.F * Vista::Pi;
+  float aspect   = static_cast<float>(std::max(1, viewport.at(3))) /
+                 static_cast<float>(std::max(1, viewport.at(2)));
+  float scaleX = 2.F / aperture * aspect;
+  float scaleY = 2.F / aperture;
+
+  shader.SetUniform(shader.GetUniformLocation("uFisheyeScale"), scaleX, scaleY);
+
+  // The angle to the view direction in the corners of the viewport. Stars beyond it are clipped.
+  float maxAngle = std::sqrt(1.F / (scaleX * scaleX) + 1.F / (scaleY * scaleY));
+  shader.SetUniform(
+      shader.GetUniformLocation("uFisheyeMaxAngle"), std::min(maxAngle, Vista::Pi * 0.999F));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::drawStars(bool cull) {
+  mStarBuffer.bind();
+
+  if (cull) {
+    // Only the range of the catalog stars is drawn per tile, removed slots before and after it are
+    // drawn as usual.
+    size_t end = mCatalogStarsFirst + mStars.size();
+
+    if (mCatalogStarsFirst > 0) {
+      glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mCatalogStarsFirst));
+    }
+
+    mTileCuller.drawTiles(mCatalogStarsFirst);
+
+    if (mStarBuffer.getSize() > end) {
+      glDrawArrays(GL_POINTS, static_cast<GLint>(end),
+          static_cast<GLsizei>(mStarBuffer.getSize() - end));
+    }
+  } else {
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mStarBuffer.getSize()));
+  }
+
+  mStarBuffer.release();
+
+  if (mDynamicStarBuffer.getSize() > 0) {
+    mDynamicStarBuffer.bind();
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mDynamicStarBuffer.getSize()));
+    mDynamicStarBuffer.release();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getCullingMargin(
+    VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport) const {
+  // The angle covered by one pixel in the center of the screen.
+  float pixelAngle = 2.F / (matProjection[1][1] * static_cast<float>(std::max(1, viewport.at(3))));
+
+  if (mDrawMode == DrawMode::ePoint || mDrawMode == DrawMode::eSmoothPoint) {
+    return pixelAngle;
+  }
+
+  // Half the diameter of the star quads, see the star geometry shader. Sprites are scaled with the
+  // cube root of their luminance, so the brightest visible stars have the largest quads.
+  float radius = std::sqrt(1.F - std::pow(1.F - mSolidAngle / (2.F * Vista::Pi), 2.F));
+
+  if (mDrawMode == DrawMode::eSprite) {
+    radius *= std::pow(10.F, 0.4F * (10.F - mMinMagnitude) / 3.F);
+
+    if (mMaxSpriteSize > 0.F) {
+      radius = std::min(radius, 0.5F * mMaxSpriteSize * pixelAngle);
+    }
+  }
+
+  // The corners of the quads are sqrt(2) times farther away than their edges.
+  return radius * std::sqrt(2.F) + pixelAngle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::drawDebugView(VistaTransformMatrix const& matModelView,
+    VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport) {
+  CSP_STARS_TRACE_ZONE("Draw debug view");
+
+  GLint drawFramebuffer = 0;
+  GLint readFramebuffer = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+
+  // All passes count with additive blending. The depth test is disabled, so that all generated
+  // fragments are counted, even if they are hidden behind other objects.
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+
+  // The stars are drawn with the current draw mode, but each fragment adds one.
+  mDebugView.bindTarget(DebugView::Target::eFragments, viewport.at(2), viewport.at(3));
+  mDebugFragmentShader.Bind();
+  setStarUniforms(mDebugFragmentShader, matModelView, matProjection, viewport);
+  drawStars(false);
+  mDebugFragmentShader.Release();
+
+  // For the other passes, each star adds one to a single texel.
+  glDisable(GL_POINT_SMOOTH);
+  glPointSize(1.F);
+
+  mDebugView.bindTarget(DebugView::Target::eTiles, viewport.at(2), viewport.at(3));
+  mDebugTileShader.Bind();
+  setStarUniforms(mDebugTileShader, matModelView, matProjection, viewport);
+  drawStars(false);
+  mDebugTileShader.Release();
+
+  mDebugView.bindTarget(DebugView::Target::eHistogram, viewport.at(2), viewport.at(3));
+  mDebugHistogramShader.Bind();
+  setStarUniforms(mDebugHistogramShader, matModelView, matProjection, viewport);
+  mDebugHistogramShader.SetUniform(mDebugHistogramShader.GetUniformLocation("uHistogramRange"),
+      DebugView::cHistogramMin, DebugView::cHistogramMax);
+  mDebugHistogramShader.SetUniform(
+      mDebugHistogramShader.GetUniformLocation("uHistogramBins"), DebugView::cHistogramBins);
+  drawStars(false);
+  mDebugHistogramShader.Release();
+
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+  glViewport(viewport.at(0), viewport.at(1), viewport.at(2), viewport.at(3));
+
+  // The visualization is drawn opaquely.
+  glDisable(GL_BLEND);
+  mDebugView.draw(viewport, mMinMagnitude, mMaxMagnitude);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::GetBoundingBox(VistaBoundingBox& oBoundingBox) {
+  float      min(std::numeric_limits<float>::min());
+  float      max(std::numeric_limits<float>::max());
+  std::array fMin{min, min, min};
+  std::array fMax{max, max, max};
+
+  oBoundingBox.SetBounds(fMin.data(), fMax.data());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::readStarsFromCatalog(CatalogType type, std::string const& filename,
+    CatalogSegment& segment, LoadingState& state) {
+  CSP_STARS_TRACE_ZONE("Parse catalog");
+
+  if (type == CatalogType::eHYG) {
+    return readStarsFromCsvCatalog(type, filename, segment, state);
+  }
+
+  bool success = false;
+  logger().info("Reading star catalog '{}'.", filename);
+
+  std::ifstream file;
+
+  try {
+    file.open(filename.c_str(), std::ifstream::in);
+  } catch (std::exception& e) {
+    logger().error("Failed to open catalog file '{}': {}", filename, e.what());
+  }
+
+  if (file.is_open()) {
+    CatalogProgress progress(state.mCancelled, state.mCatalogBytesRead);
+
+    // The number of rows dropped by each rule of the ingest filter.
+    auto const& filter             = state.mIngestFilter;
+    size_t      droppedByFlags     = 0;
+    size_t      droppedByMagnitude = 0;
+    size_t      droppedByRegion    = 0;
+    size_t      droppedByParallax  = 0;
+
+    // read line by line
+    while (!file.eof()) {
+      // get line
+      std::string line;
+      getline(file, line);
+
+      if (!progress.addLine(line)) {
+        return false;
+      }
+
+      // parse line:
+      // separate complete items consisting of "val0|val1|...|valN|" into vector of value
+      // strings
+      std::stringstream        stream(line);
+      std::string              item;
+      std::vector<std::string> items;
+
+      while (getline(stream, item, '|')) {
+        items.emplace_back(item);
+      }
+
+      // convert value strings to int/double/float and save in star data structure
+      // expecting Hipparcos or Tycho-1 catalog and more than 12 columns
+      if (items.size() > 12) {
+        // Rows with rejected flags are dropped before any value is converted.
+        if (hasRejectedFlag(filter, type, items)) {
+          ++droppedByFlags;
+          continue;
+        }
+
+        // store star data
+        bool successStoreData(true);
+
+        Star star{};
+        successStoreData &= fromString<float>(
+            items[cColumnMapping.at(
+                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eVmag)]],
+            star.mVMagnitude);
+        successStoreData &= fromString<float>(
+            items[cColumnMapping.at(
+                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eBmag)]],
+            star.mBMagnitude);
+        successStoreData &= fromString<float>(
+            items[cColumnMapping.at(
+                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eRect)]],
+            star.mAscension);
+        successStoreData &= fromString<float>(
+            items[cColumnMapping.at(
+                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eDecl)]],
+            star.mDeclination);
+
+        if (cColumnMapping.at(
+                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::ePara)] > 0) {
+          if (!fromString<float>(items[cColumnMapping.at(cs::utils::enumCast(type))
+                                           .at(cs::utils::enumCast(CatalogColumn::ePara))],
+                  star.mParallax)) {
+            star.mParallax = 0;
+          }
+        } else {
+          star.mParallax = 0;
+        }
+
+        // The remaining rules of the ingest filter are evaluated on the catalog values before the
+        // identifiers are parsed. Rows which cannot be parsed are not counted.
+        if (!successStoreData) {
+          continue;
+        }
+
+        if (filter.mMaxMagnitude && star.mVMagnitude > *filter.mMaxMagnitude) {
+          ++droppedByMagnitude;
+          continue;
+        }
+
+        if (!isInsideRegions(filter, star.mAscension, star.mDeclination)) {
+          ++droppedByRegion;
+          continue;
+        }
+
+        int errorColumn = cColumnMapping.at(
+            cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eParaErr)];
+
+        if (filter.mMinParallaxQuality && errorColumn >= 0) {
+          float error = 0.F;
+          if (!fromString<float>(items[errorColumn], error) || error <= 0.F ||
+              star.mParallax < *filter.mMinParallaxQuality * error) {
+            ++droppedByParallax;
+            continue;
+          }
+        }
+
+        // The identifiers are optional. The Tycho identifier consists of three numbers separated
+        // by spaces.
+        int hipColumn = cColumnMapping.at(
+            cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eHipp)];
+        int tycColumn = cColumnMapping.at(
+            cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eTyc)];
+
+        if (hipColumn < 0 || !fromString<uint32_t>(items[hipColumn], star.mHipparcos)) {
+          star.mHipparcos = 0;
+        }
+
+        if (tycColumn >= 0) {
+          std::istringstream tycStream(items[tycColumn]);
+          uint32_t           tyc1{};
+          uint32_t           tyc2{};
+          uint32_t           tyc3{};
+          if (tycStream >> tyc1 >> tyc2 >> tyc3) {
+            star.mTycho = StarIdentifiers::packTycho(tyc1, tyc2, tyc3);
+          }
+        }
+
+        if (successStoreData) {
+          star.mAscension   = (360.F + 90.F - star.mAscension) / 180.F * Vista::Pi;
+          star.mDeclination = star.mDeclination / 180.F * Vista::Pi;
+
+          segment.mStars.push_back(star);
+          segment.mIdentifiers.push_back(star.mHipparcos, star.mTycho);
+
+          // print progress status
+          if (segment.mStars.size() % 10000 == 0) {
+            logger().info("Read {} stars so far...", segment.mStars.size());
+          }
+        }
+      }
+    }
+    file.close();
+    success = true;
+
+    logger().info("Read a total of {} stars.", segment.mStars.size());
+
+    if (!state.mFilterFingerprint.empty()) {
+      logger().info("The ingest filter dropped {} stars by their flags, {} by their magnitude, {} "
+                    "outside of the regions and {} by their parallax quality.",
+          droppedByFlags, droppedByMagnitude, droppedByRegion, droppedByParallax);
+    }
+  } else {
+    logger().error("Failed to load stars: Cannot open catalog file '{}'!", filename);
+  }
+
+  return success;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::readStarsFromCsvCatalog(CatalogType type, std::string const& filename,
+    CatalogSegment& segment, LoadingState& state) {
+  CSP_STARS_TRACE_ZONE("Parse CSV catalog");
+
+  logger().info("Reading star catalog '{}'.", filename);
+
+  std::ifstream file(filename, std::ifstream::in);
+  if (!file.is_open()) {
+    logger().error("Failed to load stars: Cannot open catalog file '{}'!", filename);
+    return false;
+  }
+
+  // The line buffer and the field views are reused for all lines, so that parsing does not
+  // allocate memory except for the proper names.
+  CsvTokenizer    tokenizer;
+  std::string     line;
+  CatalogProgress progress(state.mCancelled, state.mCatalogBytesRead);
+
+  if (!std::getline(file, line)) {
+    logger().error("Failed to load stars: Catalog file '{}' is empty!", filename);
+    return false;
+  }
+
+  progress.addLine(line);
+  tokenizer.setHeader(line);
+
+  int magColumn  = tokenizer.getColumn({"mag", "vmag"});
+  int ciColumn   = tokenizer.getColumn({"ci", "bv", "b-v"});
+  int xColumn    = tokenizer.getColumn({"x"});
+  int yColumn    = tokenizer.getColumn({"y"});
+  int zColumn    = tokenizer.getColumn({"z"});
+  int raColumn   = tokenizer.getColumn({"ra"});
+  int decColumn  = tokenizer.getColumn({"dec"});
+  int distColumn = tokenizer.getColumn({"dist"});
+  int hipColumn  = tokenizer.getColumn({"hip"});
+  int nameColumn = tokenizer.getColumn({"proper", "name"});
+
+  bool hasCartesian = xColumn >= 0 && yColumn >= 0 && zColumn >= 0;
+
+  if (magColumn < 0 || (!hasCartesian && (raColumn < 0 || decColumn < 0))) {
+    logger().error("Failed to load stars: Catalog file '{}' needs a 'mag' column and either 'x', "
+                   "'y' and 'z' or 'ra' and 'dec' columns!",
+        filename);
+    return false;
+  }
+
+  // The number of rows dropped by each rule of the ingest filter. There are no parallax errors
+  // in these catalogs.
+  auto const& filter             = state.mIngestFilter;
+  size_t      droppedByFlags     = 0;
+  size_t      droppedByMagnitude = 0;
+  size_t      droppedByRegion    = 0;
+
+  while (std::getline(file, line)) {
+    if (!progress.addLine(line)) {
+      return false;
+    }
+
+    auto const& fields = tokenizer.split(line);
+
+    if (hasRejectedFlag(filter, type, fields)) {
+      ++droppedByFlags;
+      continue;
+    }
+
+    Star  star{};
+    float colorIndex = 0.F;
+
+    if (!CsvTokenizer::parseFloat(tokenizer.getField(magColumn), star.mVMagnitude)) {
+      continue;
+    }
+
+    if (!CsvTokenizer::parseFloat(tokenizer.getField(ciColumn), colorIndex)) {
+      colorIndex = 0.F;
+    }
+
+    star.mBMagnitude = star.mVMagnitude + colorIndex;
+
+    // Right ascension and declination are computed in degrees first, as the ingest filter
+    // regions are given in degrees.
+    float distance = 0.F;
+
+    if (hasCartesian) {
+      float x = 0.F;
+      float y = 0.F;
+      float z = 0.F;
+
+      if (!CsvTokenizer::parseFloat(tokenizer.getField(xColumn), x) ||
+          !CsvTokenizer::parseFloat(tokenizer.getField(yColumn), y) ||
+          !CsvTokenizer::parseFloat(tokenizer.getField(zColumn), z)) {
+        continue;
+      }
+
+      distance = std::sqrt(x * x + y * y + z * z);
+
+      // HYG contains the sun at the origin.
+      if (distance <= 0.F) {
+        continue;
+      }
+
+      star.mAscension   = std::atan2(y, x) * 180.F / Vista::Pi;
+      star.mDeclination = std::asin(std::clamp(z / distance, -1.F, 1.F)) * 180.F / Vista::Pi;
+
+      if (star.mAscension < 0.F) {
+        star.mAscension += 360.F;
+      }
+    } else {
+      if (!CsvTokenizer::parseFloat(tokenizer.getField(raColumn), star.mAscension) ||
+          !CsvTokenizer::parseFloat(tokenizer.getField(decColumn), star.mDeclination)) {
+        continue;
+      }
+
+      star.mAscension *= 15.F;
+
+      if (!CsvTokenizer::parseFloat(tokenizer.getField(distColumn), distance)) {
+        distance = 0.F;
+      }
+    }
+
+    star.mParallax = distance > 0.F && distance < cUnknownCsvDistance ? 1000.F / distance : 0.F;
+
+    if (filter.mMaxMagnitude && star.mVMagnitude > *filter.mMaxMagnitude) {
+      ++droppedByMagnitude;
+      continue;
+    }
+
+    if (!isInsideRegions(filter, star.mAscension, star.mDeclination)) {
+      ++droppedByRegion;
+      continue;
+    }
+
+    if (!CsvTokenizer::parseUInt(tokenizer.getField(hipColumn), star.mHipparcos)) {
+      star.mHipparcos = 0;
+    }
+
+    star.mAscension   = (360.F + 90.F - star.mAscension) / 180.F * Vista::Pi;
+    star.mDeclination = star.mDeclination / 180.F * Vista::Pi;
+
+    segment.mStars.push_back(star);
+    segment.mIdentifiers.push_back(star.mHipparcos, star.mTycho);
+
+    std::string_view name = tokenizer.getField(nameColumn);
+    if (!name.empty()) {
+      segment.mIdentifiers.setName(segment.mStars.size() - 1, CsvTokenizer::unescape(name));
+    }
+
+    // print progress status
+    if (segment.mStars.size() % 10000 == 0) {
+      logger().info("Read {} stars so far...", segment.mStars.size());
+    }
+  }
+
+  logger().info("Read a total of {} stars, {} of them with a name.", segment.mStars.size(),
+      segment.mIdentifiers.getNames().size());
+
+  if (!state.mFilterFingerprint.empty()) {
+    logger().info("The ingest filter dropped {} stars by their flags, {} by their magnitude and {} "
+                  "outside of the regions.",
+        droppedByFlags, droppedByMagnitude, droppedByRegion);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::readStarsFromArrow(std::string const& filename, CatalogSegment& segment,
+    std::shared_ptr<SharedMemory>& memory, LoadingState& state) {
+  CSP_STARS_TRACE_ZONE("Map Arrow catalog");
+
+  logger().info("Reading star catalog '{}'.", filename);
+
+  ArrowReader reader;
+  if (!reader.open(filename)) {
+    return false;
+  }
+
+  int vmagColumn     = reader.getColumn({"vmag", "mag"});
+  int colorColumn    = reader.getColumn({"color_index", "ci", "bv"});
+  int raColumn       = reader.getColumn({"ra"});
+  int decColumn      = reader.getColumn({"dec"});
+  int parallaxColumn = reader.getColumn({"parallax"});
+  int errorColumn    = reader.getColumn({"parallax_error"});
+  int hipColumn      = reader.getColumn({"hip"});
+  int tychoColumn    = reader.getColumn({"tycho"});
+  int nameColumn     = reader.getColumn({"name", "proper"});
+
+  if (vmagColumn < 0 || raColumn < 0 || decColumn < 0) {
+    logger().error(
+        "Failed to load stars: Arrow file '{}' needs 'vmag', 'ra' and 'dec' columns!", filename);
+    return false;
+  }
+
+  const size_t numStars = reader.getNumRows();
+  const float  missing  = std::numeric_limits<float>::quiet_NaN();
+  auto&        stars    = segment.mStars;
+
+  // Missing optional columns are filled with the given value.
+  auto getColumn = [&](int column, float nullValue, SharedArray<float>& values) {
+    if (column < 0) {
+      values = SharedArray<float>(std::vector<float>(numStars, nullValue));
+      return true;
+    }
+
+    if (auto const* data = reader.getFloatData(column)) {
+      values = SharedArray<float>(data, numStars);
+      return true;
+    }
+
+    std::vector<float> converted;
+    if (!reader.readFloats(column, nullValue, converted)) {
+      return false;
+    }
+
+    values = SharedArray<float>(std::move(converted));
+    return true;
+  };
+
+  std::vector<float> ascensions;
+  std::vector<float> declinations;
+
+  if (!getColumn(vmagColumn, missing, stars.mVMagnitudes) ||
+      !getColumn(colorColumn, 0.F, stars.mColorIndices) ||
+      !getColumn(parallaxColumn, 0.F, stars.mParallaxes) ||
+      !reader.readFloats(raColumn, missing, ascensions) ||
+      !reader.readFloats(decColumn, missing, declinations)) {
+    logger().error(
+        "Failed to load stars: Arrow file '{}' has columns of unsupported types!", filename);
+    return false;
+  }
+
+  std::vector<uint32_t> hipparcos(numStars, 0);
+  std::vector<uint32_t> tycho(numStars, 0);
+  reader.readUInt32s(hipColumn, 0, hipparcos);
+  reader.readUInt32s(tychoColumn, 0, tycho);
+
+  for (size_t i = 0; i < numStars; ++i) {
+    segment.mIdentifiers.push_back(hipparcos[i], tycho[i]);
+  }
+
+  reader.forEachString(nameColumn, [&segment](size_t row, std::string_view name) {
+    segment.mIdentifiers.setName(row, std::string(name));
+  });
+
+  if (state.mCancelled) {
+    return false;
+  }
+
+  // The ingest filter is evaluated before the positions are converted, as its regions are given
+  // in degrees. Stars with missing required values are dropped as well.
+  auto const& filter = state.mIngestFilter;
+  bool        copy   = !state.mFilterFingerprint.empty() || reader.hasNulls(vmagColumn) ||
+              reader.hasNulls(raColumn) || reader.hasNulls(decColumn);
+
+  std::vector<bool> keep;
+  size_t            droppedByFlags     = 0;
+  size_t            droppedByMagnitude = 0;
+  size_t            droppedByRegion    = 0;
+  size_t            droppedByParallax  = 0;
+
+  if (copy) {
+    keep.resize(numStars, false);
+
+    // The columns of the rejected flags are counted from zero in the schema of the file and have
+    // to be string columns.
+    std::vector<bool> rejected(numStars, false);
+    for (auto const& flag : filter.mRejectedFlags) {
+      if (flag.mCatalog == CatalogType::eArrow &&
+          !reader.forEachString(flag.mColumn, [&](size_t row, std::string_view value) {
+            if (value.find_first_of(flag.mCharacters) != std::string_view::npos) {
+              rejected[row] = true;
+            }
+          })) {
+        logger().warn("Ignoring rejected flags of column {}: Arrow file '{}' has no string column "
+                      "with this index!",
+            flag.mColumn, filename);
+      }
+    }
+
+    // The parallax quality can only be evaluated if the file contains the parallax errors.
+    std::vector<float> errors;
+    if (filter.mMinParallaxQuality &&
+        (errorColumn < 0 || !reader.readFloats(errorColumn, missing, errors))) {
+      logger().warn("Ignoring minimum parallax quality: Arrow file '{}' has no supported "
+                    "'parallax_error' column!",
+          filename);
+    }
+
+    for (size_t i = 0; i < numStars; ++i) {
+      if (std::isnan(stars.mVMagnitudes[i]) || std::isnan(ascensions[i]) ||
+          std::isnan(declinations[i])) {
+        continue;
+      }
+
+      if (rejected[i]) {
+        ++droppedByFlags;
+        continue;
+      }
+
+      if (filter.mMaxMagnitude && stars.mVMagnitudes[i] > *filter.mMaxMagnitude) {
+        ++droppedByMagnitude;
+        continue;
+      }
+
+      if (!isInsideRegions(filter, ascensions[i], declinations[i])) {
+        ++droppedByRegion;
+        continue;
+      }
+
+      if (!errors.empty() && (!(errors[i] > 0.F) ||
+                                 stars.mParallaxes[i] < *filter.mMinParallaxQuality * errors[i])) {
+        ++droppedByParallax;
+        continue;
+      }
+
+      keep[i] = true;
+    }
+  }
+
+  // See readStarsFromCatalog() for the conversion.
+  for (size_t i = 0; i < numStars; ++i) {
+    ascensions[i]   = (360.F + 90.F - ascensions[i]) / 180.F * Vista::Pi;
+    declinations[i] = declinations[i] / 180.F * Vista::Pi;
+  }
+
+  stars.mAscensions   = SharedArray<float>(std::move(ascensions));
+  stars.mDeclinations = SharedArray<float>(std::move(declinations));
+
+  if (copy) {
+    CatalogSegment kept;
+
+    for (size_t i = 0; i < numStars; ++i) {
+      if (keep[i]) {
+        kept.mStars.append(stars, i);
+        kept.mIdentifiers.push_back(hipparcos[i], tycho[i]);
+
+        auto const& name = segment.mIdentifiers.getName(i);
+        if (!name.empty()) {
+          kept.mIdentifiers.setName(kept.mIdentifiers.size() - 1, name);
+        }
+      }
+    }
+
+    segment = std::move(kept);
+
+    if (!state.mFilterFingerprint.empty()) {
+      logger().info("The ingest filter dropped {} stars by their flags, {} by their magnitude, {} "
+                    "outside of the regions and {} by their parallax quality.",
+          droppedByFlags, droppedByMagnitude, droppedByRegion, droppedByParallax);
+    }
+  } else {
+    memory = reader.getMemory();
+  }
+
+  logger().info("Read a total of {} stars.", segment.mStars.size());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::writeStarCache(std::string const& cacheFile, CatalogType type,
+    std::string const& catalogFile, std::string const& filterFingerprint,
+    CatalogSegment const& segment) {
+  CSP_STARS_TRACE_ZONE("Write cache segment");
+
+  CacheWriter writer(cacheFile);
+  if (!writer.isGood()) {
+    logger().error(
+        "Failed to write binary star data: Cannot open file '{}' for writing!", cacheFile);
+    return;
+  }
+
+  writer.writeUInt32(static_cast<uint32_t>(cCacheVersion)); // cache format version number
+  writer.writeUInt32(static_cast<uint32_t>(type));          // catalog of this segment
+
+  // the catalog file name and size are stored in order to detect changed catalogs
+  writer.writeString(catalogFile);
+  writer.writeInt64(getFileSize(catalogFile));
+
+  // the ingest filter is stored in order to detect hash collisions of the cache file names
+  writer.writeString(filterFingerprint);
+
+  // write number of stars to front of byte stream
+  writer.writeUInt32(static_cast<uint32_t>(segment.mStars.size()));
+
+  // write star data column by column
+  for (auto const* column : {&segment.mStars.mVMagnitudes, &segment.mStars.mColorIndices,
+           &segment.mStars.mAscensions, &segment.mStars.mDeclinations,
+           &segment.mStars.mParallaxes}) {
+    writer.writeRaw(column->data(), column->size() * sizeof(float));
+  }
+
+  // the identifiers are stored after the star data
+  segment.mIdentifiers.serialize(writer);
+
+  if (writer.commit()) {
+    logger().info("Wrote {} stars into '{}'.", segment.mStars.size(), cacheFile);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::readStarCache(std::string const& cacheFile, CatalogType type,
+    std::string const& catalogFile, std::string const& filterFingerprint,
+    CatalogSegment& segment, std::atomic<bool> const& cancelled) {
+  CSP_STARS_TRACE_ZONE("Read cache segment");
+
+  // This checks the size and checksum of the file.
+  CacheReader reader(cacheFile, &cancelled);
+  if (!reader.isValid()) {
+    return false;
+  }
+
+  uint32_t    cacheVersion = 0;
+  uint32_t    catalogType  = 0;
+  std::string catalogFileName;
+  int64_t     catalogFileSize = 0;
+  std::string catalogFilter;
+  uint32_t    numStars        = 0;
+
+  if (!reader.readUInt32(cacheVersion) || cacheVersion != cCacheVersion ||
+      !reader.readUInt32(catalogType) || catalogType != static_cast<uint32_t>(type)) {
+    return false;
+  }
+
+  if (!reader.readString(catalogFileName) || !reader.readInt64(catalogFileSize) ||
+      catalogFileName != catalogFile || catalogFileSize != getFileSize(catalogFile)) {
+    logger().info(
+        "Ignoring star cache '{}': It was created from a different catalog file.", cacheFile);
+    return false;
+  }
+
+  if (!reader.readString(catalogFilter) || catalogFilter != filterFingerprint) {
+    logger().info(
+        "Ignoring star cache '{}': It was created with a different ingest filter.", cacheFile);
+    return false;
+  }
+
+  auto readColumn = [&reader, &numStars, &cancelled](SharedArray<float>& column) {
+    if (cancelled) {
+      return false;
+    }
+
+    std::vector<float> values;
+    bool               success = reader.readVector(values, numStars);
+    column                     = SharedArray<float>(std::move(values));
+    return success;
+  };
+
+  bool success = reader.readUInt32(numStars);
+  success      = success && readColumn(segment.mStars.mVMagnitudes);
+  success      = success && readColumn(segment.mStars.mColorIndices);
+  success      = success && readColumn(segment.mStars.mAscensions);
+  success      = success && readColumn(segment.mStars.mDeclinations);
+  success      = success && readColumn(segment.mStars.mParallaxes);
+  success      = success && segment.mIdentifiers.deserialize(reader);
+  success      = success && segment.mIdentifiers.size() == numStars;
+
+  if (cancelled) {
+    segment.mStars.clear();
+    segment.mIdentifiers.clear();
+    return false;
+  }
+
+  if (!success) {
+    logger().warn("Ignoring star cache '{}': The file is incomplete.", cacheFile);
+    segment.mStars.clear();
+    segment.mIdentifiers.clear();
+    return false;
+  }
+
+  logger().info("Read a total of {} stars from '{}'.", segment.mStars.size(), cacheFile);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::writePendingCacheSegments() {
+  if (mCacheWriteTask.valid() &&
+      mCacheWriteTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+
+  mCacheWriteTask =
+      std::async(std::launch::async, [segments = std::move(mPendingCacheSegments)]() {
+        for (auto const& s : segments) {
+          writeStarCache(s.mCacheFile, s.mType, s.mCatalogFile, s.mFilterFingerprint, *s.mSegment);
+        }
+      });
+
+  mPendingCacheSegments.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Stars::getCacheSegmentFile(CatalogType type) const {
+  const std::array<std::string, NUM_CATALOGS> names = {
+      "hipparcos", "tycho", "tycho2", "hyg", "arrow"};
+  return getDerivedCacheFile(names.at(cs::utils::enumCast(type)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Stars::getDerivedCacheFile(std::string const& name) const {
+  // "path/star_cache.dat" becomes "path/star_cache_hipparcos.dat", or something like
+  // "path/star_cache_hipparcos_filtered_3fa1c2.dat" if an ingest filter is set.
+  std::string suffix = "_" + name;
+  std::string filter = mIngestFilter.getFingerprint();
+
+  if (!filter.empty()) {
+    std::ostringstream hash;
+    hash << "_filtered_" << std::hex << getChecksum(filter);
+    suffix += hash.str();
+  }
+
+  size_t extension = mCacheFile.find_last_of('.');
+  size_t directory = mCacheFile.find_last_of("/\\");
+
+  if (extension == std::string::npos ||
+      (directory != std::string::npos && directory > extension)) {
+    return mCacheFile + suffix;
+  }
+
+  return mCacheFile.substr(0, extension) + suffix + mCacheFile.substr(extension);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::appendStars(
+    CatalogSegment const& segment, bool skipHipparcosStars, LoadResult& result) {
+  CSP_STARS_TRACE_ZONE("Deduplicate stars");
+
+  std::vector<uint32_t> hipparcos = segment.mIdentifiers.decodeHipparcos();
+  std::vector<uint32_t> tycho     = segment.mIdentifiers.decodeTycho();
+  auto const&           names     = segment.mIdentifiers.getNames();
+
+  // The names of skipped stars are assigned after the loop, as looking up the Hipparcos numbers
+  // in the result while appending to it would rebuild the lookup tables over and over.
+  std::vector<std::pair<uint32_t, std::string>> skippedNames;
+
+  result.mStars.reserve(result.mStars.size() + segment.mStars.size());
+
+  for (size_t i = 0; i < segment.mStars.size(); ++i) {
+    auto name = names.find(static_cast<uint32_t>(i));
+
+    if (skipHipparcosStars && hipparcos[i] != 0) {
+      if (name != names.end()) {
+        skippedNames.emplace_back(hipparcos[i], name->second);
+      }
+      continue;
+    }
+
+    result.mStars.append(segment.mStars, i);
+    result.mIdentifiers.push_back(hipparcos[i], tycho[i]);
+
+    if (name != names.end()) {
+      result.mIdentifiers.setName(result.mIdentifiers.size() - 1, name->second);
+    }
+  }
+
+  for (auto& [hip, name] : skippedNames) {
+    auto index = result.mIdentifiers.findHipparcos(hip);
+    if (index && result.mIdentifiers.getName(*index).empty()) {
+      result.mIdentifiers.setName(*index, std::move(name));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::startLoading() {
+  auto state = std::make_shared<LoadingState>();
+
+  // Each catalog is loaded into a separate segment which is cached on its own. The catalogs are
+  // traversed in the order of the CatalogType enum, hence Hipparcos is loaded first. Stars of
+  // other catalogs which are part of the Hipparcos catalog are skipped if Hipparcos is loaded as
+  // well. HYG contains all Hipparcos stars, so it takes the place of Hipparcos if that is not
+  // loaded.
+  CatalogType hipparcosSource = CatalogType::eHipparcos;
+  if (mCatalogs.find(CatalogType::eHipparcos) == mCatalogs.end()) {
+    hipparcosSource = CatalogType::eHYG;
+  }
+
+  bool hasHipparcos = mCatalogs.find(hipparcosSource) != mCatalogs.end();
+
+  for (auto const& [type, filename] : mCatalogs) {
+    // do not load tycho and tycho 2
+    if (type == CatalogType::eTycho2 && mCatalogs.find(CatalogType::eTycho) != mCatalogs.end()) {
+      logger().warn("Failed to load Tycho2 catalog: Tycho already loaded!");
+      continue;
+    }
+
+    int64_t fileSize = std::max<int64_t>(getFileSize(filename), 0);
+    state->mJobs.push_back({type, filename, getCacheSegmentFile(type), fileSize,
+        hasHipparcos && type != hipparcosSource});
+    state->mBytes += fileSize;
+  }
+
+  state->mStartTime = std::chrono::steady_clock::now();
+
+  state->mFingerprint       = getCatalogFingerprint();
+  state->mIngestFilter      = mIngestFilter;
+  state->mFilterFingerprint = mIngestFilter.getFingerprint();
+  state->mClusterTransport  = mClusterTransport;
+  state->mClusterMessage    = ++mClusterMessages;
+  state->mClusterFile       = getDerivedCacheFile("cluster");
+
+  if (mEnableSharedMemory) {
+    std::ostringstream name;
+    name << "/csp-stars-" << std::hex << getChecksum(state->mFingerprint);
+    state->mSharedMemoryName = name.str();
+  }
+
+  mLoadingState = state;
+  mLoadingTask  = std::async(std::launch::async, [this, state]() { return loadCatalogs(*state); });
+  mDataState    = DataState::eLoading;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::finishLoading() {
+  if (!mLoadingTask.valid() ||
+      mLoadingTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+
+  CSP_STARS_TRACE_ZONE("Finish loading");
+
+  std::unique_ptr<LoadResult> result = mLoadingTask.get();
+  auto                        start  = mLoadingState->mStartTime;
+  mLoadingState.reset();
+
+  if (result) {
+    cancelStarlightIrradiance();
+    cancelFaintStarMap();
+    waitForArrowExport();
+
+    mStars           = std::move(result->mStars);
+    mStarIdentifiers = std::move(result->mIdentifiers);
+    mMagnitudeOrder  = std::move(result->mMagnitudeOrder);
+    mSharedMemory    = std::move(result->mSharedMemory);
+
+    // The segments are written to the cache once the first frame has been drawn. Until then they
+    // are kept in memory.
+    for (auto& segment : result->mPendingCacheSegments) {
+      mPendingCacheSegments.push_back(std::move(segment));
+    }
+
+    auto const& cacheSegments =
+        getMemoryUsage().mCategories.at(cs::utils::enumCast(MemoryCategory::eCacheSegments));
+    setMemoryUsage(
+        MemoryCategory::eCacheSegments, cacheSegments.mCurrent + result->mCacheSegmentBytes);
+  }
+
+  setMemoryUsage(MemoryCategory::eTransient, 0);
+  updateStarDataMemoryUsage();
+
+  if (mStars.empty()) {
+    logger().warn("Loaded no stars! Stars will not work properly.");
+  }
+
+  // Create buffers,
+  buildStarVAO();
+
+  resetFaintStarMap();
+
+  mIrradianceDirty  = true;
+  mDataState        = DataState::eLoaded;
+  mLastDrawTime     = std::chrono::steady_clock::now();
+  mLastLoadDuration = std::chrono::duration<double>(mLastDrawTime - start).count();
+  ++mLoadCount;
+
+  logger().info("Loaded {} stars in {:.2f} seconds.", mStars.size(), mLastLoadDuration);
+  logger().info("Memory usage: {}", getMemoryReport());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::cancelLoading() {
+  if (!mLoadingTask.valid()) {
+    return;
+  }
+
+  mLoadingState->mCancelled = true;
+  mLoadingTask.wait();
+  mLoadingTask = {};
+  mLoadingState.reset();
+
+  setMemoryUsage(MemoryCategory::eTransient, 0);
+  mDataState = DataState::eUnloaded;
+
+  logger().info("Cancelled loading of the star catalogs.");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Stars::LoadResult> Stars::loadCatalogs(LoadingState& state) {
+  CSP_STARS_TRACE_ZONE("Load stars");
+
+  if (state.mClusterTransport && !state.mClusterTransport->isMaster()) {
+    auto result = receiveClusterStars(state);
+    if (result || state.mCancelled) {
+      return result;
+    }
+
+    logger().warn("Loading the local catalogs instead of the stars of the cluster master.");
+  }
+
+  if (!state.mSharedMemoryName.empty()) {
+    auto result = mapSharedStars(state.mSharedMemoryName, state.mFingerprint);
+    if (result) {
+      state.mFinishedBytes = state.mBytes;
+
+      if (state.mClusterTransport && !sendClusterStars(state, *result)) {
+        return nullptr;
+      }
+
+      return result;
+    }
+  }
+
+  auto   result      = std::make_unique<LoadResult>();
+  size_t resultBytes = 0;
+
+  for (size_t i = 0; i < state.mJobs.size(); ++i) {
+    auto const& job = state.mJobs[i];
+
+    state.mCatalogBytesRead = 0;
+    state.mJobIndex         = i;
+
+    auto segment = std::make_unique<CatalogSegment>();
+
+    // Arrow files are mapped directly instead of being cached. If there are no other catalogs,
+    // the mapped columns are used for rendering without copying them.
+    if (job.mType == CatalogType::eArrow) {
+      std::shared_ptr<SharedMemory> memory;
+      bool                          success =
+          readStarsFromArrow(job.mCatalogFile, *segment, memory, state);
+
+      if (state.mCancelled) {
+        return nullptr;
+      }
+
+      state.mFinishedBytes += job.mFileSize;
+
+      if (!success) {
+        continue;
+      }
+
+      if (state.mJobs.size() == 1) {
+        result->mStars        = std::move(segment->mStars);
+        result->mIdentifiers  = std::move(segment->mIdentifiers);
+        result->mSharedMemory = std::move(memory);
+      } else {
+        appendStars(*segment, job.mSkipHipparcosStars, *result);
+      }
+
+      resultBytes = result->mStars.getSizeInBytes() + result->mIdentifiers.getSizeInBytes() +
+                    result->mCacheSegmentBytes;
+      setMemoryUsage(MemoryCategory::eTransient, resultBytes);
+      continue;
+    }
+
+    bool fromCache = readStarCache(job.mCacheFile, job.mType, job.mCatalogFile,
+        state.mFilterFingerprint, *segment, state.mCancelled);
+
+    if (state.mCancelled) {
+      return nullptr;
+    }
+
+    if (!fromCache && !readStarsFromCatalog(job.mType, job.mCatalogFile, *segment, state)) {
+      if (state.mCancelled) {
+        return nullptr;
+      }
+
+      state.mFinishedBytes += job.mFileSize;
+      continue;
+    }
+
+    if (state.mCancelled) {
+      return nullptr;
+    }
+
+    state.mFinishedBytes += job.mFileSize;
+
+    size_t segmentBytes = segment->mStars.getSizeInBytes() + segment->mIdentifiers.getSizeInBytes();
+    setMemoryUsage(MemoryCategory::eTransient, resultBytes + segmentBytes);
+
+    appendStars(*segment, job.mSkipHipparcosStars, *result);
+
+    resultBytes = result->mStars.getSizeInBytes() + result->mIdentifiers.getSizeInBytes() +
+                  result->mCacheSegmentBytes;
+
+    if (!fromCache && !segment->mStars.empty()) {
+      result->mPendingCacheSegments.push_back({job.mCacheFile, job.mType, job.mCatalogFile,
+          state.mFilterFingerprint, std::move(segment)});
+      result->mCacheSegmentBytes += segmentBytes;
+      resultBytes += segmentBytes;
+    }
+
+    setMemoryUsage(MemoryCategory::eTransient, resultBytes);
+  }
+
+  result->mMagnitudeOrder = getMagnitudeOrder(result->mStars);
+
+  if (!state.mSharedMemoryName.empty() && !state.mCancelled) {
+    publishStars(state.mSharedMemoryName, state.mFingerprint, *result);
+  }
+
+  if (state.mClusterTransport && !sendClusterStars(state, *result)) {
+    return nullptr;
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SharedArray<uint32_t> Stars::getMagnitudeOrder(StarData const& stars) {
+  // The faint star map is updated incrementally by traversing the stars in order of their
+  // magnitude, see updateFaintStarMap().
+  std::vector<uint32_t> order(stars.size());
+  std::iota(order.begin(), order.end(), 0U);
+
+  auto const& magnitudes = stars.mVMagnitudes;
+  std::sort(order.begin(), order.end(),
+      [&magnitudes](uint32_t a, uint32_t b) { return magnitudes[a] < magnitudes[b]; });
+
+  return SharedArray<uint32_t>(std::move(order));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::sendClusterStars(LoadingState& state, LoadResult const& result) {
+  CSP_STARS_TRACE_ZONE("Send cluster stars");
+
+  if (state.mCancelled) {
+    return false;
+  }
+
+  // Other nodes only load their local catalogs if the master has not sent anything.
+  if (!state.mClusterTransport->isMaster()) {
+    return true;
+  }
+
+  std::string message = state.mFingerprint + "#" + state.mClusterTransport->getSession() + ":" +
+                        std::to_string(state.mClusterMessage);
+
+  CacheWriter writer(state.mClusterFile);
+  writer.writeUInt32(static_cast<uint32_t>(cCacheVersion));
+  writer.writeString(message);
+  writer.writeUInt32(static_cast<uint32_t>(result.mStars.size()));
+
+  for (auto const* column : {&result.mStars.mVMagnitudes, &result.mStars.mColorIndices,
+           &result.mStars.mAscensions, &result.mStars.mDeclinations,
+           &result.mStars.mParallaxes}) {
+    writer.writeRaw(column->data(), column->size() * sizeof(float));
+  }
+
+  result.mIdentifiers.serialize(writer);
+
+  if (!writer.commit() || !state.mClusterTransport->send(state.mClusterFile, message)) {
+    logger().error("Failed to send the stars to the other cluster nodes!");
+    return !state.mCancelled;
+  }
+
+  logger().info("Sent {} stars to the other cluster nodes.", result.mStars.size());
+
+  state.mClusterTransport->arrive(message);
+
+  state.mWaitingForCluster = true;
+  bool arrived             = waitForCluster(*state.mClusterTransport, message, state);
+  state.mWaitingForCluster = false;
+
+  return arrived || !state.mCancelled;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Stars::LoadResult> Stars::receiveClusterStars(LoadingState& state) {
+  CSP_STARS_TRACE_ZONE("Receive cluster stars");
+
+  auto& transport = *state.mClusterTransport;
+  auto  start     = std::chrono::steady_clock::now();
+
+  logger().info("Waiting for the stars of the cluster master...");
+  state.mWaitingForCluster = true;
+
+  // Messages of earlier sessions are only inspected once.
+  std::string ignored;
+
+  while (!state.mCancelled) {
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(cClusterMasterTimeout)) {
+      logger().warn("The cluster master has not sent any stars within {} seconds!",
+          cClusterMasterTimeout);
+      break;
+    }
+
+    std::string file;
+    std::string message;
+    std::string fingerprint;
+    std::string session;
+
+    if (transport.receive(file, message) && message != ignored) {
+      // The master may not yet have replaced the data of an earlier session.
+      if (!parseClusterMessage(message, fingerprint, session) ||
+          session != transport.getSession()) {
+        ignored = message;
+      } else if (auto result = readClusterStars(file, message)) {
+        state.mFinishedBytes = state.mBytes;
+
+        if (fingerprint != state.mFingerprint) {
+          logger().warn("The catalogs of the cluster master differ from the local catalogs! "
+                        "The stars of the cluster master are used.");
+        }
+
+        transport.arrive(message);
+
+        if (waitForCluster(transport, message, state)) {
+          state.mWaitingForCluster = false;
+          result->mMagnitudeOrder  = getMagnitudeOrder(result->mStars);
+          logger().info("Received {} stars from the cluster master.", result->mStars.size());
+          return result;
+        }
+
+        // Either cancelled or the master has sent newer data.
+        continue;
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  state.mWaitingForCluster = false;
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Stars::LoadResult> Stars::readClusterStars(
+    std::string const& file, std::string const& message) {
+  // This checks the size and checksum of the file.
+  CacheReader reader(file);
+  if (!reader.isValid()) {
+    return nullptr;
+  }
+
+  uint32_t    cacheVersion = 0;
+  std::string fileMessage;
+  uint32_t    numStars = 0;
+
+  // The file may already have been replaced by a newer one.
+  if (!reader.readUInt32(cacheVersion) || cacheVersion != cCacheVersion ||
+      !reader.readString(fileMessage) || fileMessage != message ||
+      !reader.readUInt32(numStars)) {
+    return nullptr;
+  }
+
+  auto result = std::make_unique<LoadResult>();
+
+  auto readColumn = [&reader, &numStars](SharedArray<float>& column) {
+    std::vector<float> values;
+    bool               success = reader.readVector(values, numStars);
+    column                     = SharedArray<float>(std::move(values));
+    return success;
+  };
+
+  bool success = readColumn(result->mStars.mVMagnitudes);
+  success      = success && readColumn(result->mStars.mColorIndices);
+  success      = success && readColumn(result->mStars.mAscensions);
+  success      = success && readColumn(result->mStars.mDeclinations);
+  success      = success && readColumn(result->mStars.mParallaxes);
+  success      = success && result->mIdentifiers.deserialize(reader);
+  success      = success && result->mIdentifiers.size() == numStars;
+
+  if (!success) {
+    logger().warn("Ignoring cluster star data '{}': The file is incomplete.", file);
+    return nullptr;
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Stars::waitForCluster(
+    ClusterTransport& transport, std::string const& token, LoadingState const& state) {
+  CSP_STARS_TRACE_ZONE("Wait for cluster");
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (!transport.allArrived(token)) {
+    if (state.mCancelled || transport.peek() != token) {
+      return false;
+    }
+
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(cClusterTimeout)) {
+      logger().warn("Not all cluster nodes have loaded the stars after {} seconds! Showing the "
+                    "stars anyway.",
+          cClusterTimeout);
+      return true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string Stars::getCatalogFingerprint() const {
+  std::string fingerprint = "v" + std::to_string(cCacheVersion);
+
+  for (auto const& [type, filename] : mCatalogs) {
+    fingerprint += ";" + std::to_string(cs::utils::enumCast(type)) + ":" + filename + ":" +
+                   std::to_string(getFileSize(filename));
+  }
+
+  std::string filter = mIngestFilter.getFingerprint();
+  if (!filter.empty()) {
+    fingerprint += ";filter:" + filter;
+  }
+
+  return fingerprint;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<Stars::LoadResult> Stars::mapSharedStars(
+    std::string const& name, std::string const& fingerprint) {
+  CSP_STARS_TRACE_ZONE("Map shared stars");
+
+  auto memory = SharedMemory::open(name);
+
+  // The segment may still be filled by another process.
+  if (!memory || memory->getSize() < sizeof(SharedStarsHeader) ||
+      static_cast<SharedStarsHeader const*>(memory->getData())
+              ->mReady.load(std::memory_order_acquire) != 1) {
+    removeStaleSharedStars(name);
+    return nullptr;
+  }
+
+  auto const* bytes    = static_cast<uint8_t const*>(memory->getData());
+  auto const* header   = reinterpret_cast<SharedStarsHeader const*>(bytes);
+  auto        numStars = static_cast<size_t>(header->mNumStars);
+  size_t      names    = getSharedColumnOffset(fingerprint.size(), numStars, cNumSharedColumns);
+
+  // A complete segment which does not match is of no use for any process using this name. It is
+  // removed, so that the stars can be published again.
+  if (header->mMagic != cSharedStarsMagic || header->mVersion != cCacheVersion ||
+      header->mFingerprintSize != fingerprint.size() || memory->getSize() < names ||
+      memory->getSize() - names < header->mNamesSize ||
+      fingerprint.compare(0, fingerprint.size(),
+          reinterpret_cast<char const*>(bytes + sizeof(SharedStarsHeader)),
+          header->mFingerprintSize) != 0) {
+    logger().warn("Removing shared star data '{}': It was created from different catalogs.", name);
+    SharedMemory::remove(name);
+    return nullptr;
+  }
+
+  auto getColumn = [&](size_t column) {
+    return bytes + getSharedColumnOffset(fingerprint.size(), numStars, column);
+  };
+
+  auto result = std::make_unique<LoadResult>();
+
+  std::array<SharedArray<float>*, 5> columns = {&result->mStars.mVMagnitudes,
+      &result->mStars.mColorIndices, &result->mStars.mAscensions, &result->mStars.mDeclinations,
+      &result->mStars.mParallaxes};
+
+  for (size_t i = 0; i < columns.size(); ++i) {
+    *columns.at(i) = SharedArray<float>(reinterpret_cast<float const*>(getColumn(i)), numStars);
+  }
+
+  result->mMagnitudeOrder =
+      SharedArray<uint32_t>(reinterpret_cast<uint32_t const*>(getColumn(5)), numStars);
+
+  // The identifiers are delta-encoded, so each process keeps its own copy.
+  auto const* hipparcos = reinterpret_cast<uint32_t const*>(getColumn(6));
+  auto const* tycho     = reinterpret_cast<uint32_t const*>(getColumn(7));
+
+  for (size_t i = 0; i < numStars; ++i) {
+    result->mIdentifiers.push_back(hipparcos[i], tycho[i]);
+  }
+
+  uint8_t const* namesBegin = bytes + names;
+  uint8_t const* namesEnd   = namesBegin + header->mNamesSize;
+
+  while (static_cast<size_t>(namesEnd - namesBegin) >= 2 * sizeof(uint32_t)) {
+    uint32_t index  = 0;
+    uint32_t length = 0;
+    std::memcpy(&index, namesBegin, sizeof(uint32_t));
+    std::memcpy(&length, namesBegin + sizeof(uint32_t), sizeof(uint32_t));
+    namesBegin += 2 * sizeof(uint32_t);
+
+    if (index >= numStars || static_cast<size_t>(namesEnd - namesBegin) < length) {
+      break;
+    }
+
+    result->mIdentifiers.setName(index, std::string(namesBegin, namesBegin + length));
+    namesBegin += length;
+  }
+
+  result->mSharedMemory = std::move(memory);
+
+  logger().info("Mapped {} stars from shared memory '{}'.", numStars, name);
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::publishStars(
+    std::string const& name, std::string const& fingerprint, LoadResult& result) {
+  CSP_STARS_TRACE_ZONE("Publish shared stars");
+
+  const size_t numStars = result.mStars.size();
+
+  if (result.mIdentifiers.size() != numStars) {
+    return;
+  }
+
+  // The proper names are stored as star index, name length and characters.
+  std::string names;
+  for (auto const& [index, starName] : result.mIdentifiers.getNames()) {
+    auto length = static_cast<uint32_t>(starName.size());
+    names.append(reinterpret_cast<char const*>(&index), sizeof(uint32_t));
+    names.append(reinterpret_cast<char const*>(&length), sizeof(uint32_t));
+    names.append(starName);
+  }
+
+  size_t namesOffset = getSharedColumnOffset(fingerprint.size(), numStars, cNumSharedColumns);
+  auto   memory      = SharedMemory::create(name, namesOffset + names.size());
+  if (!memory) {
+    return;
+  }
+
+  auto* bytes  = static_cast<uint8_t*>(memory->getData());
+  auto* header = new (bytes) SharedStarsHeader{};
+
+  header->mMagic           = cSharedStarsMagic;
+  header->mVersion         = static_cast<uint32_t>(cCacheVersion);
+  header->mFingerprintSize = static_cast<uint32_t>(fingerprint.size());
+  header->mNumStars        = numStars;
+  header->mNamesSize       = names.size();
+  std::memcpy(bytes + sizeof(SharedStarsHeader), fingerprint.data(), fingerprint.size());
+  std::memcpy(bytes + namesOffset, names.data(), names.size());
+
+  auto getColumn = [&](size_t column) {
+    return bytes + getSharedColumnOffset(fingerprint.size(), numStars, column);
+  };
+
+  std::array<SharedArray<float>*, 5> columns = {&result.mStars.mVMagnitudes,
+      &result.mStars.mColorIndices, &result.mStars.mAscensions, &result.mStars.mDeclinations,
+      &result.mStars.mParallaxes};
+
+  for (size_t i = 0; i < columns.size(); ++i) {
+    std::memcpy(getColumn(i), columns.at(i)->data(), numStars * sizeof(float));
+  }
+
+  std::memcpy(getColumn(5), result.mMagnitudeOrder.data(), numStars * sizeof(uint32_t));
+
+  std::vector<uint32_t> hipparcos = result.mIdentifiers.decodeHipparcos();
+  std::vector<uint32_t> tycho     = result.mIdentifiers.decodeTycho();
+  std::memcpy(getColumn(6), hipparcos.data(), numStars * sizeof(uint32_t));
+  std::memcpy(getColumn(7), tycho.data(), numStars * sizeof(uint32_t));
+
+  header->mReady.store(1, std::memory_order_release);
+
+  // This process uses the shared copy as well, so that the star data is not stored twice.
+  for (size_t i = 0; i < columns.size(); ++i) {
+    *columns.at(i) = SharedArray<float>(reinterpret_cast<float const*>(getColumn(i)), numStars);
+  }
+
+  result.mMagnitudeOrder =
+      SharedArray<uint32_t>(reinterpret_cast<uint32_t const*>(getColumn(5)), numStars);
+  result.mSharedMemory = std::move(memory);
+
+  logger().info("Published {} stars in shared memory '{}'.", numStars, name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::releaseStars() {
+  CSP_STARS_TRACE_ZONE("Release stars");
+
+  cancelStarlightIrradiance();
+  cancelFaintStarMap();
+  waitForArrowExport();
+
+  // The video memory is released once the buffer is empty.
+  if (!mStars.empty()) {
+    mStarBuffer.free(mCatalogStarsFirst);
+  }
+
+  // Assigning empty containers actually frees the memory.
+  mStars = StarData();
+  mStarIdentifiers.clear();
+  mMagnitudeOrder = SharedArray<uint32_t>();
+  mTileOrder      = std::vector<uint32_t>();
+  mFaintStarMap   = std::vector<double>();
+  mTileCuller.clear();
+  mFaintStarTexture.reset();
+
+  // The arrays which refer to the segment have been cleared above.
+  mSharedMemory.reset();
+
+  mVariableStarVBO.Bind(GL_TEXTURE_BUFFER);
+  mVariableStarVBO.BufferData(0, nullptr, GL_STATIC_DRAW);
+  mVariableStarVBO.Release();
+
+  mVariableStarTexture.reset();
+  mNumVariableStars = 0;
+
+  updateStarDataMemoryUsage();
+  updateStarBufferMemoryUsage();
+  setMemoryUsage(MemoryCategory::eVariableStars, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::buildStarVAO() {
+  // Each attribute is written with a simple streaming loop over the star arrays and staged in the
+  // star buffer, which uploads it during the next frames. The actual colors are looked up in the
+  // shader. Until updateFarStarMagnitudes() has been called, all stars are treated as near stars.
+  // The absolute magnitudes are written last, as the stars become visible once these are uploaded.
+  const size_t count = mStars.size();
+  mPhotometryDirty   = true;
+
+  if (count == 0) {
+    return;
+  }
+
+  CSP_STARS_TRACE_ZONE("Build vertex data");
+
+  mCatalogStarsFirst = mStarBuffer.allocate(count);
+
+  // distance in parsec --- some have parallax of zero; assume a large distance in those cases
+  std::vector<float>    distances(count);
+  std::vector<uint16_t> tileIndices(count);
+
+  parallelFor(count, [&](size_t begin, size_t end) {
+    float const* ascensions   = mStars.mAscensions.data();
+    float const* declinations = mStars.mDeclinations.data();
+
+    for (size_t i = begin; i < end; ++i) {
+      distances[i] = getDistance(i);
+
+      // The direction of the star as seen from the sun, see the star vertex shader.
+      float dec      = declinations[i];
+      float asc      = ascensions[i];
+      tileIndices[i] = static_cast<uint16_t>(TileCuller::getTile(
+          std::cos(dec) * std::cos(asc), std::sin(dec), std::cos(dec) * std::sin(asc)));
+    }
+  });
+
+  // The stars are sorted by tile with a counting sort, which keeps their order within each tile.
+  std::vector<TileCuller::Tile> tiles(TileCuller::getNumTiles());
+
+  for (auto& tile : tiles) {
+    tile.mMinDistance = std::numeric_limits<float>::max();
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    auto& tile = tiles[tileIndices[i]];
+    ++tile.mCount;
+    tile.mMinDistance = std::min(tile.mMinDistance, distances[i]);
+  }
+
+  std::vector<size_t> nextSlots(tiles.size(), 0);
+
+  for (size_t i = 1; i < tiles.size(); ++i) {
+    tiles[i].mFirst = tiles[i - 1].mFirst + tiles[i - 1].mCount;
+    nextSlots[i]    = tiles[i].mFirst;
+  }
+
+  mTileOrder.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    mTileOrder[nextSlots[tileIndices[i]]++] = static_cast<uint32_t>(i);
+  }
+
+  tileIndices = std::vector<uint16_t>();
+  mTileCuller.setTiles(std::move(tiles));
+  updateStarDataMemoryUsage();
+
+  // All attributes are written in the order of mTileOrder.
+  std::vector<float> data(2 * count);
+  std::vector<float> sortedDistances(count);
+
+  parallelFor(count, [&](size_t begin, size_t end) {
+    float const* ascensions   = mStars.mAscensions.data();
+    float const* declinations = mStars.mDeclinations.data();
+
+    for (size_t i = begin; i < end; ++i) {
+      data[2 * i]     = declinations[mTileOrder[i]];
+      data[2 * i + 1] = ascensions[mTileOrder[i]];
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+      sortedDistances[i] = distances[mTileOrder[i]];
+    }
+  });
+
+  mStarBuffer.write(StarBuffer::Attribute::eDirection, mCatalogStarsFirst, count, data.data());
+  mStarBuffer.write(
+      StarBuffer::Attribute::eDistance, mCatalogStarsFirst, count, sortedDistances.data());
+
+  data.resize(count);
+
+  parallelFor(count, [&](size_t begin, size_t end) {
+    float const* colorIndices = mStars.mColorIndices.data();
+
+    for (size_t i = begin; i < end; ++i) {
+      data[i] = colorIndices[mTileOrder[i]];
+    }
+  });
+
+  mStarBuffer.write(StarBuffer::Attribute::eColorIndex, mCatalogStarsFirst, count, data.data());
+
+  std::fill(data.begin(), data.end(), cNearStarMagnitude);
+  mStarBuffer.write(StarBuffer::Attribute::eFarMagnitude, mCatalogStarsFirst, count, data.data());
+
+  buildVariableStarBuffers();
+
+  parallelFor(count, [&](size_t begin, size_t end) {
+    float const* vMagnitudes = mStars.mVMagnitudes.data();
+
+    for (size_t i = begin; i < end; ++i) {
+      data[i] = vMagnitudes[mTileOrder[i]] - 5.F * std::log10(sortedDistances[i] / 10.F);
+    }
+  });
+
+  mStarBuffer.write(StarBuffer::Attribute::eAbsMagnitude, mCatalogStarsFirst, count, data.data());
+
+  updateStarBufferMemoryUsage();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::buildDynamicStarVAO() {
+  CSP_STARS_TRACE_ZONE("Build dynamic stars");
+
+  size_t count = 0;
+  for (auto const& list : mDynamicStars) {
+    count += list.second.size();
+  }
+
+  mDynamicStarBuffer.resize(count);
+
+  using Attribute = StarBuffer::Attribute;
+
+  auto* directions    = static_cast<float*>(mDynamicStarBuffer.getData(Attribute::eDirection));
+  auto* distances     = static_cast<float*>(mDynamicStarBuffer.getData(Attribute::eDistance));
+  auto* colorIndices  = static_cast<float*>(mDynamicStarBuffer.getData(Attribute::eColorIndex));
+  auto* magnitudes    = static_cast<float*>(mDynamicStarBuffer.getData(Attribute::eAbsMagnitude));
+  auto* farMagnitudes = static_cast<float*>(mDynamicStarBuffer.getData(Attribute::eFarMagnitude));
+  auto* variableIndices =
+      static_cast<uint16_t*>(mDynamicStarBuffer.getData(Attribute::eVariableIndex));
+
+  // The coordinates are converted like those of the catalog stars. Dynamic stars are always
+  // treated as near stars, so that their magnitudes never have to be precomputed.
+  size_t i = 0;
+  for (auto const& list : mDynamicStars) {
+    for (auto const& star : list.second) {
+      directions[2 * i]     = star.mDeclination / 180.F * Vista::Pi;
+      directions[2 * i + 1] = (360.F + 90.F - star.mAscension) / 180.F * Vista::Pi;
+      distances[i]          = star.mDistance;
+      colorIndices[i]       = star.mColorIndex;
+      magnitudes[i]         = star.mMagnitude - 5.F * std::log10(star.mDistance / 10.F);
+      farMagnitudes[i]      = cNearStarMagnitude;
+      variableIndices[i]    = 0;
+      ++i;
+    }
+  }
+
+  mDynamicStarBuffer.upload();
+  mDynamicStarsDirty = false;
+
+  updateStarDataMemoryUsage();
+  updateStarBufferMemoryUsage();
+}
 
-    GLint loc = mBackgroundShader.GetUniformLocation("uInvMVP");
-    glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMVP.GetData());
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    loc = mBackgroundShader.GetUniformLocation("uInvMV");
-    glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMV.GetData());
+float Stars::getDistance(size_t index) const {
+  float parallax = mStars.mParallaxes[index];
+  return parallax > 0.F ? 1000.F / parallax : cUnknownDistance;
+}
 
-    if (mCelestialGridTexture && mBackgroundColor1[3] != 0.F) {
-      mBackgroundShader.SetUniform(mBackgroundShader.GetUniformLocation("cColor"),
-          mBackgroundColor1[0], mBackgroundColor1[1], mBackgroundColor1[2],
-          mBackgroundColor1[3] * backgroundIntensity);
-      mCelestialGridTexture->Bind(GL_TEXTURE0);
-      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-      mCelestialGridTexture->Unbind(GL_TEXTURE0);
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (mStarFiguresTexture && mBackgroundColor2[3] != 0.F) {
-      mBackgroundShader.SetUniform(mBackgroundShader.GetUniformLocation("cColor"),
-          mBackgroundColor2[0], mBackgroundColor2[1], mBackgroundColor2[2],
-          mBackgroundColor2[3] * backgroundIntensity);
-      mStarFiguresTexture->Bind(GL_TEXTURE0);
-      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-      mStarFiguresTexture->Unbind(GL_TEXTURE0);
+std::array<float, 3> Stars::getRelativePosition(size_t index, VistaVector3D const& observer) const {
+  float distance = getDistance(index);
+  float dec      = mStars.mDeclinations[index];
+  float asc      = mStars.mAscensions[index];
+
+  // See the star vertex shader.
+  return {std::cos(dec) * std::cos(asc) * distance - observer[0],
+      std::sin(dec) * distance - observer[1],
+      std::cos(dec) * std::sin(asc) * distance - observer[2]};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getApparentMagnitude(size_t index, float observerDistance) const {
+  return mStars.mVMagnitudes[index] + 5.F * std::log10(observerDistance / getDistance(index));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float Stars::getApparentMagnitude(size_t index, VistaVector3D const& observer) const {
+  std::array<float, 3> position = getRelativePosition(index, observer);
+
+  float observerDistance = std::sqrt(
+      position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+
+  return getApparentMagnitude(index, std::max(observerDistance, 1e-6F));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::updateFarStarMagnitudes(VistaVector3D const& observer) {
+  CSP_STARS_TRACE_ZONE("Update far star magnitudes");
+
+  // Moving the observer by r towards a star at distance d changes its magnitude by at most
+  // 5 * log10(d / (d - r)). Solving for d gives the minimum distance of the far stars.
+  const float nearDistance =
+      cPhotometryRegionRadius / (1.F - std::pow(10.F, -cMaxPhotometryError / 5.F));
+
+  const size_t        count = mStars.size();
+  std::vector<float>  magnitudes(count);
+  std::atomic<size_t> numNearStars{0};
+
+  setMemoryUsage(MemoryCategory::eTransient, magnitudes.size() * sizeof(float));
+
+  parallelFor(count, [&](size_t begin, size_t end) {
+    size_t near = 0;
+
+    // The magnitudes are stored in the order of the stars in the star buffer.
+    for (size_t i = begin; i < end; ++i) {
+      uint32_t             star     = mTileOrder[i];
+      std::array<float, 3> position = getRelativePosition(star, observer);
+
+      float observerDistance = std::sqrt(position[0] * position[0] +
+                                         position[1] * position[1] + position[2] * position[2]);
+
+      if (observerDistance < nearDistance) {
+        magnitudes[i] = cNearStarMagnitude;
+        ++near;
+      } else {
+        magnitudes[i] = getApparentMagnitude(star, observerDistance);
+      }
     }
 
-    mBackgroundShader.Release();
-    mBackgroundVAO.Release();
+    numNearStars += near;
+  });
+
+  mStarBuffer.write(
+      StarBuffer::Attribute::eFarMagnitude, mCatalogStarsFirst, count, magnitudes.data());
+
+  setMemoryUsage(MemoryCategory::eTransient, 0);
+  updateStarBufferMemoryUsage();
+
+  mPhotometryOrigin     = observer;
+  mNumNearStars         = numNearStars;
+  mLastPhotometryUpdate = std::chrono::steady_clock::now();
+  mPhotometryDirty      = false;
+  mPerVertexPhotometry  = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::buildVariableStarBuffers() {
+  CSP_STARS_TRACE_ZONE("Build variable star buffers");
+
+  mNumVariableStars = 0;
+  mVariableStarTexture.reset();
+  setMemoryUsage(MemoryCategory::eVariableStars, 0);
+
+  if (mStars.empty()) {
+    return;
   }
 
-  // draw stars
-  mStarVAO.Bind();
-  mStarShader.Bind();
+  // The indices are written also if there are no variable stars, so that previously assigned
+  // indices are reset. The first record is unused, as an index of zero marks non-variable stars.
+  // Each record contains the period, the epoch, the amplitude and the light curve type.
+  std::vector<uint16_t> indices(mStars.size(), 0);
+  std::vector<float>    records(4, 0.F);
 
-  if (mDrawMode == DrawMode::ePoint || mDrawMode == DrawMode::eSmoothPoint) {
-    glPointSize(0.5F);
+  for (auto const& variable : mVariableStars) {
+    if (records.size() / 4 > std::numeric_limits<uint16_t>::max()) {
+      logger().warn("Too many variable stars! Only the first {} are used.", mNumVariableStars);
+      break;
+    }
+
+    auto index = mStarIdentifiers.findHipparcos(variable.mHipparcos);
+    if (!index) {
+      continue;
+    }
+
+    indices[*index] = static_cast<uint16_t>(records.size() / 4);
+    records.insert(records.end(), {variable.mPeriod, variable.mEpoch, variable.mAmplitude,
+                                      static_cast<float>(cs::utils::enumCast(variable.mType))});
+    ++mNumVariableStars;
   }
 
-  if (mDrawMode == DrawMode::eSmoothPoint) {
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_POINT_SMOOTH);
-    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-  } else {
-    glDisable(GL_POINT_SMOOTH);
+  // The indices are stored in the order of the stars in the star buffer.
+  std::vector<uint16_t> sortedIndices(indices.size());
+  for (size_t i = 0; i < sortedIndices.size(); ++i) {
+    sortedIndices[i] = indices[mTileOrder[i]];
   }
 
-  std::array<int, 4> viewport{};
-  glGetIntegerv(GL_VIEWPORT, viewport.data());
+  mStarBuffer.write(StarBuffer::Attribute::eVariableIndex, mCatalogStarsFirst,
+      sortedIndices.size(), sortedIndices.data());
 
-  mStarShader.SetUniform(mStarShader.GetUniformLocation("uResolution"),
-      static_cast<float>(viewport.at(2)), static_cast<float>(viewport.at(3)));
+  if (mVariableStars.empty()) {
+    return;
+  }
 
-  mStarTexture->Bind(GL_TEXTURE0);
-  mStarShader.SetUniform(mStarShader.GetUniformLocation("uStarTexture"), 0);
-  mStarShader.SetUniform(mStarShader.GetUniformLocation("uMinMagnitude"), mMinMagnitude);
-  mStarShader.SetUniform(mStarShader.GetUniformLocation("uMaxMagnitude"), mMaxMagnitude);
-  mStarShader.SetUniform(mStarShader.GetUniformLocation("uSolidAngle"), mSolidAngle);
-  mStarShader.SetUniform(
-      mStarShader.GetUniformLocation("uLuminanceMultiplicator"), mLuminanceMultiplicator);
+  logger().info("Assigned {} of {} variable stars to loaded stars.", mNumVariableStars,
+      mVariableStars.size());
 
-  VistaTransformMatrix matInverseMV(matModelView.GetInverted());
-  VistaTransformMatrix matInverseP(matProjection.GetInverted());
+  if (mNumVariableStars == 0) {
+    return;
+  }
 
-  GLint loc = mStarShader.GetUniformLocation("uMatMV");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, matModelView.GetData());
+  mVariableStarVBO.Bind(GL_TEXTURE_BUFFER);
+  mVariableStarVBO.BufferData(records.size() * sizeof(float), records.data(), GL_STATIC_DRAW);
+  mVariableStarVBO.Release();
 
-  loc = mStarShader.GetUniformLocation("uMatP");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, matProjection.GetData());
+  mVariableStarTexture = std::make_unique<VistaTexture>(GL_TEXTURE_BUFFER);
+  mVariableStarTexture->Bind();
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mVariableStarVBO.GetId());
+  mVariableStarTexture->Unbind();
 
-  loc = mStarShader.GetUniformLocation("uInvMV");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseMV.GetData());
+  setMemoryUsage(MemoryCategory::eVariableStars, records.size() * sizeof(float));
+}
 
-  loc = mStarShader.GetUniformLocation("uInvP");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, matInverseP.GetData());
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(mStars.size()));
+VistaTexture* Stars::getVariableStarTexture() {
+  if (mVariableStarTexture) {
+    return mVariableStarTexture.get();
+  }
 
-  mStarTexture->Unbind(GL_TEXTURE0);
+  if (!mEmptyVariableStarTexture) {
+    const std::array<float, 4> record{};
 
-  mStarShader.Release();
-  mStarVAO.Release();
+    mEmptyVariableStarVBO.Bind(GL_TEXTURE_BUFFER);
+    mEmptyVariableStarVBO.BufferData(sizeof(record), record.data(), GL_STATIC_DRAW);
+    mEmptyVariableStarVBO.Release();
 
-  glDepthMask(GL_TRUE);
-  glPopAttrib();
+    mEmptyVariableStarTexture = std::make_unique<VistaTexture>(GL_TEXTURE_BUFFER);
+    mEmptyVariableStarTexture->Bind();
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mEmptyVariableStarVBO.GetId());
+    mEmptyVariableStarTexture->Unbind();
+  }
 
-  return true;
+  return mEmptyVariableStarTexture.get();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Stars::GetBoundingBox(VistaBoundingBox& oBoundingBox) {
-  float      min(std::numeric_limits<float>::min());
-  float      max(std::numeric_limits<float>::max());
-  std::array fMin{min, min, min};
-  std::array fMax{max, max, max};
+void Stars::setMemoryUsage(MemoryCategory category, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mMemoryUsageMutex);
 
-  oBoundingBox.SetBounds(fMin.data(), fMax.data());
+  auto& entry    = mMemoryUsage.mCategories.at(cs::utils::enumCast(category));
+  entry.mCurrent = bytes;
+  entry.mPeak    = std::max(entry.mPeak, bytes);
 
-  return true;
+  mMemoryUsage.mCPU.mCurrent = 0;
+  mMemoryUsage.mGPU.mCurrent = 0;
+
+  for (size_t i = 0; i < mMemoryUsage.mCategories.size(); ++i) {
+    auto& total = i < cs::utils::enumCast(MemoryCategory::eVertexBuffers) ? mMemoryUsage.mCPU
+                                                                          : mMemoryUsage.mGPU;
+    total.mCurrent += mMemoryUsage.mCategories.at(i).mCurrent;
+  }
+
+  mMemoryUsage.mCPU.mPeak = std::max(mMemoryUsage.mCPU.mPeak, mMemoryUsage.mCPU.mCurrent);
+  mMemoryUsage.mGPU.mPeak = std::max(mMemoryUsage.mGPU.mPeak, mMemoryUsage.mGPU.mCurrent);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Stars::readStarsFromCatalog(CatalogType type, std::string const& filename) {
-  bool success = false;
-  logger().info("Reading star catalog '{}'.", filename);
+void Stars::updateStarBufferMemoryUsage() {
+  setMemoryUsage(MemoryCategory::eVertexBuffers,
+      mStarBuffer.getSizeInBytes() + mDynamicStarBuffer.getSizeInBytes());
 
-  std::ifstream file;
+  // While loading, the transient memory is accounted by the loading thread.
+  if (mDataState != DataState::eLoading) {
+    setMemoryUsage(MemoryCategory::eTransient,
+        mStarBuffer.getStagedBytes() + mDynamicStarBuffer.getStagedBytes());
+  }
+}
 
-  try {
-    file.open(filename.c_str(), std::ifstream::in);
-  } catch (std::exception& e) {
-    logger().error("Failed to open catalog file '{}': {}", filename, e.what());
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::updateStarDataMemoryUsage() {
+  size_t dynamicStars = 0;
+  for (auto const& list : mDynamicStars) {
+    dynamicStars += list.second.capacity() * sizeof(DynamicStar);
   }
 
-  if (file.is_open()) {
-    int  lineCount = 0;
-    bool loadHipparcos(mCatalogs.find(CatalogType::eHipparcos) != mCatalogs.end());
+  setMemoryUsage(MemoryCategory::eStarData,
+      mStars.getSizeInBytes() + mStarIdentifiers.getSizeInBytes() +
+          mVariableStars.capacity() * sizeof(VariableStar) +
+          mMagnitudeOrder.capacity() * sizeof(uint32_t) +
+          mTileOrder.capacity() * sizeof(uint32_t) + mFaintStarMap.capacity() * sizeof(double) +
+          dynamicStars);
+  setMemoryUsage(MemoryCategory::eSharedMemory, mSharedMemory ? mSharedMemory->getSize() : 0);
+}
 
-    // read line by line
-    while (!file.eof()) {
-      // get line
-      ++lineCount;
-      std::string line;
-      getline(file, line);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-      // parse line:
-      // separate complete items consisting of "val0|val1|...|valN|" into vector of value
-      // strings
-      std::stringstream        stream(line);
-      std::string              item;
-      std::vector<std::string> items;
+void Stars::updateTextureMemoryUsage() {
+  // The fallback star texture has 64x64 RGBA texels with mipmaps, the color lookup table has
+  // cColorLUTSize RGB16F texels. The variable star texture is only a view on a buffer.
+  size_t bytes = mDebugView.getSizeInBytes();
 
-      while (getline(stream, item, '|')) {
-        items.emplace_back(item);
-      }
+  for (auto const* texture : {mStarTexture.get(), mCelestialGridTexture.get(),
+           mStarFiguresTexture.get()}) {
+    if (texture) {
+      bytes += texture->getSizeInBytes();
+    }
+  }
 
-      // convert value strings to int/double/float and save in star data structure
-      // expecting Hipparcos or Tycho-1 catalog and more than 12 columns
-      if (items.size() > 12) {
-        // skip if part of hipparcos catalogue
-        int tmp{};
-        if (type != CatalogType::eHipparcos && loadHipparcos &&
-            fromString<int>(items[cColumnMapping.at(cs::utils::enumCast(type))
-                                      .at(cs::utils::enumCast(CatalogColumn::eHipp))],
-                tmp)) {
-          continue;
-        }
+  if (mFallbackStarTexture) {
+    bytes += 64 * 64 * 4 * 4 / 3;
+  }
 
-        // store star data
-        bool successStoreData(true);
+  if (mColorLUT) {
+    bytes += cColorLUTSize * 3 * sizeof(uint16_t);
+  }
 
-        Star star{};
-        successStoreData &= fromString<float>(
-            items[cColumnMapping.at(
-                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eVmag)]],
-            star.mVMagnitude);
-        successStoreData &= fromString<float>(
-            items[cColumnMapping.at(
-                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eBmag)]],
-            star.mBMagnitude);
-        successStoreData &= fromString<float>(
-            items[cColumnMapping.at(
-                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eRect)]],
-            star.mAscension);
-        successStoreData &= fromString<float>(
-            items[cColumnMapping.at(
-                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::eDecl)]],
-            star.mDeclination);
+  if (mFaintStarTexture) {
+    bytes += static_cast<size_t>(cFaintStarMapWidth) * cFaintStarMapHeight * 3 * sizeof(float);
+  }
 
-        if (cColumnMapping.at(
-                cs::utils::enumCast(type))[cs::utils::enumCast(CatalogColumn::ePara)] > 0) {
-          if (!fromString<float>(items[cColumnMapping.at(cs::utils::enumCast(type))
-                                           .at(cs::utils::enumCast(CatalogColumn::ePara))],
-                  star.mParallax)) {
-            star.mParallax = 0;
-          }
-        } else {
-          star.mParallax = 0;
-        }
+  setMemoryUsage(MemoryCategory::eTextures, bytes);
+}
 
-        if (successStoreData) {
-          star.mAscension   = (360.F + 90.F - star.mAscension) / 180.F * Vista::Pi;
-          star.mDeclination = star.mDeclination / 180.F * Vista::Pi;
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-          mStars.emplace_back(star);
-        }
-      }
+std::array<int32_t, 3> Stars::getObserverRegion() const {
+  // The regions are centered on multiples of their size, so that an observer in the solar system
+  // does not alternate between the eight regions which touch the sun.
+  return {static_cast<int32_t>(std::round(mObserverPosition[0] / cIrradianceRegionSize)),
+      static_cast<int32_t>(std::round(mObserverPosition[1] / cIrradianceRegionSize)),
+      static_cast<int32_t>(std::round(mObserverPosition[2] / cIrradianceRegionSize))};
+}
 
-      // print progress status
-      if (mStars.size() % 10000 == 0) {
-        logger().info("Read {} stars so far...", mStars.size());
-      }
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::updateStarlightIrradiance() {
+  if (mIrradianceTask.valid()) {
+    if (mIrradianceTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return;
     }
-    file.close();
-    success = true;
 
-    logger().info("Read a total of {} stars.", mStars.size());
-  } else {
-    logger().error("Failed to load stars: Cannot open catalog file '{}'!", filename);
+    auto result = mIrradianceTask.get();
+    if (result) {
+      mStarlightIrradiance = std::move(*result);
+    }
   }
 
-  return success;
+  if (!mIrradianceDirty || mDataState != DataState::eLoaded) {
+    return;
+  }
+
+  mIrradianceDirty     = false;
+  mIrradianceRegion    = getObserverRegion();
+  mIrradianceCancelled = false;
+
+  // Each region has its own cache file, e.g. "star_cache_irradiance_0_0_0.dat". The irradiance
+  // is integrated for the center of the region, so that the cached result does not depend on
+  // where the observer entered the region.
+  std::string region = std::to_string(mIrradianceRegion[0]) + "_" +
+                       std::to_string(mIrradianceRegion[1]) + "_" +
+                       std::to_string(mIrradianceRegion[2]);
+  std::string cacheFile = getDerivedCacheFile("irradiance_" + region);
+
+  VistaVector3D center(static_cast<float>(mIrradianceRegion[0]) * cIrradianceRegionSize,
+      static_cast<float>(mIrradianceRegion[1]) * cIrradianceRegionSize,
+      static_cast<float>(mIrradianceRegion[2]) * cIrradianceRegionSize);
+
+  mIrradianceTask = std::async(std::launch::async,
+      [this, cacheFile, center, catalogs = mCatalogs]() {
+        return computeStarlightIrradiance(cacheFile, center, catalogs);
+      });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::writeStarCache(const std::string& sCacheFile) const {
-  VistaType::uint32 catalogs = 0;
-  for (auto const& mCatalog : mCatalogs) {
-    catalogs += static_cast<uint32_t>(std::pow(2, static_cast<int>(mCatalog.first)));
+void Stars::cancelStarlightIrradiance() {
+  if (!mIrradianceTask.valid()) {
+    return;
   }
 
-  VistaByteBufferSerializer serializer;
-  serializer.WriteInt32(
-      static_cast<VistaType::uint32>(cCacheVersion)); // cache format version number
-  serializer.WriteInt32(catalogs);                    // cache format version number
-  serializer.WriteInt32(static_cast<VistaType::uint32>(
-      mStars.size())); // write number of stars to front of byte stream
+  // The region has to be computed again once the stars are available.
+  mIrradianceCancelled = true;
+  mIrradianceTask.wait();
+  mIrradianceTask  = {};
+  mIrradianceDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<StarlightIrradiance> Stars::computeStarlightIrradiance(
+    std::string const& cacheFile, VistaVector3D const& observer,
+    std::map<CatalogType, std::string> const& catalogs) const {
+  CSP_STARS_TRACE_ZONE("Compute starlight irradiance");
+
+  auto irradiance = std::make_unique<StarlightIrradiance>();
+
+  // The catalogs are stored in the cache file in order to detect changes of the catalog set.
+  auto writeHeader = [&catalogs](CacheWriter& writer) {
+    writer.writeUInt32(static_cast<uint32_t>(cCacheVersion));
+    writer.writeUInt32(static_cast<uint32_t>(catalogs.size()));
+    for (auto const& [type, filename] : catalogs) {
+      writer.writeUInt32(static_cast<uint32_t>(type));
+      writer.writeString(filename);
+      writer.writeInt64(getFileSize(filename));
+    }
+  };
+
+  auto readHeader = [&catalogs](CacheReader& reader) {
+    uint32_t cacheVersion = 0;
+    uint32_t numCatalogs  = 0;
+
+    if (!reader.readUInt32(cacheVersion) || cacheVersion != cCacheVersion ||
+        !reader.readUInt32(numCatalogs) || numCatalogs != catalogs.size()) {
+      return false;
+    }
+
+    for (auto const& [type, filename] : catalogs) {
+      uint32_t    catalogType = 0;
+      std::string catalogFile;
+      int64_t     catalogSize = 0;
+
+      if (!reader.readUInt32(catalogType) || catalogType != static_cast<uint32_t>(type) ||
+          !reader.readString(catalogFile) || catalogFile != filename ||
+          !reader.readInt64(catalogSize) || catalogSize != getFileSize(filename)) {
+        return false;
+      }
+    }
+
+    return true;
+  };
 
-  for (const auto& mStar : mStars) {
-    // serialize star data into byte stream
-    serializer.WriteFloat32(mStar.mVMagnitude);
-    serializer.WriteFloat32(mStar.mBMagnitude);
-    serializer.WriteFloat32(mStar.mAscension);
-    serializer.WriteFloat32(mStar.mDeclination);
-    serializer.WriteFloat32(mStar.mParallax);
+  CacheReader reader(cacheFile, &mIrradianceCancelled);
+  if (reader.isValid() && readHeader(reader) && irradiance->deserialize(reader)) {
+    logger().info("Read starlight irradiance from '{}'.", cacheFile);
+    return irradiance;
   }
 
-  // open file
-  std::ofstream file;
-  file.open(sCacheFile.c_str(), std::ios::out | std::ios::binary);
-  if (file.is_open()) {
-    // write serialized star data
-    logger().info("Writing {} stars ({} bytes) into '{}'.", mStars.size(),
-        serializer.GetBufferSize(), sCacheFile);
+  if (mIrradianceCancelled) {
+    return nullptr;
+  }
 
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    file.write(reinterpret_cast<const char*>(serializer.GetBuffer()), serializer.GetBufferSize());
-    file.close();
-  } else {
-    logger().error(
-        "Failed to write binary star data: Cannot open file '{}' for writing!", sCacheFile);
+  auto start = std::chrono::steady_clock::now();
+
+  // The star colors are normalized to unit luminance, so that the illuminance of each star can
+  // simply be multiplied with its color.
+  std::vector<std::array<float, 3>> colors(cColorLUTSize);
+  for (int i = 0; i < cColorLUTSize; ++i) {
+    float alpha     = static_cast<float>(i) / static_cast<float>(cColorLUTSize - 1);
+    auto  color     = getSpectralColor(cMinColorIndex + alpha * (cMaxColorIndex - cMinColorIndex));
+    float luminance = 0.2126F * color[0] + 0.7152F * color[1] + 0.0722F * color[2];
+    for (size_t c = 0; c < 3; ++c) {
+      colors[i].at(c) = color.at(c) / luminance;
+    }
   }
+
+  std::mutex mutex;
+
+  parallelFor(mStars.size(), [&](size_t begin, size_t end) {
+    StarlightIrradiance chunk;
+
+    for (size_t i = begin; i < end; ++i) {
+      if (i % 65536 == 0 && mIrradianceCancelled) {
+        return;
+      }
+
+      std::array<float, 3> position = getRelativePosition(i, observer);
+
+      float observerDistance = std::sqrt(position[0] * position[0] +
+                                         position[1] * position[1] + position[2] * position[2]);
+
+      if (observerDistance < 1e-6F) {
+        continue;
+      }
+
+      float illuminance = cZeroMagnitudeIlluminance *
+                          std::pow(10.F, -0.4F * getApparentMagnitude(i, observerDistance));
+
+      float bv       = std::clamp(mStars.mColorIndices[i], cMinColorIndex, cMaxColorIndex);
+      float lutCoord = (bv - cMinColorIndex) / (cMaxColorIndex - cMinColorIndex);
+      auto  index    = static_cast<size_t>(lutCoord * static_cast<float>(cColorLUTSize - 1) + 0.5F);
+
+      VistaVector3D direction(position[0] / observerDistance, position[1] / observerDistance,
+          position[2] / observerDistance);
+
+      chunk.add(direction, {illuminance * colors[index][0], illuminance * colors[index][1],
+                               illuminance * colors[index][2]});
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    irradiance->add(chunk);
+  });
+
+  if (mIrradianceCancelled) {
+    return nullptr;
+  }
+
+  logger().info("Computed starlight irradiance of {} stars in {:.2f} seconds.", mStars.size(),
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  CacheWriter writer(cacheFile);
+  writeHeader(writer);
+  irradiance->serialize(writer);
+
+  if (!writer.commit()) {
+    logger().warn("Failed to write starlight irradiance to '{}'!", cacheFile);
+  }
+
+  // The cache files of all regions only differ in the region coordinates, see
+  // updateStarlightIrradiance().
+  const std::string regionPrefix = "irradiance_";
+  size_t            regionStart  = cacheFile.rfind(regionPrefix) + regionPrefix.size();
+  size_t            regionEnd    = regionStart + getRegionLength(cacheFile.substr(regionStart));
+  removeOldCacheFiles(cacheFile.substr(0, regionStart), cacheFile.substr(regionEnd),
+      cMaxIrradianceCacheFiles);
+
+  return irradiance;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool Stars::readStarCache(const std::string& sCacheFile) {
-  bool success = false;
+void Stars::buildColorLUT() {
+  CSP_STARS_TRACE_ZONE("Build color lookup table");
 
-  // open file
-  std::ifstream file;
-  file.open(sCacheFile.c_str(),
-      std::ios::in | std::ios::binary | std::ios::ate); // ate = set read pointer to end
-  if (file.is_open()) {
+  std::vector<float> lut = createColorLUT(mColorModel);
 
-    // read binary data from file
-    int                          size = static_cast<int>(file.tellg());
-    std::vector<VistaType::byte> data(size);
+  if (!mColorLUT) {
+    mColorLUT = std::make_unique<VistaTexture>(GL_TEXTURE_1D);
+    mColorLUT->Bind();
+    mColorLUT->SetWrapS(GL_CLAMP_TO_EDGE);
+    mColorLUT->SetMinFilter(GL_LINEAR);
+    mColorLUT->SetMagFilter(GL_LINEAR);
+  } else {
+    mColorLUT->Bind();
+  }
 
-    // set read pointer to the beginning of file stream
-    file.seekg(0, std::ios::beg);
+  glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB16F, cColorLUTSize, 0, GL_RGB, GL_FLOAT, lut.data());
+  mColorLUT->Unbind();
 
-    // read file stream into char array 'data'
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    file.read(reinterpret_cast<char*>(&data[0]), size);
-    file.close();
+  mColorLUTDirty = false;
+}
 
-    // de-serialize byte stream
-    VistaType::uint32 cacheVersion = 0;
-    VistaType::uint32 catalogs     = 0;
-    VistaType::uint32 numStars     = 0;
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    VistaByteBufferDeSerializer deserializer;
-    deserializer.SetBuffer(&data[0], size); // prepare for de-serialization
-    deserializer.ReadInt32(cacheVersion);   // read cache format version number
-    deserializer.ReadInt32(catalogs);       // read which catalogs were loaded
-    deserializer.ReadInt32(numStars);       // read number of stars from front of byte stream
+void Stars::resetFaintStarMap() {
+  cancelFaintStarMap();
 
-    if (cacheVersion != cCacheVersion) {
-      return false;
-    }
+  mFaintStarMap.assign(mFaintStarMap.size(), 0.0);
+  mFaintStarMagnitude = std::numeric_limits<float>::max();
+}
 
-    VistaType::uint32 catalogsToLoad = 0;
-    for (const auto& mCatalog : mCatalogs) {
-      catalogsToLoad += static_cast<uint32_t>(std::pow(2, static_cast<int>(mCatalog.first)));
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (catalogs != catalogsToLoad) {
-      return false;
+void Stars::cancelFaintStarMap() {
+  if (!mFaintStarMapTask.valid()) {
+    return;
+  }
+
+  mFaintStarMapCancelled = true;
+  mFaintStarMapTask.wait();
+  mFaintStarMapTask = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Stars::updateFaintStarMap() {
+  if (mFaintStarMapTask.valid()) {
+    if (mFaintStarMapTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return;
     }
 
-    for (unsigned int num = 0; num < numStars; ++num) {
-      Star star{};
-      deserializer.ReadFloat32(star.mVMagnitude);
-      deserializer.ReadFloat32(star.mBMagnitude);
-      deserializer.ReadFloat32(star.mAscension);
-      deserializer.ReadFloat32(star.mDeclination);
-      deserializer.ReadFloat32(star.mParallax);
+    CSP_STARS_TRACE_ZONE("Upload faint star map");
 
-      mStars.emplace_back(star);
+    std::vector<float> data = mFaintStarMapTask.get();
 
-      // print progress status
-      if (mStars.size() % 100000 == 0) {
-        logger().info("Read {} stars so far...", mStars.size());
-      }
+    if (!mFaintStarTexture) {
+      mFaintStarTexture = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+      mFaintStarTexture->Bind();
+      mFaintStarTexture->SetWrapS(GL_REPEAT);
+      mFaintStarTexture->SetWrapT(GL_CLAMP_TO_EDGE);
+      mFaintStarTexture->SetMinFilter(GL_LINEAR);
+      mFaintStarTexture->SetMagFilter(GL_LINEAR);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, cFaintStarMapWidth, cFaintStarMapHeight, 0,
+          GL_RGB, GL_FLOAT, data.data());
+    } else {
+      mFaintStarTexture->Bind();
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cFaintStarMapWidth, cFaintStarMapHeight, GL_RGB,
+          GL_FLOAT, data.data());
     }
 
-    success = true;
+    mFaintStarTexture->Unbind();
 
-    logger().info("Read a total of {} stars.", mStars.size());
+    updateStarDataMemoryUsage();
   }
 
-  return success;
+  if (mFaintStarMagnitude == mMaxMagnitude) {
+    return;
+  }
+
+  if (mFaintStarMap.empty()) {
+    mFaintStarMap.resize(3 * static_cast<size_t>(cFaintStarMapWidth) * cFaintStarMapHeight, 0.0);
+  }
+
+  // mMagnitudeOrder is sorted by magnitude, hence the stars between the old and the new cutoff
+  // form a contiguous range. Stars with a magnitude equal to the cutoff are still drawn as stars.
+  // If the cutoff decreased, these stars are added to the map, else they are subtracted.
+  auto compare = [this](float magnitude, uint32_t i) { return magnitude < mStars.mVMagnitudes[i]; };
+  auto lower   = std::upper_bound(mMagnitudeOrder.begin(), mMagnitudeOrder.end(),
+      std::min(mFaintStarMagnitude, mMaxMagnitude), compare);
+  auto upper   = std::upper_bound(mMagnitudeOrder.begin(), mMagnitudeOrder.end(),
+      std::max(mFaintStarMagnitude, mMaxMagnitude), compare);
+  double sign  = mMaxMagnitude < mFaintStarMagnitude ? 1.0 : -1.0;
+
+  mFaintStarMagnitude    = mMaxMagnitude;
+  mFaintStarMapCancelled = false;
+
+  size_t first = std::distance(mMagnitudeOrder.begin(), lower);
+  size_t count = std::distance(lower, upper);
+
+  mFaintStarMapTask = std::async(std::launch::async,
+      [this, first, count, sign, colorModel = mColorModel]() {
+        return accumulateFaintStarMap(first, count, sign, colorModel);
+      });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Stars::buildStarVAO() {
-  int                c(0);
-  const int          iElementCount(7);
-  std::vector<float> data(iElementCount * mStars.size());
-
-  for (auto it = mStars.begin(); it != mStars.end(); ++it, c += iElementCount) {
-    // use B and V magnitude to retrieve the according color
-    const float minIdx(-0.4F);
-    const float maxIdx(2.0F);
-    const float step(0.05F);
-    float       bvIndex = std::min(maxIdx, std::max(minIdx, it->mBMagnitude - it->mVMagnitude));
-    float       normalizedIndex = (bvIndex - minIdx) / (maxIdx - minIdx) / step + 0.5F;
-    VistaColor  color           = sSpectralColors.at(static_cast<int>(normalizedIndex));
-
-    // distance in parsec --- some have parallax of zero; assume a
-    // large distance in those cases
-    float fDist = 100000.F;
-
-    if (it->mParallax > 0.F) {
-      fDist = 1000.F / it->mParallax;
-    }
-
-    data[c]     = it->mDeclination;
-    data[c + 1] = it->mAscension;
-    data[c + 2] = fDist;
-    data[c + 3] = color.GetRed();
-    data[c + 4] = color.GetGreen();
-    data[c + 5] = color.GetBlue();
-    data[c + 6] = it->mVMagnitude - 5.F * std::log10(fDist / 10.F);
-  }
-
-  mStarVBO.Bind(GL_ARRAY_BUFFER);
-  mStarVBO.BufferData(iElementCount * mStars.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-  mStarVBO.Release();
-
-  // star positions
-  mStarVAO.EnableAttributeArray(0);
-  mStarVAO.SpecifyAttributeArrayFloat(
-      0, 2, GL_FLOAT, GL_FALSE, iElementCount * sizeof(float), 0, &mStarVBO);
-
-  // star distances
-  mStarVAO.EnableAttributeArray(1);
-  mStarVAO.SpecifyAttributeArrayFloat(
-      1, 1, GL_FLOAT, GL_FALSE, iElementCount * sizeof(float), 2 * sizeof(float), &mStarVBO);
-
-  // color
-  mStarVAO.EnableAttributeArray(2);
-  mStarVAO.SpecifyAttributeArrayFloat(
-      2, 3, GL_FLOAT, GL_FALSE, iElementCount * sizeof(float), 3 * sizeof(float), &mStarVBO);
-
-  // magnitude
-  mStarVAO.EnableAttributeArray(3);
-  mStarVAO.SpecifyAttributeArrayFloat(
-      3, 1, GL_FLOAT, GL_FALSE, iElementCount * sizeof(float), 6 * sizeof(float), &mStarVBO);
+std::vector<float> Stars::accumulateFaintStarMap(
+    size_t first, size_t count, double sign, ColorModel colorModel) {
+  CSP_STARS_TRACE_ZONE("Update faint star map");
+
+  const size_t width  = cFaintStarMapWidth;
+  const size_t height = cFaintStarMapHeight;
+
+  // The texels of an equirectangular map get smaller towards the poles. The luminance of a texel
+  // is the illuminance of its stars divided by its solid angle.
+  const double        pi = Vista::Pi;
+  std::vector<double> inverseSolidAngles(height);
+  for (size_t y = 0; y < height; ++y) {
+    double theta          = (static_cast<double>(y) + 0.5) / static_cast<double>(height) * pi;
+    double solidAngle     = 2.0 * pi / width * pi / height * std::sin(theta);
+    inverseSolidAngles[y] = 1.0 / solidAngle;
+  }
+
+  // The same colors are used as for the stars in the shader.
+  std::vector<float> lut        = createColorLUT(colorModel);
+  bool               byDistance = colorModel == ColorModel::eDistance;
+  float              lutMin     = byDistance ? cMinLogDistance : cMinColorIndex;
+  float              lutMax     = byDistance ? cMaxLogDistance : cMaxColorIndex;
+
+  // The texel and the luminance of the stars are computed in parallel for blocks of stars, which
+  // are then added to the map by this thread. This way, the threads need no map of their own.
+  const size_t                       blockSize = 262144;
+  std::vector<size_t>                texels(std::min(count, blockSize));
+  std::vector<std::array<double, 3>> luminances(texels.size());
+
+  for (size_t block = 0; block < count; block += blockSize) {
+    if (mFaintStarMapCancelled) {
+      return {};
+    }
+
+    size_t blockEnd = std::min(count, block + blockSize);
+
+    parallelFor(blockEnd - block, [&](size_t begin, size_t end) {
+      for (size_t k = begin; k < end; ++k) {
+        uint32_t i   = mMagnitudeOrder[first + block + k];
+        float    dec = mStars.mDeclinations[i];
+        float    asc = mStars.mAscensions[i];
+
+        // The direction to the star as in the star vertex shader, mapped to texture coordinates
+        // as in the background fragment shader.
+        float x = std::cos(dec) * std::cos(asc);
+        float y = std::sin(dec);
+        float z = std::cos(dec) * std::sin(asc);
+        float u = 0.5F * std::atan2(x, -z) / Vista::Pi;
+        float v = std::acos(std::clamp(y, -1.F, 1.F)) / Vista::Pi;
+
+        auto column = static_cast<size_t>((u < 0.F ? u + 1.F : u) * static_cast<float>(width));
+        auto row    = static_cast<size_t>(v * static_cast<float>(height));
+        column      = std::min(column, width - 1);
+        row         = std::min(row, height - 1);
+
+        float value    = byDistance ? std::log10(getDistance(i)) : mStars.mColorIndices[i];
+        float lutCoord = std::clamp((value - lutMin) / (lutMax - lutMin), 0.F, 1.F);
+        auto  index    =
+            static_cast<size_t>(lutCoord * static_cast<float>(cColorLUTSize - 1) + 0.5F);
+
+        double luminance = cZeroMagnitudeIlluminance *
+                           std::pow(10.0, -0.4 * mStars.mVMagnitudes[i]) * inverseSolidAngles[row];
+
+        texels[k] = row * width + column;
+        for (size_t c = 0; c < 3; ++c) {
+          luminances[k].at(c) = luminance * lut[3 * index + c];
+        }
+      }
+    });
+
+    for (size_t k = 0; k < blockEnd - block; ++k) {
+      for (size_t c = 0; c < 3; ++c) {
+        mFaintStarMap[3 * texels[k] + c] += sign * luminances[k].at(c);
+      }
+    }
+  }
+
+  // Rounding errors may leave tiny negative values when stars are removed again.
+  std::vector<float> data(mFaintStarMap.size());
+  for (size_t k = 0; k < data.size(); ++k) {
+    data[k] = static_cast<float>(std::max(mFaintStarMap[k], 0.0));
+  }
+
+  return data;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
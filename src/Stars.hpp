@@ -8,6 +8,7 @@
 #define CSP_STARS_VISTA_STARS_HPP
 
 #include <VistaBase/VistaColor.h>
+#include <VistaBase/VistaVectorMath.h>
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 #include <VistaOGLExt/VistaBufferObject.h>
 #include <VistaOGLExt/VistaGLSLShader.h>
@@ -15,9 +16,23 @@
 #include <VistaOGLExt/VistaVertexArrayObject.h>
 
 #include "../../../src/cs-utils/utils.hpp"
-
+#include "AsyncTexture.hpp"
+#include "ClusterTransport.hpp"
+#include "DebugView.hpp"
+#include "SharedMemory.hpp"
+#include "StarBuffer.hpp"
+#include "StarIdentifiers.hpp"
+#include "StarlightIrradiance.hpp"
+#include "TileCuller.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace csp::stars {
@@ -28,15 +43,34 @@ namespace csp::stars {
 /// information such as a constellations or grid lines.
 class Stars : public IVistaOpenGLDraw {
  public:
+  /// Uploads the screen-filling quad of the background. The stars themselves are loaded lazily
+  /// once they are drawn for the first time.
+  Stars();
+
+  /// Waits for cache segments and Arrow files which are currently written in the background.
+  ~Stars() override;
+
+  Stars(Stars const& other) = delete;
+  Stars(Stars&& other)      = delete;
+  Stars& operator=(Stars const& other) = delete;
+  Stars& operator=(Stars&& other) = delete;
+
   /// The supported catalog Types.
   /// Hipparcos and Tycho can be obtained from:
   ///    http://cdsarc.u-strasbg.fr/viz-bin/Cat?cat=I%2F239
   /// Tycho2 can be obtained from:
   ///    http://cdsarc.u-strasbg.fr/cgi-bin/myqcat3?I/259/
-  enum class CatalogType { eHipparcos = 0, eTycho, eTycho2, eCount };
+  /// eHYG reads comma-separated files with a header line, such as the HYG database or CSV exports
+  /// of the Yale Bright Star Catalog. HYG can be obtained from:
+  ///    https://github.com/astronexus/HYG-Database
+  /// The columns are looked up by their names, see readStarsFromCsvCatalog().
+  /// eArrow reads Apache Arrow IPC files (Feather V2), for example files written by exportArrow()
+  /// or prepared with pyarrow, pandas or polars. See readStarsFromArrow() for the columns.
+  enum class CatalogType { eHipparcos = 0, eTycho, eTycho2, eHYG, eArrow, eCount };
 
   /// The required columns of each catalog. The position of each column in each catalog is
-  /// configured with the static member COLUMN_MAPPING at the bottom of this file.
+  /// configured with the static member COLUMN_MAPPING at the bottom of this file. This is not used
+  /// for comma-separated catalogs.
   enum class CatalogColumn {
     eVmag = 0, ///< visual magnitude
     eBmag,     ///< blue magnitude
@@ -44,27 +78,166 @@ class Stars : public IVistaOpenGLDraw {
     eRect,     ///< rectascension
     eDecl,     ///< declination
     eHipp,     ///< hipparcos number
+    eTyc,      ///< tycho identifier (TYC1 TYC2 TYC3)
+    eParaErr,  ///< standard error of the parallax
     eCount
   };
 
   enum class DrawMode { ePoint, eSmoothPoint, eDisc, eSmoothDisc, eSprite };
 
+  /// How the stars and the background are projected to the screen.
+  enum class Projection {
+    ePerspective, ///< The projection matrix of the current view is used.
+    eFisheye      ///< An azimuthal equidistant projection around the view direction.
+  };
+
+  /// The star colors are looked up in the shader from a small color table. The models differ in
+  /// how this table is computed.
+  enum class ColorModel {
+    eSpectral,    ///< Measured colors of stars depending on their B-V color index.
+    eBlackbody,   ///< Colors of a black body with the temperature estimated from the B-V index.
+    eDesaturated, ///< Spectral colors but less saturated, similar to the visual impression.
+    eDistance     ///< False colors depending on the distance: near stars blue, far stars red.
+  };
+
+  /// The state of the star data. The catalogs are not loaded in setCatalogs() but on a background
+  /// thread once the stars are drawn for the first time. If the stars are not drawn for a while,
+  /// the star data may be released again, see setIdleTimeout().
+  enum class DataState { eUnloaded, eLoading, eLoaded, eReleased };
+
+  /// Some information on the currently loaded star data.
+  struct Statistics {
+    DataState mState;
+    size_t    mNumStars;
+    size_t    mCPUBytes;         ///< Currently allocated main memory, see getMemoryUsage().
+    size_t    mGPUBytes;         ///< Currently allocated video memory, see getMemoryUsage().
+    uint32_t  mLoadCount;        ///< How often the star data has been loaded.
+    uint32_t  mReleaseCount;     ///< How often the star data has been released.
+    double    mLastLoadDuration; ///< In seconds.
+    uint64_t  mSamplesPassed;    ///< Fragments drawn by the stars in a recent frame.
+    float     mOverdraw;         ///< mSamplesPassed divided by the number of pixels.
+    size_t    mNumNearStars;     ///< Stars whose magnitude is computed in each frame.
+    size_t    mNumDynamicStars;  ///< Stars in all dynamic star lists.
+    size_t    mNumCulledTiles;   ///< Sky tiles hidden behind the scene in a recent frame.
+    size_t    mNumCulledStars;   ///< Catalog stars in these tiles.
+  };
+
+  /// The progress of loading the star data. Catalogs are counted with their file size, also if
+  /// their stars are read from a cache segment instead.
+  struct LoadingProgress {
+    bool        mLoading;           ///< False if no catalogs are loaded at the moment.
+    std::string mCatalog;           ///< The catalog file which is currently read.
+    int64_t     mCatalogBytesRead;  ///< Bytes read from the current catalog file.
+    int64_t     mCatalogBytes;      ///< Size of the current catalog file.
+    int64_t     mBytesRead;         ///< Bytes read from all catalog files.
+    int64_t     mBytes;             ///< Size of all catalog files.
+    double      mBytesPerSecond;    ///< Average rate since loading started.
+    double      mRemainingSeconds;  ///< Estimated from the rate, negative if not known yet.
+    bool        mWaitingForCluster; ///< True while waiting for the other cluster nodes.
+  };
+
+  /// The allocations of the plugin are accounted in these categories.
+  enum class MemoryCategory {
+    eStarData = 0,  ///< Main memory: The loaded stars, their identifiers and variability data.
+    eCacheSegments, ///< Main memory: Parsed catalogs which are not yet written to the cache.
+    eTransient,     ///< Main memory: Catalog segments and vertex data while the stars are loaded.
+    eSharedMemory,  ///< Main memory: Star data mapped from a segment, see setEnableSharedMemory().
+    eVertexBuffers, ///< Video memory: The vertex buffer of the stars.
+    eVariableStars, ///< Video memory: The variable star records.
+    eTextures,      ///< Video memory: All textures, including the debug view render targets.
+    eCount
+  };
+
+  /// The current and the peak number of bytes of each memory category. The peak values are the
+  /// maxima since the Stars have been created. The totals are accounted separately, so their peaks
+  /// are not the sums of the individual peaks.
+  struct MemoryUsage {
+    struct Entry {
+      size_t mCurrent = 0;
+      size_t mPeak    = 0;
+    };
+
+    std::array<Entry, cs::utils::enumCast(MemoryCategory::eCount)> mCategories;
+    Entry                                                          mCPU;
+    Entry                                                          mGPU;
+  };
+
   /// It is possible to load multiple catalogs, currently Hipparcos and any of Tycho or Tycho2 can
   /// be loaded together. Stars which are in both catalogs will be loaded from Hipparcos. Once
-  /// loaded, the stars will be written to a binary cache file. Subsequent instantiations of this
-  /// class with the same call to setCatalogs() will use the stars from the cache file rather from
-  /// the catalogs.
+  /// loaded, the stars of each catalog will be written to a separate binary cache segment.
+  /// Subsequent loads will use the stars from the cache segments rather from the catalogs. Hence
+  /// adding or removing a catalog only requires parsing the added catalog. The catalogs are loaded
+  /// in the background when the stars are drawn for the next time. A load which is still in
+  /// progress is cancelled.
   void setCatalogs(std::map<CatalogType, std::string> catalogs);
   std::map<CatalogType, std::string> const& getCatalogs() const;
 
-  /// Subsequent calls to setCatalogs() will use this cache file. Defaults to "star_cache.dat".
+  /// Subsequent calls to setCatalogs() will use cache files derived from this file name. For
+  /// example, the Tycho2 stars will be cached in "star_cache_tycho2.dat". Defaults to
+  /// "star_cache.dat".
   void               setCacheFile(std::string cacheFile);
   std::string const& getCacheFile() const;
 
+  /// Rules for dropping catalog rows while they are parsed, so that the dropped stars use neither
+  /// memory nor space in the cache segments. A star is dropped if any of the rules rejects it.
+  struct IngestFilter {
+    /// A star is dropped if the given column of its catalog contains any of the given characters.
+    /// For example, {CatalogType::eHipparcos, 59, "CGOVX"} drops all Hipparcos stars which have a
+    /// multiplicity flag. Columns are counted from zero, also for comma-separated catalogs. For
+    /// Arrow files, the column is the index in the schema and has to be a string column.
+    struct RejectedFlag {
+      CatalogType mCatalog;
+      int         mColumn;
+      std::string mCharacters;
+    };
+
+    /// Stars fainter than this visual magnitude are dropped.
+    std::optional<float> mMaxMagnitude;
+
+    /// Stars whose parallax is smaller than this multiple of its standard error are dropped,
+    /// including stars without parallax. This only applies to catalogs with parallax errors; Arrow
+    /// files need a 'parallax_error' column.
+    std::optional<float> mMinParallaxQuality;
+
+    /// If not empty, only stars inside one of these polygons are kept. The vertices are given as
+    /// right ascension and declination in degrees; the edges are straight lines in these
+    /// coordinates. Polygons may extend beyond 360 degrees of right ascension in order to cross
+    /// the vernal equinox.
+    std::vector<std::vector<std::array<float, 2>>> mRegions;
+
+    std::vector<RejectedFlag> mRejectedFlags;
+
+    /// Returns a string which identifies the filter, or an empty string if it drops no stars.
+    std::string getFingerprint() const;
+  };
+
+  /// Sets the filter which is applied when the catalogs are parsed. The filter is part of the
+  /// cache segment file names, so that the caches of differently filtered catalogs coexist. If
+  /// the filter changes, the stars are reloaded when they are drawn for the next time.
+  void                setIngestFilter(IngestFilter filter);
+  IngestFilter const& getIngestFilter() const;
+
   /// Specifies how the stars should be drawn.
   void     setDrawMode(DrawMode value);
   DrawMode getDrawMode() const;
 
+  /// In Projection::eFisheye, the projection matrix is ignored and the stars and the background
+  /// are drawn with an azimuthal equidistant projection around the view direction. The fisheye
+  /// circle touches the top and bottom of the viewport, so that a square viewport results in a
+  /// dome master which can be rendered in a single pass. The rest of the scene has to be
+  /// projected in the same way by the application. Default is Projection::ePerspective.
+  void       setProjection(Projection value);
+  Projection getProjection() const;
+
+  /// The field of view of the fisheye projection in degrees, measured across the fisheye circle.
+  /// Default is 180.
+  void  setFisheyeAperture(float degrees);
+  float getFisheyeAperture() const;
+
+  /// Specifies how the star colors are computed. Changing this only updates a small lookup table.
+  void       setColorModel(ColorModel value);
+  ColorModel getColorModel() const;
+
   /// Sets the size of the stars.
   /// Stars will be drawn covering this solid angle. This has no effect if DrawMode
   /// is set to ePoint. Default is 0.01f.
@@ -72,6 +245,19 @@ class Stars : public IVistaOpenGLDraw {
   void  setSolidAngle(float value);
   float getSolidAngle() const;
 
+  /// In DrawMode::eSprite, the quads of bright stars can become very large and dominate the fill
+  /// rate. If this is larger than zero, the quads are limited to this size in pixels. A limited
+  /// sprite is shrunk as a whole and brightened accordingly, so that its total flux is retained.
+  /// Default is 0.
+  void  setMaxSpriteSize(float value);
+  float getMaxSpriteSize() const;
+
+  /// When enabled, a visualization of the rendering costs is drawn instead of the sky: The number
+  /// of fragments per pixel as a heatmap, the number of stars per screen tile and a histogram of
+  /// the apparent magnitudes of all stars. Everything is computed on the GPU.
+  void setEnableDebugView(bool value);
+  bool getEnableDebugView() const;
+
   /// When set to true, stars will be drawn with true luminance values. Else their brightness will
   /// be between 0 and 1.
   void setEnableHDR(bool value);
@@ -87,12 +273,20 @@ class Stars : public IVistaOpenGLDraw {
   void  setMaxMagnitude(float value);
   float getMaxMagnitude() const;
 
+  /// When enabled, the light of all stars fainter than the maximum magnitude is drawn as a diffuse
+  /// glow in the background, so that the total brightness of the sky does not depend on the
+  /// magnitude cutoff. The glow map is integrated from the catalog positions as seen from the Sun.
+  /// Default is true.
+  void setEnableFaintStars(bool value);
+  bool getEnableFaintStars() const;
+
   void  setLuminanceMultiplicator(float value);
   float getLuminanceMultiplicator() const;
 
   /// Adds a skydome texture. The given texture is projected via equirectangular projection onto the
-  /// background and blended additively.
-  /// @param sFilename    A path to an uncompressed TGA image or "" to disable this image.
+  /// background and blended additively. The image is decoded in the background and shown once it
+  /// is available.
+  /// @param sFilename    A path to an image file or "" to disable this image.
   void setCelestialGridTexture(std::string const& filename);
   void setStarFiguresTexture(std::string const& filename);
 
@@ -105,71 +299,664 @@ class Stars : public IVistaOpenGLDraw {
   const VistaColor& getStarFiguresColor() const;
 
   /// Sets the star texture. This texture should be a small (e.g. 64x64) image used for every star.
-  /// @param sFilename    A path to an uncompressed grayscale TGA image.
+  /// The image is decoded in the background, until then a built-in star texture is used.
+  /// @param sFilename    A path to a grayscale image file.
   void setStarTexture(const std::string& filename);
 
+  /// The light curve types of variable stars.
+  enum class VariableType {
+    eMira,     ///< Sinusoidal variation around the catalog magnitude.
+    eCepheid,  ///< Fast rise to maximum and slow decline, centered around the catalog magnitude.
+    eEclipsing ///< The catalog magnitude with a short dip at phase zero.
+  };
+
+  /// Loads variability parameters for stars which are identified by their Hipparcos number. The
+  /// file is expected to contain comma-separated lines of the form
+  ///   <hip>,<period in days>,<epoch in julian days>,<amplitude in magnitudes>,<type>
+  /// where <type> is one of "mira", "cepheid" or "eclipsing". Lines starting with '#' are
+  /// ignored. The brightness variation is evaluated in the vertex shader based on the simulation
+  /// time. Pass an empty string to disable variable stars.
+  void               setVariableStarsFile(std::string const& filename);
+  std::string const& getVariableStarsFile() const;
+
+  /// The current simulation time in TDB seconds since J2000. This is used for computing the
+  /// brightness of variable stars.
+  void   setSimulationTime(double tdbSeconds);
+  double getSimulationTime() const;
+
+  /// Returns the Hipparcos and Tycho identifiers of the loaded stars. The star indices correspond
+  /// to the order in which the stars are stored internally. This is empty as long as the star data
+  /// is not loaded.
+  StarIdentifiers const& getStarIdentifiers() const;
+
+  /// Writes the loaded stars to an Apache Arrow IPC file with one float32, uint32 or utf8 column
+  /// for each property, so that it can be analysed with pyarrow, pandas or polars. The columns
+  /// are "ra" and "dec" in degrees, "parallax" in milliarcseconds, "vmag", "color_index" (B-V),
+  /// "apparent_vmag" as seen from the given observer position in parsecs, "hip", "tycho" (packed
+  /// with StarIdentifiers::packTycho()) and "name". The file can be loaded again as a catalog of
+  /// type CatalogType::eArrow. The file is written on a background thread and the result is
+  /// logged. Returns false if the stars are not loaded or if another export is still running.
+  bool exportArrow(std::string const& file, VistaVector3D const& observer);
+
+  /// The light of all loaded stars integrated over the sky as seen from the center of the
+  /// observer's region, with directions given in the star frame. It is computed on a background
+  /// thread once the stars have been loaded and whenever the observer enters another region; the
+  /// result is cached on disk for each catalog set and region. Renderers can query it each frame
+  /// in constant time. It is zero until the stars have been loaded for the first time and remains
+  /// valid when the star data is released.
+  StarlightIrradiance const& getStarlightIrradiance() const;
+
+  /// The position of the observer relative to the sun in parsecs, given in the star frame. It is
+  /// derived from the modelview matrix whenever the stars are drawn and is the origin before that.
+  VistaVector3D const& getObserverPosition() const;
+
+  /// If the stars have not been drawn for the given amount of seconds, their vertex buffers and
+  /// star data are released. They are reloaded from the cache segments once the stars are drawn
+  /// again. A negative value disables releasing the star data. Default is -1.
+  void   setIdleTimeout(double seconds);
+  double getIdleTimeout() const;
+
+  /// If enabled, the loaded star data is published in a named POSIX shared memory segment. Other
+  /// processes on the same host which load the same catalogs map this segment read-only instead of
+  /// loading the catalogs themselves. The segment is identified by the cache version and the names
+  /// and sizes of the catalog files. It is removed when the publishing process releases its stars;
+  /// processes which have mapped it keep their mapping. Default is false.
+  void setEnableSharedMemory(bool value);
+  bool getEnableSharedMemory() const;
+
+  /// If enabled, the catalog stars are drawn per sky tile and tiles which are entirely hidden
+  /// behind the already rendered scene are skipped on the GPU, see TileCuller. This saves most of
+  /// the star rendering when the observer is close to a planet. This requires the stars to be drawn
+  /// after the planets, see getForegroundDraw(). Default is true.
+  void setEnableOcclusionCulling(bool value);
+  bool getEnableOcclusionCulling() const;
+
+  /// In a cluster, only the master node loads the catalogs. It writes the loaded stars to a
+  /// cluster cache file which is sent to all other nodes with the given transport. These verify
+  /// the file and load the stars from it, so all nodes use the same stars even if their catalogs
+  /// or cache files differ. Data of earlier sessions of the transport is ignored. If the master
+  /// has not sent any stars within cClusterMasterTimeout seconds, the other nodes load their own
+  /// catalogs. Finally, all nodes wait for each other before they show the stars. Pass nullptr to
+  /// load the catalogs on each node independently, which is the default.
+  void setClusterTransport(std::shared_ptr<ClusterTransport> transport);
+
+  /// A star which is supplied by the application instead of a catalog, see setDynamicStars().
+  struct DynamicStar {
+    float mAscension;   ///< Right ascension in degrees.
+    float mDeclination; ///< Declination in degrees.
+    float mDistance;    ///< Distance to the sun in parsecs, has to be positive.
+    float mMagnitude;   ///< Apparent visual magnitude as seen from the sun.
+    float mColorIndex;  ///< B-V color index.
+  };
+
+  /// Dynamic star lists contain stars like predicted target stars, simulated novae or spacecraft
+  /// beacons. They are drawn in the same pass as the catalog stars, but from a separate streaming
+  /// buffer which is uploaded as a whole in the next frame whenever any list has changed. They do
+  /// not contribute to the faint star glow and the starlight irradiance. This replaces the list
+  /// with the given name; an empty vector removes the list. Stars with values which are not finite
+  /// or with a distance which is not positive are rejected together with the whole list.
+  void setDynamicStars(std::string const& list, std::vector<DynamicStar> stars);
+
+  /// Replaces the stars of the given list starting at the given index. The list is enlarged if
+  /// required; it is created if it does not exist and first is zero. Nothing is changed if first is
+  /// larger than the size of the list or if any of the stars is invalid, see setDynamicStars().
+  void updateDynamicStars(
+      std::string const& list, size_t first, std::vector<DynamicStar> const& stars);
+
+  /// Returns the names of all dynamic star lists.
+  std::vector<std::string> getDynamicStarLists() const;
+
+  /// Releases the star data if the idle timeout has passed. This should be called once each frame,
+  /// also if the stars are not drawn.
+  void update();
+
+  Statistics getStatistics() const;
+
+  /// Returns the memory accounted so far. The texture sizes are estimated from their dimensions
+  /// and are updated whenever the stars are drawn.
+  MemoryUsage getMemoryUsage() const;
+
+  /// Returns the progress of the catalog loading which is currently running in the background.
+  LoadingProgress getLoadingProgress() const;
+
+  /// Returns getMemoryUsage() formatted as JSON. This is also printed once the stars are loaded.
+  std::string getMemoryReport() const;
+
+  /// Returns getStatistics() formatted as JSON.
+  std::string getStatisticsReport() const;
+
   /// The method Do() gets the callback from scene graph during the rendering process.
   bool Do() override;
 
   /// This method should return the bounding box of the openGL object you draw in the method Do().
   bool GetBoundingBox(VistaBoundingBox& oBoundingBox) override;
 
+  /// By default, Do() draws the stars right after the background. The sky tiles are tested against
+  /// the depth buffer, so they are only culled if the stars are drawn after the planets. For this,
+  /// the returned object has to be added to the scene graph below the same transformation as the
+  /// Stars, but with a draw order after all opaque geometry. Once this has been called, Do() only
+  /// draws the background and the returned object draws the stars of the same frame.
+  IVistaOpenGLDraw* getForegroundDraw();
+
  private:
+  /// Draws the stars after the opaque geometry, see getForegroundDraw().
+  class ForegroundDraw : public IVistaOpenGLDraw {
+   public:
+    explicit ForegroundDraw(Stars& stars);
+
+    bool Do() override;
+    bool GetBoundingBox(VistaBoundingBox& oBoundingBox) override;
+
+   private:
+    Stars& mStars;
+  };
+
   /// Data structure of one record from star catalog.
   struct Star {
-    float mVMagnitude;
-    float mBMagnitude;
-    float mAscension;
-    float mDeclination;
-    float mParallax;
+    float    mVMagnitude;
+    float    mBMagnitude;
+    float    mAscension;
+    float    mDeclination;
+    float    mParallax;
+    uint32_t mHipparcos;
+    uint32_t mTycho;
+  };
+
+  /// Internal storage of all loaded stars. Each attribute is stored in its own contiguous array
+  /// so that passes over the star set (like building the vertex buffer) can stream through
+  /// memory and be split into independent chunks. Instead of the blue magnitude, the B-V color
+  /// index is stored as this is what is actually needed for coloring the stars.
+  struct StarData {
+    SharedArray<float> mVMagnitudes;
+    SharedArray<float> mColorIndices;
+    SharedArray<float> mAscensions;
+    SharedArray<float> mDeclinations;
+    SharedArray<float> mParallaxes;
+
+    size_t size() const;
+    bool   empty() const;
+    void   clear();
+    void   resize(size_t count);
+    void   reserve(size_t count);
+    void   push_back(Star const& star);
+
+    /// Returns the allocated size of all arrays.
+    size_t getSizeInBytes() const;
+
+    /// Appends the star at the given index of another StarData.
+    void append(StarData const& other, size_t index);
+  };
+
+  /// The stars read from one catalog.
+  struct CatalogSegment {
+    StarData        mStars;
+    StarIdentifiers mIdentifiers;
   };
 
-  /// Reads star data from binary file.
-  bool readStarsFromCatalog(CatalogType type, std::string const& filename);
+  /// A catalog segment which has been loaded from a catalog but not yet written to the cache.
+  struct PendingCacheSegment {
+    std::string                     mCacheFile;
+    CatalogType                     mType;
+    std::string                     mCatalogFile;
+    std::string                     mFilterFingerprint;
+    std::unique_ptr<CatalogSegment> mSegment;
+  };
+
+  /// One catalog to be loaded. The cache segment file names are determined before loading starts,
+  /// so that the loading thread does not access any members.
+  struct CatalogJob {
+    CatalogType mType;
+    std::string mCatalogFile;
+    std::string mCacheFile;
+    int64_t     mFileSize;
+    bool        mSkipHipparcosStars;
+  };
+
+  /// The progress and cancellation token of one load. It is shared between the render thread and
+  /// the loading thread; only the atomic members are modified once the loading has started.
+  struct LoadingState {
+    std::vector<CatalogJob>               mJobs;
+    int64_t                               mBytes = 0;
+    std::chrono::steady_clock::time_point mStartTime;
+    std::atomic<bool>                     mCancelled{false};
+    std::atomic<size_t>                   mJobIndex{0};
+    std::atomic<int64_t>                  mCatalogBytesRead{0};
+    std::atomic<int64_t>                  mFinishedBytes{0};
+    std::string                           mSharedMemoryName;
+    std::string                           mFingerprint;
+    IngestFilter                          mIngestFilter;
+    std::string                           mFilterFingerprint;
+    std::shared_ptr<ClusterTransport>     mClusterTransport;
+    uint32_t                              mClusterMessage = 0;
+    std::atomic<bool>                     mWaitingForCluster{false};
+    std::string                           mClusterFile;
+  };
+
+  /// The stars of all catalogs as assembled by the loading thread.
+  struct LoadResult {
+    StarData                         mStars;
+    StarIdentifiers                  mIdentifiers;
+    std::vector<PendingCacheSegment> mPendingCacheSegments;
+    size_t                           mCacheSegmentBytes = 0;
+    SharedArray<uint32_t>            mMagnitudeOrder;
+    std::shared_ptr<SharedMemory>    mSharedMemory;
+  };
+
+  /// Starts loading the stars of all catalogs in mCatalogs on a background thread.
+  void startLoading();
+
+  /// Uploads the loaded stars to the GPU once the loading thread has finished.
+  void finishLoading();
+
+  /// Stops the loading thread if it is running. This returns within a few milliseconds, as the
+  /// loading thread checks the cancellation flag for each line it parses.
+  void cancelLoading();
+
+  /// Executed on the loading thread: Reads all catalogs of the given state from the cache segments
+  /// or the catalog files. Returns nullptr if the loading has been cancelled.
+  std::unique_ptr<LoadResult> loadCatalogs(LoadingState& state);
+
+  /// Frees the star data and the vertex buffers. The catalogs remain configured, so that the stars
+  /// can be reloaded from the cache segments.
+  void releaseStars();
+
+  /// Reads all stars from the given catalog file. No de-duplication against other catalogs is
+  /// done here, this happens when the stars are added in appendStars(). The number of bytes read
+  /// is reported to the given state. Returns false if the file could not be read or if the
+  /// loading has been cancelled.
+  static bool readStarsFromCatalog(CatalogType type, std::string const& filename,
+      CatalogSegment& segment, LoadingState& state);
+
+  /// Called by readStarsFromCatalog() for comma-separated catalogs. The first line has to name
+  /// the columns. The visual magnitude is read from "mag" or "vmag" and the B-V color index from
+  /// "ci" or "bv"; stars without color index are assumed to be white. The position is read from
+  /// the equatorial Cartesian coordinates "x", "y" and "z" in parsecs if present, else from "ra"
+  /// in hours, "dec" in degrees and the optional "dist" in parsecs. Distances of 100000 parsecs
+  /// or more are considered unknown, as in HYG. The optional columns "hip" and "proper" or "name"
+  /// provide the Hipparcos number and the proper name.
+  static bool readStarsFromCsvCatalog(CatalogType type, std::string const& filename,
+      CatalogSegment& segment, LoadingState& state);
+
+  /// Maps an Apache Arrow IPC file. The columns are looked up by name: "vmag" or "mag", "ra" and
+  /// "dec" in degrees are required; "color_index", "parallax" in milliarcseconds, "hip", "tycho"
+  /// and "name" are optional. Float32 columns without null values are used without copying them,
+  /// in this case the mapping of the file is returned in memory and has to be kept as long as the
+  /// segment is used. Right ascension and declination are always converted to the internal
+  /// representation. If the ingest filter is set or if required values are missing, the remaining
+  /// stars are copied. Arrow catalogs are never cached, as mapping them is faster than reading a
+  /// cache segment.
+  static bool readStarsFromArrow(std::string const& filename, CatalogSegment& segment,
+      std::shared_ptr<SharedMemory>& memory, LoadingState& state);
+
+  /// Writes the stars read from one catalog into a binary cache segment. The data is streamed into
+  /// a temporary file which atomically replaces the cache segment once it is complete. This is
+  /// thread-safe.
+  static void writeStarCache(std::string const& cacheFile, CatalogType type,
+      std::string const& catalogFile, std::string const& filterFingerprint,
+      CatalogSegment const& segment);
+
+  /// Reads the stars of one catalog from a binary cache segment. Returns false if there is no
+  /// valid segment, if it was created from a different catalog file or with a different filter, or
+  /// if cancelled became true while reading.
+  static bool readStarCache(std::string const& cacheFile, CatalogType type,
+      std::string const& catalogFile, std::string const& filterFingerprint,
+      CatalogSegment& segment, std::atomic<bool> const& cancelled);
+
+  /// Writes all segments in mPendingCacheSegments on a background thread. This is called once a
+  /// frame has been drawn, so that writing the cache does not delay the first frame. If a previous
+  /// write is still in progress, this does nothing.
+  void writePendingCacheSegments();
+
+  /// Returns the file name of the cache segment of the given catalog. This is derived from
+  /// mCacheFile by appending the catalog's name, e.g. "star_cache_tycho2.dat".
+  std::string getCacheSegmentFile(CatalogType type) const;
+
+  /// Returns mCacheFile with the given name appended before the file extension. If an ingest
+  /// filter is set, a hash of its fingerprint is appended as well, as all derived caches depend on
+  /// the filtered star set.
+  std::string getDerivedCacheFile(std::string const& name) const;
+
+  /// Appends the stars of one catalog to the given result. If skipHipparcosStars is set, stars
+  /// which have a Hipparcos number are skipped, as they are loaded from another catalog. Their
+  /// names are assigned to the star with the same Hipparcos number which is already in the result.
+  static void appendStars(
+      CatalogSegment const& segment, bool skipHipparcosStars, LoadResult& result);
+
+  /// Returns a string which identifies the star data loaded from mCatalogs.
+  std::string getCatalogFingerprint() const;
+
+  /// Returns the indices of the given stars sorted by increasing magnitude.
+  static SharedArray<uint32_t> getMagnitudeOrder(StarData const& stars);
+
+  /// Executed on the loading thread of the cluster master: Writes the given stars to the cluster
+  /// cache file, sends it to all other nodes and waits for them. Returns false if the loading has
+  /// been cancelled.
+  static bool sendClusterStars(LoadingState& state, LoadResult const& result);
+
+  /// Executed on the loading thread of the other cluster nodes: Waits for the cluster cache file of
+  /// the master, reads it and waits for the other nodes. Returns nullptr if the loading has been
+  /// cancelled.
+  static std::unique_ptr<LoadResult> receiveClusterStars(LoadingState& state);
+
+  /// Reads the stars of a cluster cache file. Returns nullptr if the file is incomplete or if it
+  /// has not been written together with the given message.
+  static std::unique_ptr<LoadResult> readClusterStars(
+      std::string const& file, std::string const& message);
+
+  /// Waits until all cluster nodes have arrived with the given token, but at most cClusterTimeout
+  /// seconds. Returns false if the loading has been cancelled or if the master has sent newer data
+  /// in the meantime.
+  static bool waitForCluster(
+      ClusterTransport& transport, std::string const& token, LoadingState const& state);
+
+  /// Executed on the loading thread: Maps the star data published by another process. Returns
+  /// nullptr if there is no complete segment with the given name and fingerprint. Segments which
+  /// do not match or which have been left incomplete by a crashed process are removed.
+  static std::unique_ptr<LoadResult> mapSharedStars(
+      std::string const& name, std::string const& fingerprint);
+
+  /// Executed on the loading thread: Copies the given stars to a new shared memory segment and
+  /// replaces the arrays of the result by views of this segment. Nothing happens if the segment
+  /// already exists.
+  static void publishStars(
+      std::string const& name, std::string const& fingerprint, LoadResult& result);
+
+  /// Variability parameters of one star as read from the variable stars file.
+  struct VariableStar {
+    uint32_t     mHipparcos;
+    float        mPeriod;
+    float        mEpoch;
+    float        mAmplitude;
+    VariableType mType;
+  };
+
+  /// Assigns the variable stars to the loaded stars and uploads their parameters to the GPU. This
+  /// has to be called whenever the stars or the variable stars change.
+  void buildVariableStarBuffers();
+
+  /// Returns mVariableStarTexture or, if there are no variable stars, a texture with a single
+  /// empty record. The star shaders always sample unit 2, so something has to be bound there.
+  VistaTexture* getVariableStarTexture();
+
+  /// Sets all uniforms required by the star shaders. The textures have to be bound already.
+  void setStarUniforms(VistaGLSLShader& shader, VistaTransformMatrix const& matModelView,
+      VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport);
+
+  /// Sets the uniforms of the fisheye projection. Does nothing in Projection::ePerspective.
+  void setFisheyeUniforms(VistaGLSLShader& shader, std::array<int, 4> const& viewport);
+
+  /// Draws the stars into the render targets of mDebugView and shows the result.
+  void drawDebugView(VistaTransformMatrix const& matModelView,
+      VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport);
+
+  /// Updates the current and peak values of the given memory category and of the totals.
+  void setMemoryUsage(MemoryCategory category, size_t bytes);
+
+  /// Accounts the current size of mStars, mStarIdentifiers, mVariableStars and mDynamicStars.
+  void updateStarDataMemoryUsage();
+
+  /// Accounts the video memory of mStarBuffer and mDynamicStarBuffer and their staged data.
+  void updateStarBufferMemoryUsage();
+
+  /// Binds the star shader and its textures and draws all stars, or the debug view instead.
+  void drawStarPass(VistaTransformMatrix const& matModelView,
+      VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport);
+
+  /// Called by mForegroundDraw: Draws the stars if Do() has skipped them in this frame.
+  bool drawForeground();
+
+  /// Draws the catalog stars and the dynamic stars with the currently bound shader. If cull is
+  /// true, the catalog stars are drawn with mTileCuller, which has to be tested in the same frame.
+  void drawStars(bool cull);
+
+  /// Returns the angular radius in radians by which the stars drawn with the current settings may
+  /// extend beyond their position on screen.
+  float getCullingMargin(
+      VistaTransformMatrix const& matProjection, std::array<int, 4> const& viewport) const;
+
+  /// Accounts the estimated size of all textures which have been uploaded so far.
+  void updateTextureMemoryUsage();
+
+  /// Sets mObserverPosition and marks the starlight irradiance as dirty if the observer has
+  /// entered another region.
+  void setObserverPosition(VistaVector3D const& parsecs);
+
+  /// Applies the result of a finished irradiance computation to mStarlightIrradiance. If the
+  /// irradiance is dirty and no computation is running, a new one is started on a background
+  /// thread for the current observer region.
+  void updateStarlightIrradiance();
 
-  /// Writes internal star data read from catalog into a binary file.
-  void writeStarCache(const std::string& cacheFile) const;
+  /// Waits for a running irradiance computation after asking it to stop. This has to be called
+  /// before mStars is modified.
+  void cancelStarlightIrradiance();
 
-  /// Reads star data from binary file.
-  bool readStarCache(const std::string& cacheFile);
+  /// Waits for a running export of exportArrow(). This has to be called before mStars is
+  /// modified.
+  void waitForArrowExport();
 
-  /// Build vertex array objects from given star list.
+  /// Writes the file of exportArrow(). This runs on a background thread and only reads mStars and
+  /// mStarIdentifiers.
+  bool writeArrowFile(std::string const& file, VistaVector3D const& observer);
+
+  /// Integrates the light of all loaded stars as seen from the given position, or reads the result
+  /// from the given cache file. This runs on a background thread and only reads mStars. Returns
+  /// nullptr if mIrradianceCancelled has been set.
+  std::unique_ptr<StarlightIrradiance> computeStarlightIrradiance(std::string const& cacheFile,
+      VistaVector3D const& observer, std::map<CatalogType, std::string> const& catalogs) const;
+
+  /// Returns the integer coordinates of the cube of cIrradianceRegionSize parsecs which contains
+  /// the observer. The cube with the coordinates (0, 0, 0) is centered on the sun.
+  std::array<int32_t, 3> getObserverRegion() const;
+
+  /// Uploads the color lookup table for the current color model.
+  void buildColorLUT();
+
+  /// Uploads the result of a finished faint star map update to mFaintStarTexture. If mMaxMagnitude
+  /// has changed and no update is running, a new one is started on a background thread.
+  void updateFaintStarMap();
+
+  /// Adds the given range of mMagnitudeOrder to mFaintStarMap, or subtracts it if sign is -1, and
+  /// returns the map for uploading. This runs on a background thread and only reads mStars and
+  /// mMagnitudeOrder. Returns an empty vector if mFaintStarMapCancelled has been set.
+  std::vector<float> accumulateFaintStarMap(
+      size_t first, size_t count, double sign, ColorModel colorModel);
+
+  /// Waits for a running faint star map update after asking it to stop. This has to be called
+  /// before mStars is modified; mFaintStarMap has to be cleared afterwards.
+  void cancelFaintStarMap();
+
+  /// Clears mFaintStarMap, so that it is integrated anew by the next call to updateFaintStarMap().
+  void resetFaintStarMap();
+
+  /// Returns the distance of the given loaded star from the sun in parsecs. Stars without parallax
+  /// are assumed to be very far away.
+  float getDistance(size_t index) const;
+
+  /// Returns the position of the given loaded star relative to the given observer position in
+  /// parsecs.
+  std::array<float, 3> getRelativePosition(size_t index, VistaVector3D const& observer) const;
+
+  /// Returns the apparent magnitude of the given loaded star as seen from the given observer
+  /// position in parsecs, or from the given distance to the star in parsecs.
+  float getApparentMagnitude(size_t index, VistaVector3D const& observer) const;
+  float getApparentMagnitude(size_t index, float observerDistance) const;
+
+  /// Computes the apparent magnitudes of all stars as seen from the given position in parsecs and
+  /// writes them to mStarBuffer. Stars which are so close that their magnitude changes by more
+  /// than cMaxPhotometryError when the observer moves by cPhotometryRegionRadius are marked as near
+  /// stars instead; their magnitude is computed in the vertex shader in each frame.
+  void updateFarStarMagnitudes(VistaVector3D const& observer);
+
+  /// Sorts the loaded stars by sky tile, allocates them in mStarBuffer and writes their vertex
+  /// data.
   void buildStarVAO();
+
+  /// Writes the vertex data of all dynamic star lists to mDynamicStarBuffer and uploads it.
+  void buildDynamicStarVAO();
+
+  /// Uploads the screen-filling quad of the background. This does not depend on the loaded stars,
+  /// so it is done once in the constructor.
   void buildBackgroundVAO();
 
-  std::unique_ptr<VistaTexture> mStarTexture;
+  /// The textures are decoded in the background. Until the star texture is available (or if none
+  /// is set), mFallbackStarTexture is used instead.
+  std::unique_ptr<AsyncTexture> mStarTexture;
   std::string                   mStarTextureFile;
+  std::unique_ptr<VistaTexture> mFallbackStarTexture;
 
-  std::unique_ptr<VistaTexture> mCelestialGridTexture;
+  std::unique_ptr<AsyncTexture> mCelestialGridTexture;
   std::string                   mCelestialGridTextureFile;
 
-  std::unique_ptr<VistaTexture> mStarFiguresTexture;
+  std::unique_ptr<AsyncTexture> mStarFiguresTexture;
   std::string                   mStarFiguresTextureFile;
 
+  std::unique_ptr<VistaTexture> mColorLUT;
+
+  /// Each star has a 16 bit index into mVariableStarTexture in the star buffer; zero means that it
+  /// is not variable.
+  std::string                   mVariableStarsFile;
+  std::vector<VariableStar>     mVariableStars;
+  VistaBufferObject             mVariableStarVBO;
+  std::unique_ptr<VistaTexture> mVariableStarTexture;
+  VistaBufferObject             mEmptyVariableStarVBO;
+  std::unique_ptr<VistaTexture> mEmptyVariableStarTexture;
+  size_t                        mNumVariableStars = 0;
+  double                        mSimulationTime   = 0.0;
+
   std::string mCacheFile = "star_cache.dat";
 
   VistaGLSLShader        mStarShader;
   VistaGLSLShader        mBackgroundShader;
   VistaColor             mBackgroundColor1;
   VistaColor             mBackgroundColor2;
-  VistaVertexArrayObject mStarVAO;
-  VistaBufferObject      mStarVBO;
   VistaVertexArrayObject mBackgroundVAO;
   VistaBufferObject      mBackgroundVBO;
 
-  std::vector<Star>                  mStars;
+  /// mForegroundPending is set when Do() has skipped the stars. mForegroundMissed is set when the
+  /// foreground draw has not been called since then; Do() draws the stars itself in this case.
+  ForegroundDraw mForegroundDraw{*this};
+  bool           mForegroundDrawAttached = false;
+  bool           mForegroundPending      = false;
+  bool           mForegroundMissed       = false;
+
+  DebugView       mDebugView;
+  VistaGLSLShader mDebugFragmentShader;
+  VistaGLSLShader mDebugTileShader;
+  VistaGLSLShader mDebugHistogramShader;
+
+  /// The loaded stars occupy mStars.size() slots starting at mCatalogStarsFirst. The range may be
+  /// moved when the buffer is compacted.
+  StarBuffer mStarBuffer;
+  size_t     mCatalogStarsFirst = 0;
+
+  /// The catalog stars are stored sorted by sky tile. mTileOrder contains the index in mStars of
+  /// the star in each slot of the range.
+  TileCuller            mTileCuller;
+  std::vector<uint32_t> mTileOrder;
+
+  std::map<std::string, std::vector<DynamicStar>> mDynamicStars;
+  StreamingStarBuffer                             mDynamicStarBuffer;
+  bool                                            mDynamicStarsDirty = false;
+
+  StarData                           mStars;
+  StarIdentifiers                    mStarIdentifiers;
   std::map<CatalogType, std::string> mCatalogs;
+  IngestFilter                       mIngestFilter;
+
+  StarlightIrradiance                               mStarlightIrradiance;
+  VistaVector3D                                     mObserverPosition;
+  std::array<int32_t, 3>                            mIrradianceRegion{};
+  bool                                              mIrradianceDirty = false;
+  std::future<std::unique_ptr<StarlightIrradiance>> mIrradianceTask;
+  std::atomic<bool>                                 mIrradianceCancelled{false};
+
+  /// The faint star map is an equirectangular RGB map of the summed luminance of all stars fainter
+  /// than mFaintStarMagnitude. It is accumulated in double precision, so that stars can be added
+  /// and removed again without drift when the magnitude cutoff changes. While mFaintStarMapTask is
+  /// running, mFaintStarMap is only accessed by the task.
+  SharedArray<uint32_t>           mMagnitudeOrder;
+  std::vector<double>             mFaintStarMap;
+  std::unique_ptr<VistaTexture>   mFaintStarTexture;
+  VistaGLSLShader                 mFaintStarShader;
+  float                           mFaintStarMagnitude = std::numeric_limits<float>::max();
+  std::future<std::vector<float>> mFaintStarMapTask;
+  std::atomic<bool>               mFaintStarMapCancelled{false};
+
+  /// The precomputed magnitudes in the star VBO are valid as long as the observer stays within
+  /// cPhotometryRegionRadius of mPhotometryOrigin. When the observer has left this region and the
+  /// magnitudes have been updated recently, all magnitudes are computed in the vertex shader.
+  VistaVector3D                         mPhotometryOrigin;
+  std::chrono::steady_clock::time_point mLastPhotometryUpdate;
+  size_t                                mNumNearStars        = 0;
+  bool                                  mPhotometryDirty     = true;
+  bool                                  mPerVertexPhotometry = true;
+
+  /// Occlusion queries for measuring the number of fragments drawn by the stars.
+  struct OverdrawQuery {
+    GLuint mQuery   = 0;
+    bool   mPending = false;
+    int    mPixels  = 1;
+  };
+
+  std::array<OverdrawQuery, 2> mOverdrawQueries;
+  size_t                       mOverdrawQueryIndex = 0;
+  uint64_t                     mSamplesPassed      = 0;
+  float                        mOverdraw           = 0.F;
+
+  std::vector<PendingCacheSegment> mPendingCacheSegments;
+  std::future<void>                mCacheWriteTask;
+  std::future<bool>                mExportTask;
+
+  DataState                             mDataState   = DataState::eUnloaded;
+  double                                mIdleTimeout = -1.0;
+  std::chrono::steady_clock::time_point mLastDrawTime;
+  uint32_t                              mLoadCount        = 0;
+  uint32_t                              mReleaseCount     = 0;
+  double                                mLastLoadDuration = 0.0;
+
+  /// The memory is also accounted by the loading thread.
+  MemoryUsage        mMemoryUsage;
+  mutable std::mutex mMemoryUsageMutex;
+
+  std::shared_ptr<LoadingState>            mLoadingState;
+  std::future<std::unique_ptr<LoadResult>> mLoadingTask;
+
+  /// The segment which contains mStars and mMagnitudeOrder, if shared memory is enabled.
+  std::shared_ptr<SharedMemory> mSharedMemory;
+
+  /// The number of the most recent message which has been sent with mClusterTransport.
+  std::shared_ptr<ClusterTransport> mClusterTransport;
+  uint32_t                          mClusterMessages = 0;
 
-  DrawMode mDrawMode = DrawMode::eSmoothDisc;
+  DrawMode   mDrawMode   = DrawMode::eSmoothDisc;
+  ColorModel mColorModel = ColorModel::eSpectral;
+  Projection mProjection = Projection::ePerspective;
 
   bool  mShaderDirty            = true;
+  bool  mColorLUTDirty          = true;
   bool  mEnableHDR              = true;
+  bool  mEnableDebugView        = false;
+  bool  mEnableFaintStars       = true;
+  bool  mEnableSharedMemory     = false;
+  bool  mEnableOcclusionCulling = true;
   float mSolidAngle             = 0.000005F;
+  float mMaxSpriteSize          = 0.F;
+  float mFisheyeAperture        = 180.F;
   float mMinMagnitude           = -5.F;
   float mMaxMagnitude           = 15.F;
   float mLuminanceMultiplicator = 1.F;
 
-  static const int cCacheVersion;
+  static const int    cCacheVersion;
+  static const float  cIrradianceRegionSize;
+  static const size_t cMaxIrradianceCacheFiles;
+  static const int    cFaintStarMapWidth;
+  static const int    cFaintStarMapHeight;
+  static const float  cPhotometryRegionRadius;
+  static const float  cMaxPhotometryError;
+  static const float  cNearStarMagnitude;
+  static const int    cClusterTimeout;
+  static const int    cClusterMasterTimeout;
+  static const size_t cMaxUploadBytesPerFrame;
 
   static constexpr size_t NUM_CATALOGS = cs::utils::enumCast(CatalogType::eCount);
   static constexpr size_t NUM_COLUMNS  = cs::utils::enumCast(CatalogColumn::eCount);
@@ -182,6 +969,8 @@ class Stars : public IVistaOpenGLDraw {
   static const char* cStarsVert;
   static const char* cStarsFrag;
   static const char* cStarsGeom;
+  static const char* cStarsVertDebug;
+  static const char* cStarsFragDebug;
   static const char* cBackgroundVert;
   static const char* cBackgroundFrag;
 };
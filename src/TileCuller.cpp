@@ -0,0 +1,314 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileCuller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace csp::stars {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// With six faces, the sky is divided into 384 tiles of about ten degrees.
+const int   TileCuller::cTilesPerEdge = 8;
+const float TileCuller::cMaxTileAngle = 1.2F;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+using Direction = std::array<float, 3>;
+
+float dot(Direction const& a, Direction const& b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Direction normalize(Direction const& a) {
+  float length = std::sqrt(dot(a, a));
+  return {a[0] / length, a[1] / length, a[2] / length};
+}
+
+// The faces are +x, -x, +y, -y, +z and -z. u and v are the other two coordinates in [-1, 1].
+Direction getDirection(size_t face, float u, float v) {
+  float s = face % 2 == 0 ? 1.F : -1.F;
+
+  if (face / 2 == 0) {
+    return normalize({s, u, v});
+  }
+
+  if (face / 2 == 1) {
+    return normalize({u, s, v});
+  }
+
+  return normalize({u, v, s});
+}
+
+// Rotates the corner of a tile away from the tile center by the given angle.
+Direction expand(Direction const& center, Direction const& corner, float angle) {
+  float     cosAngle = dot(center, corner);
+  Direction perpendicular =
+      normalize({corner[0] - center[0] * cosAngle, corner[1] - center[1] * cosAngle,
+          corner[2] - center[2] * cosAngle});
+
+  float newAngle = std::acos(std::clamp(cosAngle, -1.F, 1.F)) + angle;
+  float c        = std::cos(newAngle);
+  float s        = std::sin(newAngle);
+
+  return {center[0] * c + perpendicular[0] * s, center[1] * c + perpendicular[1] * s,
+      center[2] * c + perpendicular[2] * s};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TileCuller::getNumTiles() {
+  return 6 * cTilesPerEdge * cTilesPerEdge;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TileCuller::getTile(float x, float y, float z) {
+  float ax = std::abs(x);
+  float ay = std::abs(y);
+  float az = std::abs(z);
+
+  size_t face = 0;
+  float  u    = 0.F;
+  float  v    = 0.F;
+  float  m    = 0.F;
+
+  if (ax >= ay && ax >= az) {
+    face = x > 0.F ? 0 : 1;
+    u    = y;
+    v    = z;
+    m    = ax;
+  } else if (ay >= az) {
+    face = y > 0.F ? 2 : 3;
+    u    = x;
+    v    = z;
+    m    = ay;
+  } else {
+    face = z > 0.F ? 4 : 5;
+    u    = x;
+    v    = y;
+    m    = az;
+  }
+
+  if (m == 0.F) {
+    return 0;
+  }
+
+  auto cell = [](float c) {
+    return static_cast<size_t>(
+        std::clamp(static_cast<int>((c + 1.F) * 0.5F * cTilesPerEdge), 0, cTilesPerEdge - 1));
+  };
+
+  return (face * cTilesPerEdge + cell(v / m)) * cTilesPerEdge + cell(u / m);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileCuller::~TileCuller() {
+  if (!mQueries.empty()) {
+    glDeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCuller::setTiles(std::vector<Tile> tiles) {
+  mTiles = std::move(tiles);
+  mProxies.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCuller::clear() {
+  mTiles.clear();
+  mProxies.clear();
+  mNumCulledTiles = 0;
+  mNumCulledStars = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileCuller::empty() const {
+  return mTiles.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCuller::testTiles(VistaTransformMatrix const& matModelView,
+    VistaTransformMatrix const& matProjection, float margin, float observerDistance) {
+  if (mShaderDirty) {
+    mShader = VistaGLSLShader();
+    mShader.InitVertexShaderFromString(cTileCullerVert);
+    mShader.InitFragmentShaderFromString(cTileCullerFrag);
+    mShader.Link();
+
+    mVAO.EnableAttributeArray(0);
+    mVAO.SpecifyAttributeArrayFloat(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0, &mVBO);
+
+    mShaderDirty = false;
+  }
+
+  if (mQueries.empty()) {
+    mQueries.resize(getNumTiles());
+    glGenQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+  }
+
+  // The statistics are taken from the queries of the previous frame, but only if all of their
+  // results are available already. This never waits for the GPU.
+  bool available = !mProxies.empty();
+
+  for (size_t i = 0; i < mProxies.size() && available; ++i) {
+    if (mProxies[i] >= 0) {
+      GLuint result = 0;
+      glGetQueryObjectuiv(mQueries[i], GL_QUERY_RESULT_AVAILABLE, &result);
+      available = result != 0;
+    }
+  }
+
+  if (available) {
+    mNumCulledTiles = 0;
+    mNumCulledStars = 0;
+
+    for (size_t i = 0; i < mProxies.size(); ++i) {
+      if (mProxies[i] >= 0) {
+        GLuint visible = 0;
+        glGetQueryObjectuiv(mQueries[i], GL_QUERY_RESULT, &visible);
+
+        if (visible == 0) {
+          ++mNumCulledTiles;
+          mNumCulledStars += mTiles[i].mCount;
+        }
+      }
+    }
+  }
+
+  // The corners of the bounding quads are moved away from the tile centers. As the edges of the
+  // quads are great circles, the corners are moved by sqrt(2) times the margin.
+  mProxies.assign(mTiles.size(), -1);
+  mVertices.clear();
+
+  int numProxies = 0;
+
+  for (size_t i = 0; i < mTiles.size(); ++i) {
+    auto const& tile = mTiles[i];
+
+    if (tile.mCount == 0 || observerDistance >= tile.mMinDistance) {
+      continue;
+    }
+
+    float angle = (margin + std::asin(observerDistance / tile.mMinDistance)) * std::sqrt(2.F);
+
+    size_t face   = i / (cTilesPerEdge * cTilesPerEdge);
+    auto   row    = static_cast<float>(i / cTilesPerEdge % cTilesPerEdge);
+    auto   column = static_cast<float>(i % cTilesPerEdge);
+    float  size   = 2.F / cTilesPerEdge;
+
+    Direction center = getDirection(face, (column + 0.5F) * size - 1.F, (row + 0.5F) * size - 1.F);
+
+    std::array<Direction, 4> corners = {
+        getDirection(face, column * size - 1.F, row * size - 1.F),
+        getDirection(face, (column + 1.F) * size - 1.F, row * size - 1.F),
+        getDirection(face, (column + 1.F) * size - 1.F, (row + 1.F) * size - 1.F),
+        getDirection(face, column * size - 1.F, (row + 1.F) * size - 1.F),
+    };
+
+    bool tooLarge = std::any_of(corners.begin(), corners.end(), [&](Direction const& corner) {
+      return std::acos(std::clamp(dot(center, corner), -1.F, 1.F)) + angle > cMaxTileAngle;
+    });
+
+    if (tooLarge) {
+      continue;
+    }
+
+    for (auto const& corner : corners) {
+      Direction expanded = expand(center, corner, angle);
+      mVertices.insert(mVertices.end(), expanded.begin(), expanded.end());
+    }
+
+    mProxies[i] = numProxies++;
+  }
+
+  if (numProxies == 0) {
+    return;
+  }
+
+  mVBO.Bind(GL_ARRAY_BUFFER);
+  mVBO.BufferData(
+      static_cast<GLsizeiptr>(mVertices.size() * sizeof(float)), mVertices.data(), GL_STREAM_DRAW);
+  mVBO.Release();
+
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+  mShader.Bind();
+  glUniformMatrix4fv(mShader.GetUniformLocation("uMatMV"), 1, GL_FALSE, matModelView.GetData());
+  glUniformMatrix4fv(mShader.GetUniformLocation("uMatP"), 1, GL_FALSE, matProjection.GetData());
+
+  mVAO.Bind();
+
+  for (size_t i = 0; i < mProxies.size(); ++i) {
+    if (mProxies[i] >= 0) {
+      glBeginQuery(GL_ANY_SAMPLES_PASSED, mQueries[i]);
+      glDrawArrays(GL_TRIANGLE_FAN, 4 * mProxies[i], 4);
+      glEndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+  }
+
+  mVAO.Release();
+  mShader.Release();
+
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileCuller::drawTiles(size_t first) {
+  for (size_t i = 0; i < mTiles.size(); ++i) {
+    auto const& tile = mTiles[i];
+
+    if (tile.mCount == 0) {
+      continue;
+    }
+
+    auto start = static_cast<GLint>(first + tile.mFirst);
+    auto count = static_cast<GLsizei>(tile.mCount);
+
+    // The GPU waits for the result of the query, the CPU is not blocked.
+    if (i < mProxies.size() && mProxies[i] >= 0) {
+      glBeginConditionalRender(mQueries[i], GL_QUERY_WAIT);
+      glDrawArrays(GL_POINTS, start, count);
+      glEndConditionalRender();
+    } else {
+      glDrawArrays(GL_POINTS, start, count);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TileCuller::getNumCulledTiles() const {
+  return mNumCulledTiles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TileCuller::getNumCulledStars() const {
+  return mNumCulledStars;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars
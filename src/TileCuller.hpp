@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_TILE_CULLER_HPP
+#define CSP_STARS_TILE_CULLER_HPP
+
+#include <VistaBase/VistaVectorMath.h>
+#include <VistaOGLExt/VistaBufferObject.h>
+#include <VistaOGLExt/VistaGLSLShader.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+
+#include <vector>
+
+namespace csp::stars {
+
+/// Skips stars which are hidden behind opaque geometry, for example when the observer is close to
+/// a planet. The sky is divided into the cells of a cube map as seen from the sun and the stars
+/// are sorted by these tiles. Before the stars are drawn, the bounding quad of each tile is drawn
+/// against the depth buffer of the already rendered scene with an occlusion query. The stars of
+/// each tile are then drawn with conditional rendering, so that the GPU skips occluded tiles
+/// without any read-back to the CPU.
+class TileCuller {
+ public:
+  /// The number of tiles along each edge of a cube face.
+  static const int cTilesPerEdge;
+
+  /// Tiles whose bounding quad would span more than this angle in radians from the tile center
+  /// are always drawn.
+  static const float cMaxTileAngle;
+
+  /// The stars of one tile. mFirst is relative to the first star passed to drawTiles().
+  struct Tile {
+    size_t mFirst       = 0;
+    size_t mCount       = 0;
+    float  mMinDistance = 0.F; ///< The distance of the closest star to the sun in parsecs.
+  };
+
+  static size_t getNumTiles();
+
+  /// Returns the tile which contains the given direction. It does not need to be normalized.
+  static size_t getTile(float x, float y, float z);
+
+  TileCuller() = default;
+  ~TileCuller();
+
+  TileCuller(TileCuller const& other) = delete;
+  TileCuller(TileCuller&& other)      = delete;
+  TileCuller& operator=(TileCuller const& other) = delete;
+  TileCuller& operator=(TileCuller&& other) = delete;
+
+  /// Sets the stars of all tiles. The stars have to be stored sorted by tile.
+  void setTiles(std::vector<Tile> tiles);
+  void clear();
+  bool empty() const;
+
+  /// Issues one occlusion query for each tile. The bounding quads are enlarged by the given angle
+  /// in radians, which should be the angular radius of the largest star on screen. Additionally,
+  /// they are enlarged by the parallax of the closest star of each tile for an observer at the
+  /// given distance to the sun in parsecs. This has to be called with depth testing enabled.
+  void testTiles(VistaTransformMatrix const& matModelView,
+      VistaTransformMatrix const& matProjection, float margin, float observerDistance);
+
+  /// Draws the stars of all tiles with the currently bound shader and vertex array object. Tiles
+  /// which have been tested by the last call to testTiles() are drawn only if they are visible.
+  void drawTiles(size_t first);
+
+  /// The number of tiles and stars which have been culled in the most recent frame whose query
+  /// results were available.
+  size_t getNumCulledTiles() const;
+  size_t getNumCulledStars() const;
+
+ private:
+  std::vector<Tile>   mTiles;
+  std::vector<GLuint> mQueries;
+
+  /// The index of the bounding quad of each tile in mVBO, or -1 if the tile was not tested.
+  std::vector<int>   mProxies;
+  std::vector<float> mVertices;
+
+  VistaGLSLShader        mShader;
+  VistaVertexArrayObject mVAO;
+  VistaBufferObject      mVBO;
+  bool                   mShaderDirty = true;
+
+  size_t mNumCulledTiles = 0;
+  size_t mNumCulledStars = 0;
+
+  static const char* cTileCullerVert;
+  static const char* cTileCullerFrag;
+};
+
+} // namespace csp::stars
+
+#endif // CSP_STARS_TILE_CULLER_HPP
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Tracing.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace csp::stars::tracing {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Event {
+  char const* mName  = nullptr;
+  int64_t     mStart = 0;
+  int64_t     mEnd   = 0;
+};
+
+// Each thread writes into its own buffer, the only shared state is the write index. dump() may
+// read a buffer while its thread overwrites old events; such events are detected by comparing the
+// write index before and after copying and are dropped.
+struct ThreadBuffer {
+  static const size_t cCapacity = 1 << 14;
+
+  std::array<Event, cCapacity> mEvents;
+  std::atomic<uint64_t>        mWriteIndex{0};
+  uint32_t                     mThreadID = 0;
+  bool                         mInUse    = true;
+};
+
+// The buffers are never freed, so that the events of finished threads can still be dumped. When a
+// thread exits, its buffer is handed on to the next new thread which records an event. Hence
+// short-lived worker threads do not accumulate buffers; they share a track in the trace instead.
+std::mutex                                 sRegistryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> sThreadBuffers;
+
+ThreadBuffer* acquireThreadBuffer() {
+  std::lock_guard<std::mutex> lock(sRegistryMutex);
+
+  for (auto& buffer : sThreadBuffers) {
+    if (!buffer->mInUse) {
+      buffer->mInUse = true;
+      return buffer.get();
+    }
+  }
+
+  sThreadBuffers.push_back(std::make_unique<ThreadBuffer>());
+  sThreadBuffers.back()->mThreadID = static_cast<uint32_t>(sThreadBuffers.size());
+  return sThreadBuffers.back().get();
+}
+
+// Returns the buffer of a thread to the pool when the thread exits.
+struct ThreadBufferHandle {
+  ThreadBuffer* mBuffer = acquireThreadBuffer();
+
+  ~ThreadBufferHandle() {
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    mBuffer->mInUse = false;
+  }
+};
+
+ThreadBuffer& getThreadBuffer() {
+  thread_local ThreadBufferHandle handle;
+  return *handle.mBuffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int64_t now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void record(char const* name, int64_t start, int64_t end) {
+  auto&    buffer = getThreadBuffer();
+  uint64_t index  = buffer.mWriteIndex.load(std::memory_order_relaxed);
+
+  buffer.mEvents.at(index % ThreadBuffer::cCapacity) = {name, start, end};
+  buffer.mWriteIndex.store(index + 1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool dump(std::string const& file) {
+  if (!isEnabled()) {
+    logger().warn(
+        "Cannot dump trace: csp-stars has been compiled without CSP_STARS_ENABLE_TRACING!");
+    return false;
+  }
+
+  std::vector<ThreadBuffer const*> buffers;
+  {
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    for (auto const& buffer : sThreadBuffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+
+  std::ofstream stream(file);
+
+  if (!stream.is_open()) {
+    logger().error("Cannot dump trace: Failed to open '{}' for writing!", file);
+    return false;
+  }
+
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool   first     = true;
+  size_t numEvents = 0;
+
+  for (auto const* buffer : buffers) {
+    uint64_t end   = buffer->mWriteIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > ThreadBuffer::cCapacity ? end - ThreadBuffer::cCapacity : 0;
+
+    std::vector<Event> events;
+    events.reserve(end - begin);
+    for (uint64_t i = begin; i < end; ++i) {
+      events.push_back(buffer->mEvents.at(i % ThreadBuffer::cCapacity));
+    }
+
+    // Skip all events which may have been overwritten while copying. record() writes the event
+    // with the index newEnd before it increments the write index, so this event may already
+    // have overwritten the one with the index newEnd - cCapacity. The fence keeps the copies
+    // above from being reordered after the load of the write index.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newEnd = buffer->mWriteIndex.load(std::memory_order_relaxed) + 1;
+    uint64_t skip   = 0;
+    if (newEnd > ThreadBuffer::cCapacity && newEnd - ThreadBuffer::cCapacity > begin) {
+      skip = std::min<uint64_t>(newEnd - ThreadBuffer::cCapacity - begin, events.size());
+    }
+
+    for (size_t i = skip; i < events.size(); ++i) {
+      auto const& e = events[i];
+
+      // The names are string literals from this plugin, so they do not need escaping.
+      stream << (first ? "" : ",") << "{\"name\":\"" << e.mName
+             << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->mThreadID << ",\"ts\":" << e.mStart
+             << ",\"dur\":" << (e.mEnd - e.mStart) << "}";
+      first = false;
+      ++numEvents;
+    }
+  }
+
+  stream << "]}";
+
+  logger().info("Wrote {} trace events to '{}'.", numEvents, file);
+
+  return stream.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::stars::tracing
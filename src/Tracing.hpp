@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_STARS_TRACING_HPP
+#define CSP_STARS_TRACING_HPP
+
+#include <cstdint>
+#include <string>
+
+/// A minimal tracing facility for profiling the plugin. Scoped zones are recorded into a ring
+/// buffer of the thread which executes them, so recording needs neither locks nor allocations.
+/// The recorded events can be written as Chrome trace JSON which can be opened in Perfetto or
+/// chrome://tracing. Tracing is only compiled in if CSP_STARS_ENABLE_TRACING is defined (see the
+/// CMake option of the same name); otherwise CSP_STARS_TRACE_ZONE() expands to nothing.
+namespace csp::stars::tracing {
+
+/// Returns true if the plugin has been compiled with tracing support.
+constexpr bool isEnabled() {
+#ifdef CSP_STARS_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// Returns the time in microseconds since the first call of this method.
+int64_t now();
+
+/// Records a completed zone for the calling thread. Only the pointer to the name is stored, hence
+/// it has to be a string literal. If the ring buffer of the thread is full, the oldest events are
+/// overwritten.
+void record(char const* name, int64_t start, int64_t end);
+
+/// Writes the events of all threads to the given file in the Chrome trace event format. Returns
+/// false if tracing is disabled or if the file could not be written.
+bool dump(std::string const& file);
+
+/// Records the time between its construction and its destruction.
+class Zone {
+ public:
+  explicit Zone(char const* name)
+      : mName(name)
+      , mStart(now()) {
+  }
+
+  ~Zone() {
+    record(mName, mStart, now());
+  }
+
+  Zone(Zone const& other) = delete;
+  Zone(Zone&& other)      = delete;
+  Zone& operator=(Zone const& other) = delete;
+  Zone& operator=(Zone&& other) = delete;
+
+ private:
+  char const* mName;
+  int64_t     mStart;
+};
+
+} // namespace csp::stars::tracing
+
+#ifdef CSP_STARS_ENABLE_TRACING
+#define CSP_STARS_TRACE_CONCAT_IMPL(a, b) a##b
+#define CSP_STARS_TRACE_CONCAT(a, b) CSP_STARS_TRACE_CONCAT_IMPL(a, b)
+#define CSP_STARS_TRACE_ZONE(name)                                                                 \
+  ::csp::stars::tracing::Zone CSP_STARS_TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define CSP_STARS_TRACE_ZONE(name)
+#endif
+
+#endif // CSP_STARS_TRACING_HPP